@@ -0,0 +1,499 @@
+#include <AnimationClock.h>
+#include <AnimationManager.h>
+#include <AudioAnalyzer.h>
+#include <ColorParser.h>
+#include <ColorKernels.h>
+#include <FadeAnimationBatch.h>
+#include <FrameStream.h>
+#include <FusedRenderPipeline.h>
+#include <LedBufferStorage.h>
+#include <LedStripCrossFadeHandler.h>
+#include <LedStrip_Simulated.h>
+#include <ProceduralEffects.h>
+#include <SceneCompiler.h>
+#include <StaticAnimationManager.h>
+#include <StaticLedBufferStorage.h>
+#include <StaticPipeline.h>
+#include <VirtualFlattenedLedStrip.h>
+#include <VirtualLedStrip.h>
+#include <VirtualLedStripWithPowerLimit.h>
+#include <VirtualPalettedLedStrip.h>
+
+#include <chrono>
+#include <cstdio>
+#include <functional>
+#include <memory>
+#include <string>
+#include <vector>
+
+/**
+* Native benchmarks for the rendering hot paths.
+* Each result is printed as one JSON object per line:
+* {"name": ..., "iterations": ..., "ns_per_op": ..., "pixels_per_s": ...}
+*/
+
+// Minimum measurement time per benchmark
+static const std::chrono::milliseconds MIN_DURATION(200);
+
+static const ledoffset_t LED_COUNT = 255;
+
+/**
+* Prevents the compiler from optimizing away the computation of the given value.
+*/
+template<typename T>
+static void DoNotOptimize(const T& value) {
+	asm volatile("" : : "r,m"(value) : "memory");
+}
+
+/**
+* Runs the operation until MIN_DURATION is reached and prints the result.
+* \param pixelsPerOp number of pixels processed by one operation, 0 when not applicable
+*/
+static void RunBenchmark(const std::string& name, size_t pixelsPerOp, const std::function<void()>& operation) {
+	typedef std::chrono::steady_clock Clock;
+
+	// Warm up
+	operation();
+
+	size_t iterations = 0;
+	size_t batchSize = 1;
+	Clock::duration elapsed(0);
+
+	while (elapsed < MIN_DURATION) {
+		Clock::time_point t0 = Clock::now();
+
+		for (size_t i = 0; i < batchSize; ++i) {
+			operation();
+		}
+
+		elapsed += Clock::now() - t0;
+		iterations += batchSize;
+		batchSize *= 2;
+	}
+
+	double nsPerOp = double(std::chrono::duration_cast<std::chrono::nanoseconds>(elapsed).count()) / double(iterations);
+	double pixelsPerSecond = pixelsPerOp > 0 ? double(pixelsPerOp) * 1e9 / nsPerOp : 0.0;
+
+	printf("{\"name\": \"%s\", \"iterations\": %zu, \"ns_per_op\": %.3f, \"pixels_per_s\": %.0f}\n",
+		name.c_str(), iterations, nsPerOp, pixelsPerSecond);
+}
+
+static void BenchmarkRGBW() {
+	RGBW a(200, 150, 100, 50);
+	RGBW b(10, 20, 30, 40);
+	float factor = 0.3f;
+	uint16_t brightness = 300;
+
+	RunBenchmark("RGBW::interpolateTo", 1, [&]() {
+		DoNotOptimize(a.interpolateTo(b, factor));
+	});
+
+	RunBenchmark("RGBW::operator+", 1, [&]() {
+		DoNotOptimize(a + b);
+	});
+
+	RunBenchmark("RGBW::getWithTotalBrightness", 1, [&]() {
+		DoNotOptimize(a.getWithTotalBrightness(brightness));
+	});
+}
+
+static void BenchmarkColorParsing() {
+	const std::vector<std::string> commands = {"red", "Turquoise*0.5", "wwhite", "MAGENTA*0.25", "blue*1", "off"};
+	size_t index = 0;
+	RGBW color;
+
+	RunBenchmark("ParseNamedColor", 1, [&]() {
+		ParseNamedColor(commands[index++ % commands.size()], color);
+		DoNotOptimize(color);
+	});
+
+	index = 0;
+
+	RunBenchmark("ParseColor", 1, [&]() {
+		ParseColor(commands[index++ % commands.size()], color);
+		DoNotOptimize(color);
+	});
+
+	RunBenchmark("ParseColor/hex", 1, [&]() {
+		ParseColor("#FF8000A0", color);
+		DoNotOptimize(color);
+	});
+
+	LedBufferStorage strip(LED_COUNT);
+
+	RunBenchmark("ApplyColorRanges", LED_COUNT, [&]() {
+		ApplyColorRanges(strip, "all=off,0-63=red*0.5,64-127=#00FF00,128-254=blue");
+	});
+}
+
+static void BenchmarkHueKernels() {
+	LedBufferStorage leds(LED_COUNT);
+	uint8_t startHue = 0;
+
+	RunBenchmark("FillRainbow", LED_COUNT, [&]() {
+		FillRainbow(leds, startHue++);
+	});
+
+	RunBenchmark("FillRainbow/HSV", LED_COUNT, [&]() {
+		FillRainbow(leds, startHue++, 200, 128, true);
+	});
+
+	RunBenchmark("RotateHue", LED_COUNT, [&]() {
+		RotateHue(leds, 1);
+	});
+}
+
+static void BenchmarkPowerLimit() {
+	LedBufferStorage leds(LED_COUNT);
+	LedPowerConsumptionInfo consumptionInfo(1.f, 20.f, 20.f);
+
+	// Limit to roughly a quarter of the full white consumption
+	VirtualLedStripWithPowerLimit limitedLeds(leds, consumptionInfo, LED_COUNT * 20.f);
+
+	limitedLeds.setAll(COLOR_NWHITE);
+
+	RunBenchmark("VirtualLedStripWithPowerLimit::updateLeds", LED_COUNT, [&]() {
+		limitedLeds.updateLeds();
+	});
+}
+
+static void BenchmarkAnimationManager(size_t countAnimations) {
+	const size_t countStrips = (countAnimations + LED_COUNT - 1) / LED_COUNT;
+
+	std::vector<std::unique_ptr<LedBufferStorage>> strips;
+	AnimationManager animationManager;
+
+	for (size_t i = 0; i < countStrips; ++i) {
+		strips.emplace_back(new LedBufferStorage(LED_COUNT));
+	}
+
+	for (size_t i = 0; i < countAnimations; ++i) {
+		LedBufferStorage& strip = *strips[i / LED_COUNT];
+
+		// Long running animations, so none of them finishes during the benchmark
+		animationManager.addAnimation(new FadeAnimation(0, UINT32_MAX / 2, strip, i % LED_COUNT, COLOR_RED, COLOR_BLUE));
+	}
+
+	// Simulated 240 fps, so the results do not depend on the wall clock
+	ManualAnimationClock clock;
+	animationManager.setClock(&clock);
+
+	RunBenchmark("AnimationManager::update/" + std::to_string(countAnimations), countAnimations, [&]() {
+		clock.advanceFrames(1, 240);
+		animationManager.update();
+	});
+}
+
+static void BenchmarkStaticAnimationManager() {
+	static StaticLedBufferStorage<LED_COUNT> strip;
+	static StaticAnimationManager<LED_COUNT> animationManager;
+
+	for (ledoffset_t i = 0; i < LED_COUNT; ++i) {
+		animationManager.emplaceAnimation<FadeAnimation>(0, UINT32_MAX / 2, strip, i, COLOR_RED, COLOR_BLUE);
+	}
+
+	uint32_t currentTime = 0;
+
+	RunBenchmark("StaticAnimationManager::update/" + std::to_string(LED_COUNT), LED_COUNT, [&]() {
+		animationManager.update(++currentTime);
+	});
+}
+
+static void BenchmarkFadeAnimationBatch(size_t countAnimations) {
+	LedBufferStorage strip(LED_COUNT);
+	FadeAnimationBatch batch(strip);
+
+	for (size_t i = 0; i < countAnimations; ++i) {
+		batch.addFade(0, UINT32_MAX / 2, i % LED_COUNT, COLOR_RED, COLOR_BLUE);
+	}
+
+	uint32_t currentTime = 0;
+
+	RunBenchmark("FadeAnimationBatch::update/" + std::to_string(countAnimations), countAnimations, [&]() {
+		batch.update(++currentTime);
+	});
+}
+
+static void BenchmarkCrossFade() {
+	LedBufferStorage target(LED_COUNT);
+	LedStripCrossFadeHandler crossFade(target, 0.5f);
+
+	crossFade.getBaseLeds0().setAll(COLOR_RED);
+	crossFade.getBaseLeds1().setAll(COLOR_BLUE);
+
+	RunBenchmark("LedStripCrossFadeHandler::updateLeds", LED_COUNT, [&]() {
+		crossFade.updateLeds();
+	});
+}
+
+static void BenchmarkVirtualChain() {
+	const ledoffset_t half = LED_COUNT / 2;
+
+	LedBufferStorage strip0(half);
+	LedBufferStorage strip1(LED_COUNT - half);
+	VirtualMultiLedStrip2 multi(strip0, strip1);
+
+	std::vector<ledoffset_t> indices;
+	for (ledoffset_t i = 0; i < LED_COUNT; ++i) {
+		indices.push_back((i * 7) % LED_COUNT);
+	}
+
+	VirtualMappedLedStrip mapped(multi, indices);
+	VirtualInversedLedStrip inversed(mapped);
+	VirtualPassthroughLedStrip chain(inversed);
+
+	VirtualFlattenedLedStrip flattened(chain);
+
+	RGBW color = COLOR_RED;
+
+	RunBenchmark("VirtualChain4::setLed", LED_COUNT, [&]() {
+		for (ledoffset_t i = 0; i < LED_COUNT; ++i) {
+			chain.setLed(i, color);
+		}
+	});
+
+	RunBenchmark("VirtualFlattenedLedStrip::setLed", LED_COUNT, [&]() {
+		for (ledoffset_t i = 0; i < LED_COUNT; ++i) {
+			flattened.setLed(i, color);
+		}
+	});
+}
+
+static void BenchmarkSimulatedPipeline() {
+	LedStrip_Simulated strip(LED_COUNT, LedWireProtocol::APA102);
+	LedPowerConsumptionInfo consumptionInfo(1.f, 20.f, 20.f);
+	VirtualLedStripWithPowerLimit limitedLeds(strip, consumptionInfo, LED_COUNT * 40.f);
+	AnimationManager animationManager;
+
+	for (ledoffset_t i = 0; i < LED_COUNT; ++i) {
+		animationManager.addAnimation(new FadeAnimation(0, UINT32_MAX / 2, limitedLeds, i, COLOR_RED, COLOR_KWHITE));
+	}
+
+	uint32_t currentTime = 0;
+
+	RunBenchmark("Pipeline/Animation+PowerLimit+APA102", LED_COUNT, [&]() {
+		// Large time steps, so the colors change every frame
+		currentTime += 1000;
+		animationManager.update(currentTime);
+	});
+
+	printf("{\"name\": \"Pipeline/APA102 wire time\", \"us_per_frame\": %u}\n", strip.getFrameTime_us());
+}
+
+static void BenchmarkFusedPipeline() {
+	LedPowerConsumptionInfo consumptionInfo(1.f, 20.f, 20.f);
+	const float powerLimit = LED_COUNT * 30.f;
+
+	LedStrip_Simulated chainOutput(LED_COUNT, LedWireProtocol::APA102, 0);
+	VirtualLedStripWithPowerLimit limitedLeds(chainOutput, consumptionInfo, powerLimit);
+	LedStripCrossFadeHandler crossFade(limitedLeds, 0.5f);
+
+	crossFade.getBaseLeds0().setAll(COLOR_RED);
+	crossFade.getBaseLeds1().setAll(COLOR_NWHITE);
+
+	RunBenchmark("Pipeline/CrossFade+PowerLimit+APA102", LED_COUNT, [&]() {
+		crossFade.updateLeds();
+	});
+
+	LedStrip_Simulated fusedOutput(LED_COUNT, LedWireProtocol::APA102, 0);
+	FusedRenderPipeline pipeline(fusedOutput, crossFade.getBaseLeds0());
+
+	pipeline.setCrossFade(crossFade.getBaseLeds0(), crossFade.getBaseLeds1(), 0.5f);
+	pipeline.setPowerLimit(consumptionInfo, powerLimit);
+
+	RunBenchmark("FusedRenderPipeline::render/CrossFade+PowerLimit+APA102", LED_COUNT, [&]() {
+		pipeline.render();
+	});
+}
+
+static constexpr LedPowerConsumptionInfo STATIC_PIPELINE_CONSUMPTION(1.f, 20.f, 20.f);
+
+static void BenchmarkStaticPipeline() {
+	const float powerLimit = LED_COUNT * 60.f;
+
+	LedStrip_Simulated chainOutput(LED_COUNT, LedWireProtocol::APA102, 0);
+	VirtualLedStripWithPowerLimit limitedLeds(chainOutput, STATIC_PIPELINE_CONSUMPTION, powerLimit);
+	VirtualInversedLedStrip inversed(limitedLeds);
+	uint8_t frame = 0;
+
+	RunBenchmark("Pipeline/Inverse+PowerLimit+APA102", LED_COUNT, [&]() {
+		for (ledoffset_t i = 0; i < LED_COUNT; ++i) {
+			inversed.setLed(i, RGBW(frame, i, 0, 0));
+		}
+
+		inversed.updateLeds();
+		++frame;
+	});
+
+	LedStrip_Simulated staticOutput(LED_COUNT, LedWireProtocol::APA102, 0);
+	StaticPipeline<WireOutputSink<APA102Encoding, LED_COUNT>, InverseStage, PowerLimitStage<STATIC_PIPELINE_CONSUMPTION, uint32_t(LED_COUNT * 60)>> pipeline(staticOutput);
+
+	RunBenchmark("StaticPipeline::render/Inverse+PowerLimit+APA102", LED_COUNT, [&]() {
+		for (ledoffset_t i = 0; i < LED_COUNT; ++i) {
+			pipeline.setLed(i, RGBW(frame, i, 0, 0));
+		}
+
+		pipeline.render();
+		++frame;
+	});
+}
+
+static void BenchmarkPaletteAnimation() {
+	const uint8_t paletteSize = 16;
+
+	LedBufferStorage output(LED_COUNT);
+	LedPalette palette;
+	VirtualPalettedLedStrip<4> strip(output, palette);
+	AnimationManager animationManager;
+
+	for (uint8_t i = 0; i < paletteSize; ++i) {
+		palette.addColor(RGBW(i, 0, 0, 0));
+	}
+
+	for (ledoffset_t i = 0; i < LED_COUNT; ++i) {
+		strip.setIndex(i, i % paletteSize);
+	}
+
+	for (uint8_t i = 0; i < paletteSize; ++i) {
+		animationManager.addAnimation(new PaletteFadeAnimation(0, UINT32_MAX / 2, strip, palette, i, COLOR_RED, COLOR_BLUE));
+	}
+
+	uint32_t currentTime = 0;
+
+	RunBenchmark("PaletteFadeAnimation::update/16", LED_COUNT, [&]() {
+		currentTime += 1000;
+		animationManager.update(currentTime);
+	});
+}
+
+static void BenchmarkProceduralEffects() {
+	LedBufferStorage strip(LED_COUNT);
+
+	NoiseEffect noise(0, 0, strip, COLOR_RED, COLOR_BLUE);
+	FireEffect fire(0, 0, strip);
+	ChaseEffect chase(0, 0, strip, COLOR_RED, COLOR_OFF);
+	TwinkleEffect twinkle(0, 0, strip, COLOR_WWHITE, COLOR_OFF);
+	CometEffect comet(0, 0, strip, COLOR_BLUE);
+
+	std::vector<std::pair<std::string, AProceduralEffect*>> effects = {
+		{"Noise", &noise}, {"Fire", &fire}, {"Chase", &chase}, {"Twinkle", &twinkle}, {"Comet", &comet}
+	};
+
+	for (auto& effect : effects) {
+		uint32_t currentTime = 0;
+
+		RunBenchmark("ProceduralEffect/" + effect.first, LED_COUNT, [&]() {
+			effect.second->update(currentTime += 16);
+		});
+	}
+}
+
+static void BenchmarkSceneVM() {
+	const uint32_t duration = UINT32_MAX / 2;
+	const ledoffset_t half = LED_COUNT / 2;
+
+	// Two opposite fades over both halves of the strip, as scene and as equivalent animation graph
+	LedBufferStorage sceneStrip(LED_COUNT);
+	SceneCompiler compiler;
+	SceneVM vm(sceneStrip);
+	std::vector<uint8_t> code;
+
+	compiler.compile("fade 0 " + std::to_string(half) + " red blue " + std::to_string(duration) + "\n"
+		"fade " + std::to_string(half) + " 0 blue red " + std::to_string(duration) + "\n", code);
+	vm.load(code.data(), code.size());
+
+	uint32_t sceneTime = 0;
+
+	RunBenchmark("SceneVM::render", LED_COUNT, [&]() {
+		vm.render(++sceneTime, false);
+	});
+
+	LedBufferStorage animationStrip(LED_COUNT);
+	AnimationManager animationManager;
+
+	for (ledoffset_t i = 0; i < LED_COUNT; ++i) {
+		bool first = i < half;
+		animationManager.addAnimation(new FadeAnimation(0, duration, animationStrip, i, first ? COLOR_RED : COLOR_BLUE, first ? COLOR_BLUE : COLOR_RED));
+	}
+
+	uint32_t animationTime = 0;
+
+	RunBenchmark("SceneVM/AnimationManager equivalent", LED_COUNT, [&]() {
+		animationManager.update(++animationTime);
+	});
+
+	printf("{\"name\": \"SceneVM bytecode size\", \"bytes\": %zu}\n", code.size());
+}
+
+static void BenchmarkFrameStreamPlayback() {
+	const uint32_t countFrames = 200;
+	const uint32_t frameInterval_us = 1000;
+
+	std::vector<uint8_t> stream;
+	LedBufferStorage source(LED_COUNT);
+	FrameStreamRecorder recorder(source, stream, frameInterval_us);
+
+	for (uint32_t frame = 0; frame < countFrames; ++frame) {
+		recorder.setAll(RGBW(frame, 0, 0, 0), false);
+		recorder.setLed(frame % LED_COUNT, COLOR_NWHITE, false);
+		recorder.updateLeds();
+	}
+
+	LedBufferStorage target(LED_COUNT);
+	FrameStreamPlayer player(stream.data(), stream.size(), target, true);
+	uint32_t currentTime = 0;
+
+	player.start(currentTime);
+
+	RunBenchmark("FrameStreamPlayer::update", LED_COUNT, [&]() {
+		currentTime += frameInterval_us;
+		player.update(currentTime);
+	});
+
+	printf("{\"name\": \"FrameStream size\", \"bytes\": %zu, \"raw_bytes\": %zu}\n",
+		stream.size(), size_t(countFrames) * LED_COUNT * sizeof(RGBW));
+}
+
+static void BenchmarkAudioAnalyzer() {
+	static AudioAnalyzer analyzer(44100);
+	std::vector<int16_t> samples(AudioAnalyzer::HOP_SIZE * 16);
+
+	for (size_t i = 0; i < samples.size(); ++i) {
+		samples[i] = int16_t(8000.f * sinf(0.05f * i) + 4000.f * sinf(0.7f * i));
+	}
+
+	size_t offset = 0;
+
+	// One op is one hop (one FFT analysis), the reported pixel rate is the sample rate
+	RunBenchmark("AudioAnalyzer::pushSamples/hop", AudioAnalyzer::HOP_SIZE, [&]() {
+		analyzer.pushSamples(samples.data() + offset, AudioAnalyzer::HOP_SIZE);
+		offset = (offset + AudioAnalyzer::HOP_SIZE) % samples.size();
+	});
+}
+
+int main() {
+	BenchmarkRGBW();
+	BenchmarkColorParsing();
+	BenchmarkHueKernels();
+	BenchmarkPowerLimit();
+
+	for (size_t countAnimations : {100, 1000, 10000}) {
+		BenchmarkAnimationManager(countAnimations);
+		BenchmarkFadeAnimationBatch(countAnimations);
+	}
+
+	BenchmarkStaticAnimationManager();
+
+	BenchmarkCrossFade();
+	BenchmarkVirtualChain();
+	BenchmarkSimulatedPipeline();
+	BenchmarkFusedPipeline();
+	BenchmarkStaticPipeline();
+	BenchmarkPaletteAnimation();
+	BenchmarkProceduralEffects();
+	BenchmarkSceneVM();
+	BenchmarkFrameStreamPlayback();
+	BenchmarkAudioAnalyzer();
+
+	return 0;
+}
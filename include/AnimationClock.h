@@ -0,0 +1,114 @@
+#pragma once
+
+#include "Arduino.h"
+
+#include <stdint.h>
+
+/**
+ * Wrap-safe comparison of two millis() timestamps.
+ * Valid as long as both timestamps are less than ~24.8 days apart.
+ * \returns true when time a is before time b
+ */
+inline bool TimeBefore(uint32_t a, uint32_t b) {
+    return int32_t(a - b) < 0;
+}
+
+/**
+ * \returns true when currentTime reached (or passed) the given time, wrap-safe (see TimeBefore())
+ */
+inline bool TimeReached(uint32_t currentTime, uint32_t time) {
+    return !TimeBefore(currentTime, time);
+}
+
+/**
+ * Time source of the animations, with microsecond resolution.
+ */
+class IAnimationClock {
+    public:
+        virtual ~IAnimationClock() = default;
+
+        /**
+         * \returns the current time in microseconds, monotonic and without wrap around
+         */
+        virtual uint64_t nowMicros() = 0;
+};
+
+/**
+ * Clock using micros(), extended to 64 bits.
+ * Starts at the time since boot, the wrap arounds of micros() before the construction are taken from millis()
+ * (valid for the first ~49.7 days, the range of millis()).
+ * Must be called at least once per micros() period (~71 minutes) to detect every wrap around,
+ * which is always the case when it drives the animation updates.
+ */
+class ArduinoAnimationClock : public IAnimationClock {
+    private:
+        uint32_t lastMicros;
+        uint64_t high;
+
+    public:
+        /**
+         * Extends the micros() value to 64 bits, the number of wrap arounds is derived from millis().
+         * Both values must be taken at about the same time.
+         * \returns the 64 bit microseconds since boot
+         */
+        static uint64_t ExtendMicros(uint32_t currentMicros, uint32_t currentMillis) {
+            int64_t difference = int64_t(currentMillis) * 1000 - int64_t(currentMicros);
+
+            // Rounds to the nearest multiple of the micros() period, tolerates the time between both calls
+            int64_t countWraps = (difference + (int64_t(1) << 31)) >> 32;
+            return countWraps > 0 ? (uint64_t(countWraps) << 32) | currentMicros : currentMicros;
+        }
+
+        ArduinoAnimationClock() :
+            lastMicros(micros()),
+            high(ExtendMicros(lastMicros, millis()) & ~uint64_t(UINT32_MAX)) {}
+
+        virtual uint64_t nowMicros() override {
+            uint32_t current = micros();
+
+            if (current < lastMicros) {
+                high += uint64_t(1) << 32;
+            }
+
+            lastMicros = current;
+            return high | current;
+        }
+};
+
+/**
+ * Clock which only advances when told so, for deterministic tests and benchmarks.
+ */
+class ManualAnimationClock : public IAnimationClock {
+    private:
+        uint64_t now;
+        uint32_t frameRemainder;    // Accumulated fractions of a microsecond, in 1 / fps units
+
+    public:
+        ManualAnimationClock(uint64_t startMicros = 0) :
+            now(startMicros),
+            frameRemainder(0) {}
+
+        virtual uint64_t nowMicros() override {
+            return now;
+        }
+
+        void set(uint64_t micros) {
+            now = micros;
+            frameRemainder = 0;
+        }
+
+        void advance(uint64_t micros) {
+            now += micros;
+        }
+
+        /**
+         * Advances by the given number of frames, without drift for frame rates which do not divide a second
+         * (e.g. 240 frames at 240 fps advance exactly one second).
+         */
+        void advanceFrames(uint32_t countFrames, uint32_t fps) {
+            uint64_t total = uint64_t(countFrames) * 1000000 + frameRemainder;
+
+            now += total / fps;
+            frameRemainder = uint32_t(total % fps);
+        }
+};
@@ -1,12 +1,16 @@
 #pragma once
 
 #include "ILedStripWithStorage.h"
+#include "IAnimationWorkerPool.h"
+#include "LockFreeQueue.h"
+#include "Instrumentation.h"
+#include "AnimationClock.h"
 
 #include "Arduino.h"
 
-#include <set>
 #include <vector>
 #include <memory>
+#include <algorithm>
 
 #include "RGBW.h"
 
@@ -14,16 +18,28 @@ class AAnimation {
     protected:
         uint32_t startTime;
         uint32_t duration;
+        uint16_t frameMicros;   // Sub millisecond part of the current time, see setFrameMicros()
+        bool startReached;
 
     public:
+        /// Duration of animations which run until they are removed.
+        static constexpr uint32_t DURATION_INFINITE = UINT32_MAX;
+
         AAnimation(uint32_t startTime, uint32_t duration) :
             startTime(startTime),
-            duration(duration) {}
+            duration(duration),
+            frameMicros(0),
+            startReached(false) {}
+
+        virtual ~AAnimation() = default;
 
         uint32_t getStartTime() const {
             return startTime;
         }
 
+        /**
+         * \returns the end time, may wrap around. Use isFinished() for comparisons.
+         */
         uint32_t getEndTime() const {
             return startTime + duration;
         }
@@ -33,17 +49,44 @@ class AAnimation {
         }
 
         bool operator<(const AAnimation& other) const {
-            return startTime < other.startTime;
+            return TimeBefore(startTime, other.startTime);
+        }
+
+        /**
+         * Wrap-safe check whether the animation started. Once started, the animation stays started,
+         * so the elapsed time may exceed the range of the wrap-safe comparison (e.g. for infinite animations).
+         */
+        bool hasStarted(uint32_t currentTime) {
+            if (!startReached && TimeReached(currentTime, startTime)) {
+                startReached = true;
+            }
+
+            return startReached;
+        }
+
+        /**
+         * \returns true when the animation started and currentTime is after the end, never for infinite animations
+         */
+        bool isFinished(uint32_t currentTime) const {
+            return startReached && duration != DURATION_INFINITE && currentTime - startTime > duration;
+        }
+
+        /**
+         * Sets the sub millisecond part (0 - 999 us) of the time of the next update(), used by getFactor().
+         */
+        void setFrameMicros(uint16_t micros) {
+            frameMicros = micros;
         }
 
         float getFactor(uint32_t currentTime) const {
-            if (currentTime < getStartTime())
+            uint32_t elapsed = currentTime - startTime;
+
+            if (!startReached && int32_t(elapsed) < 0)
                 return 0.f;
-            if (currentTime >= getEndTime())
+            if (elapsed >= duration)
                 return 1.f;
 
-            uint32_t animationTime = getEndTime() - currentTime;
-            return 1.f - (float(animationTime) / float(getDuration()));
+            return float(uint64_t(elapsed) * 1000 + frameMicros) / (float(duration) * 1000.f);
         }
 
         virtual void update(uint32_t currentTime) = 0;
@@ -61,6 +104,15 @@ class ALedAnimation : public AAnimation {
         ILedStripWithStorage& getLedControl() const {
             return ledControl;
         }
+
+        /**
+         * \param out_index returns the led index, only defined when the return value is true.
+         * \returns true when this animation only affects a single led, false when it may affect any led.
+         */
+        virtual bool getAffectedLed(ledoffset_t& out_index) const {
+            (void)out_index;
+            return false;
+        }
 };
 
 class FadeAnimation : public ALedAnimation {
@@ -80,6 +132,11 @@ class FadeAnimation : public ALedAnimation {
             RGBW color = startColor.interpolateTo(endColor, getFactor(currentTime));
             ledControl.setLed(ledIndex, color);
         }
+
+        virtual bool getAffectedLed(ledoffset_t& out_index) const override {
+            out_index = ledIndex;
+            return true;
+        }
 };
 
 class FadeFromExistingAnimation : public FadeAnimation {
@@ -130,8 +187,7 @@ class BlinkAnimation : public ALedAnimation {
                 started = true;
             }
 
-            uint32_t deltaTime = startTime - currentTime;
-            deltaTime = deltaTime % 400;
+            uint32_t deltaTime = (currentTime - startTime) % 400;
 
             if (deltaTime <= 100) {
                 if (!active && countBlicks > 0) {
@@ -146,58 +202,379 @@ class BlinkAnimation : public ALedAnimation {
                 }
             }
         }
+
+        virtual bool getAffectedLed(ledoffset_t& out_index) const override {
+            out_index = ledIndex;
+            return true;
+        }
 };
 
 class AnimationManager {
     private:
         typedef std::unique_ptr<ALedAnimation> AnimationPtr;
 
+        /**
+         * Group of animations which are updated sequentially by one worker.
+         * Animations which may write the same led are always in the same partition.
+         */
+        struct Partition {
+            std::vector<size_t> animations;
+
+            Partition() :
+                animations() {}
+        };
+
         std::vector<AnimationPtr> queue;
+        LockFreeQueue<ALedAnimation*> submitQueue;
+
+        IAnimationWorkerPool* workerPool;
+        size_t minParallelAnimations;
+        IAnimationClock* clock;
+
+        // Buffers for the update, reused between updates
+        std::vector<Partition> partitions;
+        size_t countPartitions;
+        std::vector<ILedStripWithStorage*> strips;
+        std::vector<ILedStripWithStorage*> groupedStrips;                   // Strips of the cached grouping, see groupStrips()
+        std::vector<size_t> stripGroups;
+        std::vector<uint8_t> concurrentStrips;                              // 1 when all leaf strips support concurrent writes
+        std::vector<std::pair<ILedStripWithStorage*, size_t>> leafStrips;   // Leaf strip, index of the first strip using it
+        std::vector<size_t> groupPartitions;
+        std::vector<uint8_t> groupSplittable;
+        std::vector<uint8_t> finished;
+        std::vector<size_t> dropIndex;
+
+        /// Moves all submitted animations into the queue.
+        void drainSubmitQueue() {
+            ALedAnimation* ptr;
+
+            while (submitQueue.pop(ptr)) {
+                queue.emplace_back(ptr);
+            }
+        }
 
-    public:
-        AnimationManager() :
-            queue() {}
+        /// Removes the animations in dropIndex (ascending order) from the queue.
+        void dropFinished() {
+            while (!dropIndex.empty()) {
+                size_t lastEntry = *dropIndex.rbegin();
 
-        void update() {
-            update(millis());
+                queue.erase(queue.begin() + lastEntry);
+                dropIndex.erase(dropIndex.begin() + dropIndex.size() - 1);
+            }
         }
 
-        void update(uint32_t currentTime) {
-            std::vector<size_t> dropIndex;
-            std::set<ILedStripWithStorage*> affectedLeds;
+        size_t getStripIndex(ILedStripWithStorage* strip) {
+            auto iter = std::find(strips.begin(), strips.end(), strip);
+
+            if (iter != strips.end()) {
+                return iter - strips.begin();
+            }
 
-            for (size_t i = 0; i < queue.size(); ++i) {
-                AnimationPtr& ptr = queue[i];
+            strips.push_back(strip);
+            return strips.size() - 1;
+        }
 
-                if (currentTime < ptr->getStartTime())
-                    continue;
+        size_t findGroup(size_t stripIndex) const {
+            while (stripGroups[stripIndex] != stripIndex) {
+                stripIndex = stripGroups[stripIndex];
+            }
 
-                if (currentTime > ptr->getEndTime()) {
-                    dropIndex.push_back(i);
+            return stripIndex;
+        }
+
+        /**
+         * Groups the affected strips, strips which share physical leds
+         * (resolved via ILedStripWithStorage::resolveLed()) end up in the same group.
+         * The led mapping of virtual strips is fixed, so the grouping is only rebuilt when the affected strips change.
+         */
+        void groupStrips() {
+            if (strips == groupedStrips) {
+                return;
+            }
+
+            groupedStrips = strips;
+            leafStrips.clear();
+            stripGroups.resize(strips.size());
+            concurrentStrips.assign(strips.size(), true);
+
+            for (size_t i = 0; i < strips.size(); ++i) {
+                ILedStripWithStorage* previousLeaf = nullptr;
+
+                stripGroups[i] = i;
+
+                for (ledoffset_t led = 0; led < strips[i]->getLedCount(); ++led) {
+                    ledoffset_t index = led;
+                    ILedStripWithStorage* leaf = &strips[i]->resolveLed(index);
+
+                    // Neighbouring leds are usually stored in the same leaf, which is already grouped
+                    if (leaf == previousLeaf) {
+                        continue;
+                    }
+
+                    previousLeaf = leaf;
+
+                    if (!leaf->supportsConcurrentWrites()) {
+                        concurrentStrips[i] = false;
+                    }
+
+                    auto iter = std::find_if(leafStrips.begin(), leafStrips.end(), [&](const std::pair<ILedStripWithStorage*, size_t>& entry) {
+                        return entry.first == leaf;
+                    });
+
+                    if (iter == leafStrips.end()) {
+                        leafStrips.push_back({leaf, i});
+                        continue;
+                    }
+
+                    size_t groupA = findGroup(iter->second);
+                    size_t groupB = findGroup(i);
+
+                    if (groupA != groupB) {
+                        stripGroups[std::max(groupA, groupB)] = std::min(groupA, groupB);
+                    }
                 }
+            }
+        }
+
+        void updateSerial(uint32_t currentTime, uint16_t frameMicros) {
+            // Member buffers, so the update does not allocate once they reached their size
+            dropIndex.clear();
+            strips.clear();
 
-                ptr->update(currentTime);
-                affectedLeds.insert(&(ptr->getLedControl()));
+            {
+                ScopedStageTimer timer(InstrumentationStage::AnimationUpdate);
+
+                for (size_t i = 0; i < queue.size(); ++i) {
+                    AnimationPtr& ptr = queue[i];
+
+                    if (!ptr->hasStarted(currentTime))
+                        continue;
+
+                    if (ptr->isFinished(currentTime)) {
+                        dropIndex.push_back(i);
+                    }
+
+                    ptr->setFrameMicros(frameMicros);
+                    ptr->update(currentTime);
+                    getStripIndex(&(ptr->getLedControl()));
+                }
             }
 
-            for (ILedStripWithStorage* ledControl : affectedLeds) {
+            for (ILedStripWithStorage* ledControl : strips) {
                 ledControl->updateLeds();
             }
 
-            while (!dropIndex.empty()) {
-                size_t lastEntry = *dropIndex.rbegin();
+            dropFinished();
+        }
 
-                queue.erase(queue.begin() + lastEntry);
-                dropIndex.erase(dropIndex.begin() + dropIndex.size() - 1);
+        void updateParallel(uint32_t currentTime, uint16_t frameMicros) {
+            const size_t countWorkers = workerPool->getWorkerCount();
+
+            {
+                ScopedStageTimer timer(InstrumentationStage::AnimationUpdate);
+
+                strips.clear();
+                countPartitions = 0;
+                finished.assign(queue.size(), 0);
+
+                // Step 1: Collect all affected strips (in order of the first animation)
+                for (size_t i = 0; i < queue.size(); ++i) {
+                    if (queue[i]->hasStarted(currentTime)) {
+                        getStripIndex(&queue[i]->getLedControl());
+                    }
+                }
+
+                groupStrips();
+
+                // Step 2: Create the partitions, groups with only one strip whose leaf strips support concurrent writes
+                // are split by ranges of the leaf leds
+                groupPartitions.assign(strips.size(), SIZE_MAX);
+                groupSplittable.assign(strips.size(), true);
+
+                for (size_t i = 0; i < strips.size(); ++i) {
+                    if (findGroup(i) != i || !concurrentStrips[i]) {
+                        groupSplittable[findGroup(i)] = false;
+                    }
+                }
+
+                for (size_t i = 0; i < queue.size(); ++i) {
+                    const AnimationPtr& ptr = queue[i];
+                    ledoffset_t led;
+
+                    if (ptr->hasStarted(currentTime) && !ptr->getAffectedLed(led)) {
+                        groupSplittable[findGroup(getStripIndex(&ptr->getLedControl()))] = false;
+                    }
+                }
+
+                for (size_t i = 0; i < strips.size(); ++i) {
+                    if (findGroup(i) == i) {
+                        groupPartitions[i] = countPartitions;
+                        countPartitions += groupSplittable[i] ? countWorkers : 1;
+                    }
+                }
+
+                // Keeps the capacity of the partitions of previous updates
+                if (partitions.size() < countPartitions) {
+                    partitions.resize(countPartitions);
+                }
+
+                for (size_t i = 0; i < countPartitions; ++i) {
+                    partitions[i].animations.clear();
+                }
+
+                // Step 3: Assign the animations, keeping the queue order within each partition
+                for (size_t i = 0; i < queue.size(); ++i) {
+                    const AnimationPtr& ptr = queue[i];
+
+                    if (!ptr->hasStarted(currentTime))
+                        continue;
+
+                    ILedStripWithStorage& ledControl = ptr->getLedControl();
+                    size_t group = findGroup(getStripIndex(&ledControl));
+                    size_t partition = groupPartitions[group];
+
+                    // Split by the resolved leaf led, so virtual leds which share a physical led stay in one partition
+                    ledoffset_t led;
+                    if (groupSplittable[group] && ptr->getAffectedLed(led)) {
+                        ILedStripWithStorage& leaf = ledControl.resolveLed(led);
+
+                        partition += std::min<size_t>(countWorkers - 1, size_t(led) * countWorkers / std::max<size_t>(1, leaf.getLedCount()));
+                    }
+
+                    partitions[partition].animations.push_back(i);
+                }
+
+                // Step 4: Update all partitions in parallel
+                workerPool->run(countPartitions, [&](size_t partitionIndex) {
+                    for (size_t i : partitions[partitionIndex].animations) {
+                        AnimationPtr& ptr = queue[i];
+
+                        finished[i] = ptr->isFinished(currentTime);
+                        ptr->setFrameMicros(frameMicros);
+                        ptr->update(currentTime);
+                    }
+                });
+            }
+
+            // Step 5: Flush every affected strip once, after all partitions are done
+            for (ILedStripWithStorage* ledControl : strips) {
+                ledControl->updateLeds();
+            }
+
+            dropIndex.clear();
+
+            for (size_t i = 0; i < finished.size(); ++i) {
+                if (finished[i]) {
+                    dropIndex.push_back(i);
+                }
+            }
+
+            dropFinished();
+        }
+
+    public:
+        /**
+         * \param submitQueueCapacity maximum number of animations which can be pending via submitAnimation()
+         */
+        AnimationManager(size_t submitQueueCapacity = 32) :
+            queue(),
+            submitQueue(submitQueueCapacity),
+            workerPool(nullptr),
+            minParallelAnimations(64),
+            clock(nullptr),
+            partitions(),
+            countPartitions(0),
+            strips(),
+            groupedStrips(),
+            stripGroups(),
+            concurrentStrips(),
+            leafStrips(),
+            groupPartitions(),
+            groupSplittable(),
+            finished(),
+            dropIndex() {}
+
+        AnimationManager(const AnimationManager&) = delete;
+        AnimationManager& operator=(const AnimationManager&) = delete;
+
+        ~AnimationManager() {
+            drainSubmitQueue();
+        }
+
+        /**
+         * Enables the parallel update of the animations via the given worker pool.
+         * Animations on strips which share leds are updated in the same partition in queue order,
+         * animations on a single led (e.g. FadeAnimation) are additionally split by led ranges
+         * when the strip supports it (see ILedStripWithStorage::supportsConcurrentWrites()).
+         * Each strip is flushed once on the calling thread, after all partitions are done.
+         * \param pool the worker pool to use, nullptr to disable the parallel update
+         * \param minAnimations minimum number of animations to use the parallel update at all
+         */
+        void setWorkerPool(IAnimationWorkerPool* pool, size_t minAnimations = 64) {
+            workerPool = pool;
+            minParallelAnimations = minAnimations;
+        }
+
+        /**
+         * Sets the time source of update(), nullptr to use millis().
+         */
+        void setClock(IAnimationClock* newClock) {
+            clock = newClock;
+        }
+
+        /**
+         * Updates the animations with the time of the clock (see setClock()), or millis() without clock.
+         */
+        void update() {
+            if (clock) {
+                updateMicros(clock->nowMicros());
+            } else {
+                update(millis());
             }
         }
 
+        void update(uint32_t currentTime) {
+            update(currentTime, 0);
+        }
+
+        /**
+         * Updates the animations with microsecond resolution, the animation times stay in milliseconds
+         * (wrapping like millis()) and the remainder is passed via AAnimation::setFrameMicros().
+         */
+        void updateMicros(uint64_t currentMicros) {
+            update(uint32_t(currentMicros / 1000), uint16_t(currentMicros % 1000));
+        }
+
+        void update(uint32_t currentTime, uint16_t frameMicros) {
+            drainSubmitQueue();
+
+            if (workerPool && queue.size() >= minParallelAnimations) {
+                updateParallel(currentTime, frameMicros);
+            } else {
+                updateSerial(currentTime, frameMicros);
+            }
+        }
+
+        /**
+         * Adds the animation, takes ownership of the pointer.
+         * Must be called from the thread which calls update().
+         */
         void addAnimation(ALedAnimation* ptr) {
             queue.emplace_back(std::move(ptr));
         }
 
+        /**
+         * Submits the animation from any thread or interrupt handler, never blocks.
+         * The animation is added at the begin of the next update().
+         * \returns true on success (takes ownership of the pointer),
+         * false when the submit queue is full (the caller keeps the ownership).
+         */
+        bool submitAnimation(ALedAnimation* ptr) {
+            return submitQueue.push(ptr);
+        }
+
         bool empty() const {
-            return queue.empty();
+            return queue.empty() && submitQueue.empty();
         }
 
         /**
@@ -205,6 +582,7 @@ class AnimationManager {
          * Note that the end color of animations will not be applied.
          */
         void clear() {
+            drainSubmitQueue();
             queue.clear();
         }
 };
@@ -0,0 +1,132 @@
+#pragma once
+
+#include "IAnimationWorkerPool.h"
+
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+#include <vector>
+
+/**
+* Worker pool implementation based on std::thread.
+* On the ESP32 the threads are mapped to FreeRTOS tasks by the pthread layer.
+* The calling thread of run() also executes tasks, so a pool with n threads runs n + 1 tasks in parallel.
+*/
+class AnimationWorkerPool : public IAnimationWorkerPool {
+    private:
+        std::vector<std::thread> threads;
+
+        std::mutex mutex;
+        std::condition_variable startCondition;
+        std::condition_variable doneCondition;
+
+        const std::function<void(size_t)>* task;
+        size_t taskCount;
+        size_t nextTask;
+        size_t finishedTasks;
+        uint32_t generation;
+        bool stopping;
+
+        /// Executes tasks of the current run until none is left, expects the mutex to be locked.
+        void executeTasks(std::unique_lock<std::mutex>& lock) {
+            while (nextTask < taskCount) {
+                size_t taskIndex = nextTask++;
+
+                lock.unlock();
+                (*task)(taskIndex);
+                lock.lock();
+
+                if (++finishedTasks == taskCount) {
+                    doneCondition.notify_all();
+                }
+            }
+        }
+
+        void workerLoop() {
+            std::unique_lock<std::mutex> lock(mutex);
+            uint32_t lastGeneration = generation;
+
+            while (true) {
+                startCondition.wait(lock, [&]() {
+                    return stopping || generation != lastGeneration;
+                });
+
+                if (stopping) {
+                    return;
+                }
+
+                lastGeneration = generation;
+                executeTasks(lock);
+            }
+        }
+
+        static size_t GetDefaultThreadCount() {
+            unsigned int countCores = std::thread::hardware_concurrency();
+            return countCores > 1 ? countCores - 1 : 1;
+        }
+
+    public:
+        AnimationWorkerPool(size_t countThreads = GetDefaultThreadCount()) :
+            threads(),
+            mutex(),
+            startCondition(),
+            doneCondition(),
+            task(nullptr),
+            taskCount(0),
+            nextTask(0),
+            finishedTasks(0),
+            generation(0),
+            stopping(false) {
+
+            for (size_t i = 0; i < countThreads; ++i) {
+                threads.emplace_back(&AnimationWorkerPool::workerLoop, this);
+            }
+        }
+
+        AnimationWorkerPool(const AnimationWorkerPool&) = delete;
+        AnimationWorkerPool& operator=(const AnimationWorkerPool&) = delete;
+
+        virtual ~AnimationWorkerPool() {
+            {
+                std::lock_guard<std::mutex> lock(mutex);
+                stopping = true;
+            }
+
+            startCondition.notify_all();
+
+            for (std::thread& thread : threads) {
+                thread.join();
+            }
+        }
+
+        virtual size_t getWorkerCount() const override {
+            return threads.size() + 1;
+        }
+
+        virtual void run(size_t count, const std::function<void(size_t)>& func) override {
+            if (count == 0) {
+                return;
+            }
+
+            std::unique_lock<std::mutex> lock(mutex);
+
+            task = &func;
+            taskCount = count;
+            nextTask = 0;
+            finishedTasks = 0;
+            generation++;
+
+            startCondition.notify_all();
+
+            // Work on the tasks as well instead of only waiting
+            executeTasks(lock);
+
+            doneCondition.wait(lock, [&]() {
+                return finishedTasks == taskCount;
+            });
+
+            task = nullptr;
+            taskCount = 0;
+            nextTask = 0;
+        }
+};
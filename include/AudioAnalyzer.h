@@ -0,0 +1,542 @@
+#pragma once
+
+#include "ProceduralEffects.h"
+#include "MappedFile.h"
+#include "Instrumentation.h"
+
+#include <array>
+#include <atomic>
+#include <algorithm>
+#include <math.h>
+#include <string.h>
+
+/**
+* Audio analysis for sound reactive animations.
+* PCM samples are pushed in blocks (e.g. from I2S, a WAV file or an in-memory buffer), every HOP_SIZE samples
+* a fixed point FFT over the last FFT_SIZE samples updates the band levels and the beat detection.
+* At 44.1 kHz one analysis covers 11.6 ms and runs every 5.8 ms.
+*
+* The results are atomics, so animations on other threads read them without locks, see getLevel().
+* Each value is consistent on its own, values of different bands may be from consecutive analyses.
+*/
+
+/**
+* \returns log2(value) as 8.8 fixed point value, the fraction is linearly approximated. 0 for values <= 1.
+*/
+inline uint16_t Log2Q8(uint64_t value) {
+    if (value <= 1) {
+        return 0;
+    }
+
+    uint16_t exponent = 0;
+
+    while ((value >> exponent) > 1) {
+        exponent++;
+    }
+
+    uint16_t fraction = exponent >= 8 ? (value >> (exponent - 8)) & 0xFF : (value << (8 - exponent)) & 0xFF;
+    return (exponent << 8) | fraction;
+}
+
+/**
+* In-place radix-2 FFT in Q15 fixed point. Each stage scales by 1/2, so the result is scaled by 1 / SIZE and never overflows.
+*/
+struct AudioFFT {
+    static constexpr size_t SIZE = 512;
+    static constexpr float ANGLE_STEP = 2.f * 3.14159265f / SIZE;
+
+    /**
+     * \returns sin(2 pi i / SIZE) as Q15 for i in [0, 3/4 SIZE), the cosine is at offset SIZE / 4.
+     */
+    static const std::array<int16_t, SIZE * 3 / 4>& GetSineTable() {
+        static const std::array<int16_t, SIZE * 3 / 4> SineTable = []() {
+            std::array<int16_t, SIZE * 3 / 4> table;
+
+            for (size_t i = 0; i < table.size(); ++i) {
+                table[i] = int16_t(lroundf(sinf(ANGLE_STEP * i) * 32767.f));
+            }
+
+            return table;
+        }();
+
+        return SineTable;
+    }
+
+    /**
+     * \returns the Hann window as Q15.
+     */
+    static const std::array<int16_t, SIZE>& GetWindow() {
+        static const std::array<int16_t, SIZE> Window = []() {
+            std::array<int16_t, SIZE> table;
+
+            for (size_t i = 0; i < table.size(); ++i) {
+                table[i] = int16_t(lroundf((0.5f - 0.5f * cosf(ANGLE_STEP * i)) * 32767.f));
+            }
+
+            return table;
+        }();
+
+        return Window;
+    }
+
+    static void Transform(int16_t* real, int16_t* imag) {
+        // Bit reversed order
+        for (size_t i = 1, j = 0; i < SIZE; ++i) {
+            size_t bit = SIZE >> 1;
+
+            for (; j & bit; bit >>= 1) {
+                j ^= bit;
+            }
+
+            j ^= bit;
+
+            if (i < j) {
+                std::swap(real[i], real[j]);
+                std::swap(imag[i], imag[j]);
+            }
+        }
+
+        const int16_t* sine = GetSineTable().data();
+
+        for (size_t length = 2; length <= SIZE; length <<= 1) {
+            const size_t half = length >> 1;
+            const size_t step = SIZE / length;
+
+            for (size_t start = 0; start < SIZE; start += length) {
+                for (size_t k = 0; k < half; ++k) {
+                    const int32_t wr = sine[k * step + SIZE / 4];
+                    const int32_t wi = -sine[k * step];
+                    const size_t a = start + k;
+                    const size_t b = a + half;
+
+                    int32_t tr = (wr * real[b] - wi * imag[b]) >> 15;
+                    int32_t ti = (wr * imag[b] + wi * real[b]) >> 15;
+
+                    real[b] = int16_t((real[a] - tr) >> 1);
+                    imag[b] = int16_t((imag[a] - ti) >> 1);
+                    real[a] = int16_t((real[a] + tr) >> 1);
+                    imag[a] = int16_t((imag[a] + ti) >> 1);
+                }
+            }
+        }
+    }
+};
+
+/**
+* PCM data of a WAV file, see ParseWav().
+*/
+struct WavInfo {
+    uint32_t sampleRate;
+    uint16_t channels;
+    uint16_t bitsPerSample;
+    const uint8_t* samples;     // Interleaved, little endian
+    size_t frameCount;
+};
+
+/**
+* Parses the header of a 16 bit PCM WAV file in memory (e.g. a MappedFile).
+* \param out_info returns the format and the sample data, which points into data
+* \returns false when the data is no 16 bit PCM WAV file
+*/
+inline bool ParseWav(const uint8_t* data, size_t size, WavInfo& out_info) {
+    auto readU16 = [](const uint8_t* ptr) -> uint16_t {
+        return ptr[0] | (ptr[1] << 8);
+    };
+    auto readU32 = [](const uint8_t* ptr) -> uint32_t {
+        return ptr[0] | (ptr[1] << 8) | (ptr[2] << 16) | (uint32_t(ptr[3]) << 24);
+    };
+
+    if (size < 12 || memcmp(data, "RIFF", 4) != 0 || memcmp(data + 8, "WAVE", 4) != 0) {
+        return false;
+    }
+
+    bool hasFormat = false;
+    size_t offset = 12;
+
+    while (offset + 8 <= size) {
+        const uint8_t* chunk = data + offset;
+        const size_t chunkSize = readU32(chunk + 4);
+        const size_t available = std::min(chunkSize, size - offset - 8);
+
+        if (memcmp(chunk, "fmt ", 4) == 0) {
+            if (available < 16) {
+                return false;
+            }
+
+            uint16_t format = readU16(chunk + 8);
+
+            out_info.channels = readU16(chunk + 10);
+            out_info.sampleRate = readU32(chunk + 12);
+            out_info.bitsPerSample = readU16(chunk + 22);
+
+            // PCM or WAVE_FORMAT_EXTENSIBLE
+            if ((format != 1 && format != 0xFFFE) || out_info.bitsPerSample != 16 || out_info.channels == 0 || out_info.sampleRate == 0) {
+                return false;
+            }
+
+            hasFormat = true;
+        } else if (memcmp(chunk, "data", 4) == 0 && hasFormat) {
+            out_info.samples = chunk + 8;
+            out_info.frameCount = available / (2 * out_info.channels);
+            return true;
+        }
+
+        offset += 8 + chunkSize + (chunkSize & 1);
+    }
+
+    return false;
+}
+
+class AudioAnalyzer {
+    public:
+        static constexpr size_t FFT_SIZE = AudioFFT::SIZE;
+        static constexpr size_t HOP_SIZE = FFT_SIZE / 2;
+        static constexpr uint8_t BAND_COUNT = 16;
+
+        static constexpr float MIN_FREQUENCY = 40.f;
+        static constexpr float MAX_FREQUENCY = 16000.f;
+
+        /// Frequency range of the beat detection (kick drum and bass).
+        static constexpr float BEAT_MIN_FREQUENCY = 40.f;
+        static constexpr float BEAT_MAX_FREQUENCY = 160.f;
+
+    private:
+        static constexpr size_t BEAT_HISTORY = 128;            // ~0.75 s at 44.1 kHz
+        static constexpr uint16_t BEAT_THRESHOLD = 128;         // Over the average (log2, 8.8), 1.41 times the energy
+        static constexpr uint32_t BEAT_MIN_INTERVAL_MS = 200;
+        static constexpr uint32_t DECAY_PER_SECOND = 1024;      // Level units
+
+        uint32_t sampleRate;
+
+        // Sample ring buffer
+        std::array<int16_t, FFT_SIZE> samples;
+        size_t writeIndex;
+        size_t pendingSamples;
+
+        // FFT working buffers
+        std::array<int16_t, FFT_SIZE> real;
+        std::array<int16_t, FFT_SIZE> imag;
+
+        // Bins [bandBins[i], bandBins[i + 1]) belong to band i
+        std::array<uint16_t, BAND_COUNT + 1> bandBins;
+        uint16_t beatFirstBin;
+        uint16_t beatLastBin;
+
+        uint16_t levelFloor;        // log2 8.8 of the energy for level 0
+        uint16_t levelRange;        // log2 8.8 range up to level 255
+        uint8_t decayPerHop;
+
+        std::array<uint16_t, BEAT_HISTORY> beatHistory;
+        uint32_t beatHistorySum;
+        size_t beatHistoryIndex;
+        size_t beatHistoryCount;
+        uint32_t samplesSinceBeat;
+        bool aboveThreshold;
+
+        std::array<std::atomic<uint8_t>, BAND_COUNT> levels;
+        std::atomic<uint8_t> volume;
+        std::atomic<uint8_t> beatLevel;
+        std::atomic<uint32_t> beatCount;
+        std::atomic<uint32_t> analysisCount;
+
+        uint8_t toLevel(uint64_t energy) const {
+            uint16_t log2 = Log2Q8(energy);
+
+            if (log2 <= levelFloor) {
+                return 0;
+            }
+
+            return uint8_t(std::min<uint32_t>(255, uint32_t(log2 - levelFloor) * 255 / levelRange));
+        }
+
+        static void Decay(std::atomic<uint8_t>& value, uint8_t target, uint8_t decay) {
+            uint8_t current = value.load(std::memory_order_relaxed);
+
+            current = current > decay ? current - decay : 0;
+            value.store(std::max(current, target), std::memory_order_relaxed);
+        }
+
+        void detectBeat(uint64_t energy) {
+            const uint16_t log2 = Log2Q8(energy);
+            const uint16_t average = beatHistoryCount > 0 ? beatHistorySum / beatHistoryCount : log2;
+            const bool above = beatHistoryCount == BEAT_HISTORY && log2 > levelFloor && log2 > average + BEAT_THRESHOLD;
+
+            samplesSinceBeat = std::min<uint32_t>(samplesSinceBeat + HOP_SIZE, UINT32_MAX / 2);
+
+            // Rising edge only, at most one beat per minimum interval
+            if (above && !aboveThreshold && uint64_t(samplesSinceBeat) * 1000 >= uint64_t(BEAT_MIN_INTERVAL_MS) * sampleRate) {
+                samplesSinceBeat = 0;
+                beatCount.fetch_add(1, std::memory_order_relaxed);
+                beatLevel.store(255, std::memory_order_relaxed);
+            } else {
+                Decay(beatLevel, 0, decayPerHop);
+            }
+
+            aboveThreshold = above;
+
+            if (beatHistoryCount == BEAT_HISTORY) {
+                beatHistorySum -= beatHistory[beatHistoryIndex];
+            } else {
+                beatHistoryCount++;
+            }
+
+            beatHistory[beatHistoryIndex] = log2;
+            beatHistorySum += log2;
+            beatHistoryIndex = (beatHistoryIndex + 1) % BEAT_HISTORY;
+        }
+
+        void analyze() {
+            ScopedStageTimer timer(InstrumentationStage::AudioAnalysis);
+
+            const std::array<int16_t, FFT_SIZE>& window = AudioFFT::GetWindow();
+
+            for (size_t i = 0; i < FFT_SIZE; ++i) {
+                real[i] = int16_t((int32_t(samples[(writeIndex + i) % FFT_SIZE]) * window[i]) >> 15);
+                imag[i] = 0;
+            }
+
+            AudioFFT::Transform(real.data(), imag.data());
+
+            uint64_t total = 0;
+            uint64_t beatEnergy = 0;
+            uint16_t bin = bandBins[0];
+
+            for (uint8_t band = 0; band < BAND_COUNT; ++band) {
+                uint64_t energy = 0;
+
+                for (; bin < bandBins[band + 1]; ++bin) {
+                    uint32_t power = uint32_t(int32_t(real[bin]) * real[bin]) + uint32_t(int32_t(imag[bin]) * imag[bin]);
+
+                    energy += power;
+
+                    if (bin >= beatFirstBin && bin <= beatLastBin) {
+                        beatEnergy += power;
+                    }
+                }
+
+                total += energy;
+                Decay(levels[band], toLevel(energy), decayPerHop);
+            }
+
+            Decay(volume, toLevel(total), decayPerHop);
+            detectBeat(beatEnergy);
+
+            analysisCount.fetch_add(1, std::memory_order_release);
+        }
+
+        void pushSample(int16_t sample) {
+            samples[writeIndex] = sample;
+            writeIndex = (writeIndex + 1) % FFT_SIZE;
+
+            if (++pendingSamples == HOP_SIZE) {
+                pendingSamples = 0;
+                analyze();
+            }
+        }
+
+        uint16_t toBin(float frequency) const {
+            return uint16_t(std::min<float>(FFT_SIZE / 2, lroundf(frequency * FFT_SIZE / sampleRate)));
+        }
+
+    public:
+        AudioAnalyzer(uint32_t sampleRate = 44100) :
+            sampleRate(0),
+            samples(),
+            writeIndex(0),
+            pendingSamples(0),
+            real(),
+            imag(),
+            bandBins(),
+            beatFirstBin(0),
+            beatLastBin(0),
+            levelFloor(10 << 8),
+            levelRange(16 << 8),
+            decayPerHop(0),
+            beatHistory(),
+            beatHistorySum(0),
+            beatHistoryIndex(0),
+            beatHistoryCount(0),
+            samplesSinceBeat(UINT32_MAX / 2),
+            aboveThreshold(false),
+            levels(),
+            volume(0),
+            beatLevel(0),
+            beatCount(0),
+            analysisCount(0) {
+
+            setSampleRate(sampleRate);
+        }
+
+        AudioAnalyzer(const AudioAnalyzer&) = delete;
+        AudioAnalyzer& operator=(const AudioAnalyzer&) = delete;
+
+        /**
+         * Sets the sample rate and computes the band ranges: BAND_COUNT logarithmically spaced bands
+         * between MIN_FREQUENCY and MAX_FREQUENCY (at most half the sample rate), each with at least one FFT bin.
+         * Must be called from the thread which pushes the samples.
+         */
+        void setSampleRate(uint32_t newSampleRate) {
+            sampleRate = newSampleRate;
+
+            const float maxFrequency = std::min(MAX_FREQUENCY, sampleRate / 2.f);
+
+            for (uint8_t band = 0; band <= BAND_COUNT; ++band) {
+                float frequency = MIN_FREQUENCY * powf(maxFrequency / MIN_FREQUENCY, float(band) / BAND_COUNT);
+                uint16_t minBin = band > 0 ? bandBins[band - 1] + 1 : 1;
+
+                bandBins[band] = std::max(toBin(frequency), minBin);
+            }
+
+            beatFirstBin = std::max<uint16_t>(1, toBin(BEAT_MIN_FREQUENCY));
+            beatLastBin = std::max(beatFirstBin, toBin(BEAT_MAX_FREQUENCY));
+            decayPerHop = uint8_t(std::max<uint32_t>(1, DECAY_PER_SECOND * HOP_SIZE / sampleRate));
+        }
+
+        uint32_t getSampleRate() const {
+            return sampleRate;
+        }
+
+        /**
+         * Sets the energy range which is mapped to the levels 0 - 255, as log2 of the band energy
+         * (a full scale sine is about 2^26, the default range is 2^10 - 2^26, i.e. 48 dB).
+         */
+        void setLevelRange(uint8_t floorLog2, uint8_t ceilingLog2) {
+            levelFloor = floorLog2 << 8;
+            levelRange = std::max(1, ceilingLog2 - floorLog2) << 8;
+        }
+
+        /**
+         * Adds samples, analyzes every HOP_SIZE samples.
+         * Must always be called from the same thread (e.g. the I2S reader task).
+         * \param frames number of frames, each with channels interleaved samples which are mixed to mono
+         */
+        void pushSamples(const int16_t* data, size_t frames, uint8_t channels = 1) {
+            for (size_t i = 0; i < frames; ++i, data += channels) {
+                int32_t sum = 0;
+
+                for (uint8_t channel = 0; channel < channels; ++channel) {
+                    sum += data[channel];
+                }
+
+                pushSample(int16_t(sum / channels));
+            }
+        }
+
+        /**
+         * Adds 32 bit samples (e.g. from I2S with 24 or 32 bit slots), only the upper 16 bits are used.
+         */
+        void pushSamples(const int32_t* data, size_t frames, uint8_t channels = 1) {
+            for (size_t i = 0; i < frames; ++i, data += channels) {
+                int32_t sum = 0;
+
+                for (uint8_t channel = 0; channel < channels; ++channel) {
+                    sum += data[channel] >> 16;
+                }
+
+                pushSample(int16_t(sum / channels));
+            }
+        }
+
+        /**
+         * Adds frames of a WAV file, see ParseWav(). Set the sample rate of the file via setSampleRate() first.
+         * \returns the number of frames added, less than countFrames at the end of the file
+         */
+        size_t pushWav(const WavInfo& wav, size_t firstFrame, size_t countFrames) {
+            static constexpr size_t CHUNK_FRAMES = 64;
+
+            int16_t chunk[CHUNK_FRAMES];
+            const size_t endFrame = std::min(wav.frameCount, firstFrame + countFrames);
+
+            for (size_t frame = firstFrame; frame < endFrame; ) {
+                const size_t chunkFrames = std::min(CHUNK_FRAMES, endFrame - frame);
+                const uint8_t* input = wav.samples + frame * wav.channels * 2;
+
+                for (size_t i = 0; i < chunkFrames; ++i) {
+                    int32_t sum = 0;
+
+                    for (uint16_t channel = 0; channel < wav.channels; ++channel, input += 2) {
+                        sum += int16_t(input[0] | (input[1] << 8));
+                    }
+
+                    chunk[i] = int16_t(sum / wav.channels);
+                }
+
+                pushSamples(chunk, chunkFrames);
+                frame += chunkFrames;
+            }
+
+            return endFrame > firstFrame ? endFrame - firstFrame : 0;
+        }
+
+        /**
+         * \returns the level (0 - 255) of the band, 0 is the lowest frequency. Lock free, callable from any thread.
+         */
+        uint8_t getLevel(uint8_t band) const {
+            return levels[band].load(std::memory_order_relaxed);
+        }
+
+        /**
+         * \param output array with at least BAND_COUNT entries
+         */
+        void getLevels(uint8_t* output) const {
+            for (uint8_t band = 0; band < BAND_COUNT; ++band) {
+                output[band] = levels[band].load(std::memory_order_relaxed);
+            }
+        }
+
+        /// \returns the level (0 - 255) of all bands together.
+        uint8_t getVolume() const {
+            return volume.load(std::memory_order_relaxed);
+        }
+
+        /// \returns 255 on a beat, decays like the levels until the next beat.
+        uint8_t getBeatLevel() const {
+            return beatLevel.load(std::memory_order_relaxed);
+        }
+
+        /// \returns the number of detected beats, compare with a previous value to react once per beat.
+        uint32_t getBeatCount() const {
+            return beatCount.load(std::memory_order_relaxed);
+        }
+
+        /// \returns the number of analyses so far.
+        uint32_t getAnalysisCount() const {
+            return analysisCount.load(std::memory_order_acquire);
+        }
+
+        /// \returns the center frequency of the band in Hz.
+        float getBandFrequency(uint8_t band) const {
+            return sqrtf(float(bandBins[band]) * float(bandBins[band + 1])) * sampleRate / FFT_SIZE;
+        }
+};
+
+/**
+* Spectrum display: the bands are spread over the effect range (low frequencies first),
+* each led shows the hue of its band with the brightness of the band level.
+* Reads the levels lock free, so the analyzer may run on another thread.
+*/
+class AudioSpectrumEffect : public AProceduralEffect {
+    private:
+        const AudioAnalyzer& analyzer;
+
+    protected:
+        virtual void render(RGBW* output, ledoffset_t offset, ledoffset_t count, uint32_t time) override {
+            (void)time;
+
+            const std::array<RGBW, 256>& hueTable = RGBW::GetHueTable();
+            const ledoffset_t ledCount = getEffectLedCount();
+
+            for (ledoffset_t i = 0; i < count; ++i) {
+                uint8_t band = uint16_t(offset + i) * AudioAnalyzer::BAND_COUNT / ledCount;
+                uint8_t level = analyzer.getLevel(band);
+                RGBW hue = hueTable[band * 256 / AudioAnalyzer::BAND_COUNT];
+
+                output[i] = RGBW(Scale8(hue.r, level), Scale8(hue.g, level), Scale8(hue.b, level), 0);
+            }
+        }
+
+    public:
+        AudioSpectrumEffect(uint32_t startTime, uint32_t duration, ILedStripWithStorage& ledControl, const AudioAnalyzer& analyzer, ledoffset_t firstLed = 0, ledoffset_t ledCount = 0) :
+            AProceduralEffect(startTime, duration, ledControl, firstLed, ledCount),
+            analyzer(analyzer) {}
+};
@@ -1,5 +1,7 @@
 #pragma once
 
+#include <stddef.h>
+
 /**
 * Helper struct to define, which color channels are active / useable.
 */
@@ -0,0 +1,155 @@
+#pragma once
+
+#include "ILedStripWithStorage.h"
+
+#include <algorithm>
+
+/**
+* Batch color kernels, operating on RGBW arrays or whole led strips.
+* All kernels use the integer HSV conversion of RGBW (see RGBW::FromHSV()).
+*/
+
+/**
+* Fills the output with a hue gradient.
+* \param startHue hue of the first led as 8.8 fixed point value (hue << 8)
+* \param hueStep hue increment per led as 8.8 fixed point value (256 = one hue step)
+*/
+inline void FillHueGradient(RGBW* output, size_t count, uint16_t startHue, uint16_t hueStep, uint8_t saturation = 0xFF, uint8_t value = 0xFF, bool extractWhite = false) {
+    uint16_t hue = startHue;
+
+    if (saturation == 0xFF && value == 0xFF && !extractWhite) {
+        // Fully saturated colors are plain table lookups
+        const std::array<RGBW, 256>& hueTable = RGBW::GetHueTable();
+
+        for (size_t i = 0; i < count; ++i) {
+            output[i] = hueTable[hue >> 8];
+            hue += hueStep;
+        }
+    } else {
+        for (size_t i = 0; i < count; ++i) {
+            output[i] = RGBW::FromHSV(HSV(hue >> 8, saturation, value), extractWhite);
+            hue += hueStep;
+        }
+    }
+}
+
+/**
+* Rotates the hue of all colors by delta, keeps saturation and value.
+* The W channel is folded into the color (see RGBW::toHSV()), use extractWhite to move it back.
+*/
+inline void RotateHue(RGBW* colors, size_t count, uint8_t delta, bool extractWhite = false) {
+    for (size_t i = 0; i < count; ++i) {
+        HSV hsv = colors[i].toHSV();
+        hsv.h += delta;
+        colors[i] = RGBW::FromHSV(hsv, extractWhite);
+    }
+}
+
+/**
+* Color emitted by the white channel, relative to full r, g and b (255, 255, 255 = neutral white).
+* A warm white led for example corresponds to something like (255, 190, 120).
+*/
+struct WhitePoint {
+    uint8_t r;
+    uint8_t g;
+    uint8_t b;
+
+    // 8.8 fixed point factors 255 / channel, 0 for channels the white led does not emit
+    uint16_t inverse[3];
+
+    static uint16_t GetInverse(uint8_t channel) {
+        return channel > 0 ? (0xFF * 256 + channel / 2) / channel : 0;
+    }
+
+    WhitePoint(uint8_t r = 0xFF, uint8_t g = 0xFF, uint8_t b = 0xFF) :
+        r(r),
+        g(g),
+        b(b),
+        inverse{GetInverse(r), GetInverse(g), GetInverse(b)} {}
+};
+
+/**
+* Moves the part of each color which the white channel can produce into the W channel.
+* The white amount is min(r / wp.r, g / wp.g, b / wp.b), the white point contribution is subtracted
+* from r, g and b and the result is added to the existing W value.
+*/
+inline void ExtractWhite(RGBW* colors, size_t count, const WhitePoint& whitePoint) {
+    for (size_t i = 0; i < count; ++i) {
+        RGBW& color = colors[i];
+        uint16_t white = 0xFF;
+
+        if (whitePoint.inverse[0] > 0) {
+            white = std::min<uint16_t>(white, (uint32_t(color.r) * whitePoint.inverse[0]) >> 8);
+        }
+
+        if (whitePoint.inverse[1] > 0) {
+            white = std::min<uint16_t>(white, (uint32_t(color.g) * whitePoint.inverse[1]) >> 8);
+        }
+
+        if (whitePoint.inverse[2] > 0) {
+            white = std::min<uint16_t>(white, (uint32_t(color.b) * whitePoint.inverse[2]) >> 8);
+        }
+
+        if (white == 0) {
+            continue;
+        }
+
+        color.r -= std::min(color.r, Scale8(white, whitePoint.r));
+        color.g -= std::min(color.g, Scale8(white, whitePoint.g));
+        color.b -= std::min(color.b, Scale8(white, whitePoint.b));
+        color.w = AddWOOverflow(color.w, white);
+    }
+}
+
+/**
+* Applies the kernel to all leds of the strip, in place when the strip has a pixel buffer,
+* otherwise in chunks via getLeds() / setLeds().
+*/
+template<typename Kernel>
+inline void ApplyColorKernel(ILedStripWithStorage& strip, bool readColors, Kernel kernel, bool flush) {
+    const ledoffset_t count = strip.getLedCount();
+    RGBW* pixels = strip.getPixelBuffer();
+
+    if (pixels) {
+        kernel(pixels, count, 0);
+    } else {
+        const ledoffset_t chunkSize = 32;
+        RGBW chunk[chunkSize];
+
+        for (ledoffset_t offset = 0; offset < count; offset += std::min<ledoffset_t>(chunkSize, count - offset)) {
+            ledoffset_t chunkCount = std::min<ledoffset_t>(chunkSize, count - offset);
+
+            if (readColors) {
+                strip.getLeds(offset, chunk, chunkCount);
+            }
+
+            kernel(chunk, chunkCount, offset);
+            strip.setLeds(offset, chunk, chunkCount, false);
+        }
+    }
+
+    if (flush) {
+        strip.updateLeds();
+    }
+}
+
+/**
+* Fills the led strip with one full rainbow, starting at startHue.
+*/
+inline void FillRainbow(ILedStripWithStorage& strip, uint8_t startHue, uint8_t saturation = 0xFF, uint8_t value = 0xFF, bool extractWhite = false, bool flush = false) {
+    const ledoffset_t count = strip.getLedCount();
+    const uint16_t hueStep = count > 0 ? 0x10000 / count : 0;
+
+    ApplyColorKernel(strip, false, [&](RGBW* colors, ledoffset_t chunkCount, ledoffset_t offset) {
+        FillHueGradient(colors, chunkCount, (uint16_t(startHue) << 8) + offset * hueStep, hueStep, saturation, value, extractWhite);
+    }, flush);
+}
+
+/**
+* Rotates the hue of all leds of the strip, see RotateHue().
+*/
+inline void RotateHue(ILedStripWithStorage& strip, uint8_t delta, bool extractWhite = false, bool flush = false) {
+    ApplyColorKernel(strip, true, [&](RGBW* colors, ledoffset_t chunkCount, ledoffset_t) {
+        RotateHue(colors, chunkCount, delta, extractWhite);
+    }, flush);
+}
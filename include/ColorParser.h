@@ -0,0 +1,233 @@
+#pragma once
+
+#include "ILedStrip.h"
+#include "RGBW.h"
+
+#include <array>
+#include <algorithm>
+#include <string_view>
+
+/**
+* Allocation free color parsing for commands, based on std::string_view.
+* Named colors are found via FindNamedColor() (see RGBW.h).
+*/
+
+/**
+* Parses an unsigned decimal number.
+* \returns false when the text is empty, contains other characters or the value exceeds maximum.
+*/
+constexpr bool ParseUnsigned(std::string_view text, uint32_t maximum, uint32_t& output) {
+    if (text.empty()) {
+        return false;
+    }
+
+    uint32_t value = 0;
+
+    for (char c : text) {
+        if (c < '0' || c > '9') {
+            return false;
+        }
+
+        value = value * 10 + uint32_t(c - '0');
+
+        if (value > maximum) {
+            return false;
+        }
+    }
+
+    output = value;
+    return true;
+}
+
+/**
+* Parses a color factor like "0.5" or "1", the value is clamped to [0, 1].
+*/
+inline bool ParseColorFactor(std::string_view text, float& output) {
+    size_t dot = text.find('.');
+    uint32_t integer = 0;
+    uint32_t fraction = 0;
+    uint32_t divisor = 1;
+
+    if (dot != 0 && !ParseUnsigned(text.substr(0, dot), 1000000, integer)) {
+        return false;
+    }
+
+    if (dot != std::string_view::npos) {
+        std::string_view fractionText = text.substr(dot + 1, 6);
+
+        if ((dot == 0 && fractionText.empty()) || text.size() > dot + 1 + 6
+                || (!fractionText.empty() && !ParseUnsigned(fractionText, 999999, fraction))) {
+            return false;
+        }
+
+        for (size_t i = 0; i < fractionText.size(); ++i) {
+            divisor *= 10;
+        }
+    }
+
+    output = std::min(1.f, float(integer) + float(fraction) / float(divisor));
+    return true;
+}
+
+constexpr int8_t HexDigitValue(char c) {
+    return c >= '0' && c <= '9' ? c - '0'
+           : c >= 'a' && c <= 'f' ? c - 'a' + 10
+           : c >= 'A' && c <= 'F' ? c - 'A' + 10
+           : -1;
+}
+
+/**
+* Parses a hex color "#RRGGBB" or "#RRGGBBWW".
+*/
+constexpr bool ParseHexColor(std::string_view text, RGBW& output) {
+    if ((text.size() != 7 && text.size() != 9) || text[0] != '#') {
+        return false;
+    }
+
+    uint8_t channels[4] = {0, 0, 0, 0};
+
+    for (size_t i = 1; i < text.size(); i += 2) {
+        int8_t high = HexDigitValue(text[i]);
+        int8_t low = HexDigitValue(text[i + 1]);
+
+        if (high < 0 || low < 0) {
+            return false;
+        }
+
+        channels[i / 2] = uint8_t(high << 4 | low);
+    }
+
+    output = RGBW(channels[0], channels[1], channels[2], channels[3]);
+    return true;
+}
+
+/**
+* Parses a hex color (see ParseHexColor()) or a named color with an optional factor, e.g. "red*0.5".
+* Same syntax as ParseNamedColor(), without memory allocations. Invalid factors are rejected.
+* \param output Output variable for the color, only defined when the return value is true.
+*/
+inline bool ParseColor(std::string_view text, RGBW& output) {
+    if (!text.empty() && text[0] == '#') {
+        return ParseHexColor(text, output);
+    }
+
+    size_t pos = text.find('*');
+
+    if (pos == std::string_view::npos) {
+        return FindNamedColor(text, output);
+    }
+
+    float factor;
+    RGBW color;
+
+    if (!FindNamedColor(text.substr(0, pos), color) || !ParseColorFactor(text.substr(pos + 1), factor)) {
+        return false;
+    }
+
+    output = color * factor;
+    return true;
+}
+
+/**
+* Color for a range of leds, from a batch command.
+*/
+struct ColorRange {
+    ledoffset_t first = 0;
+    ledoffset_t count = 0;  // 0 = up to the last led
+    RGBW color = COLOR_OFF;
+};
+
+/**
+* Parses a range command "<index>=<color>", "<first>-<last>=<color>" or "all=<color>", e.g. "0-9=red*0.5".
+* \param output Output variable for the range, only defined when the return value is true.
+*/
+inline bool ParseColorRange(std::string_view text, ColorRange& output) {
+    size_t equals = text.find('=');
+
+    if (equals == std::string_view::npos || !ParseColor(text.substr(equals + 1), output.color)) {
+        return false;
+    }
+
+    std::string_view range = text.substr(0, equals);
+
+    if (range == "all") {
+        output.first = 0;
+        output.count = 0;
+        return true;
+    }
+
+    size_t dash = range.find('-');
+    uint32_t first;
+    uint32_t last;
+
+    if (!ParseUnsigned(range.substr(0, dash), 254, first)) {
+        return false;
+    }
+
+    if (dash == std::string_view::npos) {
+        last = first;
+    } else if (!ParseUnsigned(range.substr(dash + 1), 254, last) || last < first) {
+        return false;
+    }
+
+    output.first = ledoffset_t(first);
+    output.count = ledoffset_t(last - first + 1);
+    return true;
+}
+
+/**
+* Parses a batch of range commands separated by ',' or ';' (spaces around the commands are ignored)
+* and calls the callback for each range.
+* \returns false at the first invalid command, the callback was called for all previous commands then.
+*/
+template<typename Callback>
+inline bool ParseColorRanges(std::string_view commands, Callback callback) {
+    while (!commands.empty()) {
+        size_t end = commands.find_first_of(",;");
+        std::string_view command = commands.substr(0, end);
+
+        size_t begin = command.find_first_not_of(' ');
+        command = begin == std::string_view::npos ? std::string_view() : command.substr(begin, command.find_last_not_of(' ') - begin + 1);
+
+        ColorRange range{};
+
+        if (!command.empty()) {
+            if (!ParseColorRange(command, range)) {
+                return false;
+            }
+
+            callback(range);
+        }
+
+        commands = end == std::string_view::npos ? std::string_view() : commands.substr(end + 1);
+    }
+
+    return true;
+}
+
+/**
+* Applies a batch of range commands (see ParseColorRanges()) to the led strip, ranges are clamped to the strip.
+* The batch is validated first, nothing is changed when it contains an invalid command.
+*/
+inline bool ApplyColorRanges(ILedStrip& strip, std::string_view commands, bool flush = false) {
+    if (!ParseColorRanges(commands, [](const ColorRange&) {})) {
+        return false;
+    }
+
+    const ledoffset_t ledCount = strip.getLedCount();
+
+    ParseColorRanges(commands, [&](const ColorRange& range) {
+        if (range.first >= ledCount) {
+            return;
+        }
+
+        ledoffset_t maxCount = ledCount - range.first;
+        strip.setRange(range.first, range.count == 0 ? maxCount : std::min(range.count, maxCount), range.color, false);
+    });
+
+    if (flush) {
+        strip.updateLeds();
+    }
+
+    return true;
+}
@@ -0,0 +1,288 @@
+#pragma once
+
+#include "ILedStripWithStorage.h"
+#include "LedBufferStorage.h"
+#include "ColorChannels.h"
+
+#include <vector>
+#include <memory>
+#include <algorithm>
+#include <stdlib.h>
+
+/**
+* Storage class for RGB-only led strips, stores 3 bytes per led.
+* The W component is dropped on write and read back as 0.
+*/
+class RGBLedBufferStorage : public ILedStripWithStorage {
+    private:
+        std::vector<uint8_t> channels;
+
+    public:
+        static constexpr size_t BYTES_PER_LED = 3;
+
+        RGBLedBufferStorage(ledoffset_t ledCount) :
+            channels(size_t(ledCount) * BYTES_PER_LED) {}
+
+        virtual ledoffset_t getLedCount() const override {
+            return channels.size() / BYTES_PER_LED;
+        }
+
+        virtual void setLed(ledoffset_t index, RGBW color, bool flush = false) override {
+            uint8_t* ptr = channels.data() + index * BYTES_PER_LED;
+
+            ptr[0] = color.r;
+            ptr[1] = color.g;
+            ptr[2] = color.b;
+
+            if (flush) {
+                updateLeds();
+            }
+        }
+
+        virtual void setRange(ledoffset_t index, ledoffset_t count, RGBW color, bool flush = false) override {
+            for (ledoffset_t i = index; i < index + count; ++i) {
+                setLed(i, color, false);
+            }
+
+            if (flush) {
+                updateLeds();
+            }
+        }
+
+        virtual void setLeds(ledoffset_t index, const RGBW* colors, ledoffset_t count, bool flush = false) override {
+            for (ledoffset_t i = 0; i < count; ++i) {
+                setLed(index + i, colors[i], false);
+            }
+
+            if (flush) {
+                updateLeds();
+            }
+        }
+
+        virtual RGBW getLed(ledoffset_t index) const override {
+            const uint8_t* ptr = channels.data() + index * BYTES_PER_LED;
+            return RGBW(ptr[0], ptr[1], ptr[2], 0);
+        }
+
+        virtual void getLeds(ledoffset_t index, RGBW* output, ledoffset_t count) const override {
+            for (ledoffset_t i = 0; i < count; ++i) {
+                output[i] = getLed(index + i);
+            }
+        }
+
+        /// \returns the raw storage, 3 bytes (r, g, b) per led.
+        uint8_t* getChannelBuffer() {
+            return channels.data();
+        }
+
+        virtual void updateLeds() override {
+            // This is only a storage, nothing to do here
+        }
+};
+
+/**
+* Color palette which can be shared between multiple PalettedLedBufferStorage instances.
+* Colors not contained in the palette are either appended (as long as the palette is not full
+* and auto extend is enabled) or mapped to the nearest existing color.
+*/
+class LedPalette {
+    private:
+        std::vector<RGBW> colors;
+        bool autoExtend;
+
+        static uint16_t GetDistance(RGBW a, RGBW b) {
+            return abs(int16_t(a.r) - b.r) + abs(int16_t(a.g) - b.g) + abs(int16_t(a.b) - b.b) + abs(int16_t(a.w) - b.w);
+        }
+
+    public:
+        static constexpr size_t MAX_SIZE = 256;
+
+        LedPalette(bool autoExtend = true) :
+            colors(),
+            autoExtend(autoExtend) {}
+
+        LedPalette(std::initializer_list<RGBW> colors, bool autoExtend = false) :
+            colors(colors),
+            autoExtend(autoExtend) {
+
+            if (this->colors.size() > MAX_SIZE) {
+                this->colors.resize(MAX_SIZE);
+            }
+        }
+
+        size_t size() const {
+            return colors.size();
+        }
+
+        /// \returns the color of the index, COLOR_OFF for indices outside of the palette.
+        RGBW getColor(uint8_t index) const {
+            return index < colors.size() ? colors[index] : COLOR_OFF;
+        }
+
+        /**
+         * Changes the color of an existing entry, all leds using the entry change their color.
+         */
+        void setColor(uint8_t index, RGBW color) {
+            if (index < colors.size()) {
+                colors[index] = color;
+            }
+        }
+
+        /// \returns the index of the new color or the index of the nearest color, when the palette is full.
+        uint8_t addColor(RGBW color, size_t maxSize = MAX_SIZE) {
+            if (colors.size() >= std::min(maxSize, MAX_SIZE)) {
+                return findIndex(color, maxSize);
+            }
+
+            colors.push_back(color);
+            return colors.size() - 1;
+        }
+
+        /**
+         * Looks up the index of the color within the first maxSize entries.
+         * \returns the exact match, a new entry (auto extend) or the nearest color.
+         */
+        uint8_t findIndex(RGBW color, size_t maxSize = MAX_SIZE) {
+            const size_t count = std::min(colors.size(), maxSize);
+            size_t nearestIndex = 0;
+            uint16_t nearestDistance = UINT16_MAX;
+
+            for (size_t i = 0; i < count; ++i) {
+                uint16_t distance = GetDistance(colors[i], color);
+
+                if (distance == 0) {
+                    return i;
+                }
+
+                if (distance < nearestDistance) {
+                    nearestDistance = distance;
+                    nearestIndex = i;
+                }
+            }
+
+            if (autoExtend && colors.size() < std::min(maxSize, MAX_SIZE)) {
+                return addColor(color, maxSize);
+            }
+
+            return nearestIndex;
+        }
+
+        void setAutoExtend(bool autoExtend) {
+            this->autoExtend = autoExtend;
+        }
+
+        void clear() {
+            colors.clear();
+        }
+};
+
+/**
+* Storage class which stores a palette index per led, using Bits (4 or 8) bits per led.
+* With 4 bits only the first 16 entries of the palette are used.
+*
+* Writing a color looks it up in the palette (see LedPalette::findIndex()), so this storage
+* fits strips with a limited set of colors. Use setIndex() to avoid the lookup.
+*/
+template<uint8_t Bits>
+class PalettedLedBufferStorage : public ILedStripWithStorage {
+    static_assert(Bits == 4 || Bits == 8, "Only 4 and 8 bit palette indices are supported");
+
+    private:
+        static constexpr size_t PALETTE_SIZE = size_t(1) << Bits;
+        static constexpr uint8_t LEDS_PER_BYTE = 8 / Bits;
+
+        LedPalette& palette;
+        std::vector<uint8_t> indices;
+        ledoffset_t ledCount;
+
+        // Cache of the last lookup, consecutive writes often use the same color
+        RGBW lastColor;
+        uint8_t lastIndex;
+        bool lastValid;
+
+        uint8_t lookup(RGBW color) {
+            if (!lastValid || color != lastColor || palette.getColor(lastIndex) != color) {
+                lastColor = color;
+                lastIndex = palette.findIndex(color, PALETTE_SIZE);
+                lastValid = true;
+            }
+
+            return lastIndex;
+        }
+
+    public:
+        PalettedLedBufferStorage(ledoffset_t ledCount, LedPalette& palette) :
+            palette(palette),
+            indices((size_t(ledCount) + LEDS_PER_BYTE - 1) / LEDS_PER_BYTE),
+            ledCount(ledCount),
+            lastColor(),
+            lastIndex(0),
+            lastValid(false) {}
+
+        virtual ledoffset_t getLedCount() const override {
+            return ledCount;
+        }
+
+        LedPalette& getPalette() const {
+            return palette;
+        }
+
+        uint8_t getIndex(ledoffset_t index) const {
+            if constexpr (Bits == 8) {
+                return indices[index];
+            } else {
+                return (indices[index / 2] >> ((index % 2) * 4)) & 0x0F;
+            }
+        }
+
+        void setIndex(ledoffset_t index, uint8_t paletteIndex, bool flush = false) {
+            if constexpr (Bits == 8) {
+                indices[index] = paletteIndex;
+            } else {
+                uint8_t shift = (index % 2) * 4;
+                uint8_t& byte = indices[index / 2];
+
+                byte = (byte & ~(0x0F << shift)) | ((paletteIndex & 0x0F) << shift);
+            }
+
+            if (flush) {
+                updateLeds();
+            }
+        }
+
+        virtual void setLed(ledoffset_t index, RGBW color, bool flush = false) override {
+            setIndex(index, lookup(color), flush);
+        }
+
+        virtual void setRange(ledoffset_t index, ledoffset_t count, RGBW color, bool flush = false) override {
+            uint8_t paletteIndex = lookup(color);
+
+            for (ledoffset_t i = index; i < index + count; ++i) {
+                setIndex(i, paletteIndex, false);
+            }
+
+            if (flush) {
+                updateLeds();
+            }
+        }
+
+        virtual RGBW getLed(ledoffset_t index) const override {
+            return palette.getColor(getIndex(index));
+        }
+
+        virtual void updateLeds() override {
+            // This is only a storage, nothing to do here
+        }
+};
+
+/**
+* Creates the most compact full color storage for the given channels:
+* RGBLedBufferStorage without W channel, LedBufferStorage otherwise.
+*/
+inline std::unique_ptr<ILedStripWithStorage> CreateLedBufferStorage(ledoffset_t ledCount, ColorChannels channels) {
+    if (!channels.w) {
+        return std::unique_ptr<ILedStripWithStorage>(new RGBLedBufferStorage(ledCount));
+    }
+
+    return std::unique_ptr<ILedStripWithStorage>(new LedBufferStorage(ledCount));
+}
@@ -0,0 +1,182 @@
+#pragma once
+
+#include "ILedStripWithStorage.h"
+#include "Instrumentation.h"
+
+#include <vector>
+#include <stdint.h>
+
+/**
+* Engine for large numbers of per-led fade animations on one led strip.
+* In contrast to the AnimationManager, the state of all fades is stored as structure-of-arrays
+* (start times, durations, colors, led indices) and evaluated in tight loops without virtual calls.
+*
+* When the led strip provides a pixel buffer, the results are written directly into it.
+* Fades on the same led are applied in the order they were added.
+*/
+class FadeAnimationBatch {
+    private:
+        ILedStripWithStorage& ledControl;
+
+        std::vector<uint32_t> startTimes;
+        std::vector<uint32_t> durations;
+        std::vector<RGBW> startColors;
+        std::vector<RGBW> endColors;
+        std::vector<ledoffset_t> ledIndices;
+
+        // Scratch buffers, reused between updates
+        std::vector<int16_t> factors;
+        std::vector<RGBW> colors;
+
+        static uint8_t InterpolateChannel(uint8_t from, uint8_t to, int16_t factor) {
+            return from + ((int16_t(to) - int16_t(from)) * factor) / 256;
+        }
+
+    public:
+        /// Factor value of a fade which has not started yet.
+        static constexpr int16_t FACTOR_NOT_STARTED = -1;
+        /// Factor value of a fade which has reached its end color.
+        static constexpr int16_t FACTOR_FINISHED = 256;
+
+        FadeAnimationBatch(ILedStripWithStorage& ledControl) :
+            ledControl(ledControl),
+            startTimes(),
+            durations(),
+            startColors(),
+            endColors(),
+            ledIndices(),
+            factors(),
+            colors() {}
+
+        /**
+         * Reserves memory for the given number of fades.
+         */
+        void reserve(size_t count) {
+            startTimes.reserve(count);
+            durations.reserve(count);
+            startColors.reserve(count);
+            endColors.reserve(count);
+            ledIndices.reserve(count);
+            factors.reserve(count);
+            colors.reserve(count);
+        }
+
+        void addFade(uint32_t startTime, uint32_t duration, ledoffset_t ledIndex, RGBW startColor, RGBW endColor) {
+            startTimes.push_back(startTime);
+            durations.push_back(duration);
+            startColors.push_back(startColor);
+            endColors.push_back(endColor);
+            ledIndices.push_back(ledIndex);
+        }
+
+        ILedStripWithStorage& getLedControl() const {
+            return ledControl;
+        }
+
+        size_t size() const {
+            return startTimes.size();
+        }
+
+        bool empty() const {
+            return startTimes.empty();
+        }
+
+        /**
+         * Deletes all fades.
+         * Note that the end color of the fades will not be applied.
+         */
+        void clear() {
+            startTimes.clear();
+            durations.clear();
+            startColors.clear();
+            endColors.clear();
+            ledIndices.clear();
+        }
+
+        /**
+         * Evaluates all fades for the given time and writes the results to the led strip.
+         * Finished fades apply their end color and are removed afterwards.
+         * \param flush updates the led strip when at least one led was written
+         * \returns true when at least one led was written
+         */
+        bool update(uint32_t currentTime, bool flush = true) {
+            bool anyWritten = false;
+
+            {
+                ScopedStageTimer timer(InstrumentationStage::AnimationUpdate);
+
+                const size_t count = size();
+
+                factors.resize(count);
+                colors.resize(count);
+
+                // Pass 1: Compute the fixed point (8.8) factor of each fade
+                for (size_t i = 0; i < count; ++i) {
+                    int32_t elapsed = int32_t(currentTime - startTimes[i]);
+
+                    if (elapsed < 0) {
+                        factors[i] = FACTOR_NOT_STARTED;
+                    } else if (uint32_t(elapsed) >= durations[i]) {
+                        factors[i] = FACTOR_FINISHED;
+                    } else {
+                        factors[i] = int16_t((uint64_t(elapsed) << 8) / durations[i]);
+                    }
+                }
+
+                // Pass 2: Interpolate the colors
+                for (size_t i = 0; i < count; ++i) {
+                    int16_t factor = factors[i] < 0 ? 0 : factors[i];
+
+                    colors[i].r = InterpolateChannel(startColors[i].r, endColors[i].r, factor);
+                    colors[i].g = InterpolateChannel(startColors[i].g, endColors[i].g, factor);
+                    colors[i].b = InterpolateChannel(startColors[i].b, endColors[i].b, factor);
+                    colors[i].w = InterpolateChannel(startColors[i].w, endColors[i].w, factor);
+                }
+
+                // Pass 3: Write the active fades to the leds
+                RGBW* pixels = ledControl.getPixelBuffer();
+
+                for (size_t i = 0; i < count; ++i) {
+                    if (factors[i] == FACTOR_NOT_STARTED) {
+                        continue;
+                    }
+
+                    if (pixels) {
+                        pixels[ledIndices[i]] = colors[i];
+                    } else {
+                        ledControl.setLed(ledIndices[i], colors[i], false);
+                    }
+
+                    anyWritten = true;
+                }
+
+                // Pass 4: Remove the finished fades, keeps the order of the remaining ones
+                size_t writeIndex = 0;
+
+                for (size_t i = 0; i < count; ++i) {
+                    if (factors[i] == FACTOR_FINISHED) {
+                        continue;
+                    }
+
+                    startTimes[writeIndex] = startTimes[i];
+                    durations[writeIndex] = durations[i];
+                    startColors[writeIndex] = startColors[i];
+                    endColors[writeIndex] = endColors[i];
+                    ledIndices[writeIndex] = ledIndices[i];
+                    writeIndex++;
+                }
+
+                startTimes.resize(writeIndex);
+                durations.resize(writeIndex);
+                startColors.resize(writeIndex);
+                endColors.resize(writeIndex);
+                ledIndices.resize(writeIndex);
+            }
+
+            if (anyWritten && flush) {
+                ledControl.updateLeds();
+            }
+
+            return anyWritten;
+        }
+};
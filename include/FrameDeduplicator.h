@@ -0,0 +1,112 @@
+#pragma once
+
+#include <stddef.h>
+#include <stdint.h>
+#include <string.h>
+
+/**
+* Detects encoded frames which are identical to the last transmitted one, so drivers can skip them.
+* Frames are compared by a 64 bit hash of the encoded buffer (FNV-1a over 32 bit words).
+* Since every step of the hash is a bijection, frames which differ in a single word always
+* produce a different hash.
+*
+* Identical frames are still transmitted every keepAliveInterval_ms, so leds which lost their
+* state (e.g. power glitch, hot plug) are refreshed.
+*/
+class FrameDeduplicator {
+    private:
+        uint64_t lastHash;
+        uint32_t lastTransmitTime_ms;
+        uint32_t keepAliveInterval_ms;
+        bool valid;
+        bool enabled;
+        uint32_t skippedCount;
+
+    public:
+        static constexpr uint32_t DEFAULT_KEEP_ALIVE_MS = 1000;
+
+        static uint64_t Hash(const uint8_t* data, size_t size) {
+            const uint64_t prime = 0x100000001B3ULL;
+            uint64_t hash = 0xCBF29CE484222325ULL;
+            size_t i = 0;
+
+            for (; i + 4 <= size; i += 4) {
+                uint32_t word;
+                memcpy(&word, data + i, sizeof(word));
+                hash = (hash ^ word) * prime;
+            }
+
+            for (; i < size; ++i) {
+                hash = (hash ^ data[i]) * prime;
+            }
+
+            return hash ^ size;
+        }
+
+        /**
+         * \param keepAliveInterval_ms identical frames are transmitted again after this time, 0 to never repeat them
+         */
+        FrameDeduplicator(uint32_t keepAliveInterval_ms = DEFAULT_KEEP_ALIVE_MS, bool enabled = true) :
+            lastHash(0),
+            lastTransmitTime_ms(0),
+            keepAliveInterval_ms(keepAliveInterval_ms),
+            valid(false),
+            enabled(enabled),
+            skippedCount(0) {}
+
+        /**
+         * Checks whether the frame has to be transmitted and remembers it as transmitted if so.
+         * \returns false when the frame equals the last transmitted one and the keep alive interval has not elapsed.
+         */
+        bool shouldTransmit(const uint8_t* data, size_t size, uint32_t currentTime_ms) {
+            if (!enabled) {
+                return true;
+            }
+
+            uint64_t hash = Hash(data, size);
+            bool keepAliveElapsed = keepAliveInterval_ms > 0 && currentTime_ms - lastTransmitTime_ms >= keepAliveInterval_ms;
+
+            if (valid && hash == lastHash && !keepAliveElapsed) {
+                skippedCount++;
+                return false;
+            }
+
+            lastHash = hash;
+            lastTransmitTime_ms = currentTime_ms;
+            valid = true;
+            return true;
+        }
+
+        /**
+         * Forces the transmission of the next frame.
+         */
+        void invalidate() {
+            valid = false;
+        }
+
+        void setEnabled(bool enabled) {
+            this->enabled = enabled;
+            invalidate();
+        }
+
+        bool isEnabled() const {
+            return enabled;
+        }
+
+        void setKeepAliveInterval(uint32_t keepAliveInterval_ms) {
+            this->keepAliveInterval_ms = keepAliveInterval_ms;
+        }
+
+        uint32_t getKeepAliveInterval() const {
+            return keepAliveInterval_ms;
+        }
+
+        /// \returns the number of frames skipped since construction or resetSkippedCount().
+        uint32_t getSkippedCount() const {
+            return skippedCount;
+        }
+
+        void resetSkippedCount() {
+            skippedCount = 0;
+        }
+};
@@ -0,0 +1,410 @@
+#pragma once
+
+#include "ILedStripWithStorage.h"
+#include "VirtualLedStrip.h"
+#include "MappedFile.h"
+
+#include <vector>
+#include <algorithm>
+#include <string.h>
+
+/**
+* Compact binary format for recorded led frames.
+*
+* Layout (all values little endian):
+*   Header (16 bytes): "LCFS", version (u8), bytes per led (u8, always 4 = RGBW),
+*                      led count (u16), frame interval in us (u32), frame count (u32)
+*   Frames:            type (u8), payload size (u32), payload
+*
+* Keyframes contain the raw RGBW bytes of all leds.
+* Delta frames contain the XOR to the previous frame, run length encoded as pairs of
+* (count of unchanged bytes, count of changed bytes) as varints, each followed by the changed XOR bytes.
+*/
+struct FrameStreamFormat {
+    static constexpr uint8_t VERSION = 1;
+    static constexpr size_t HEADER_SIZE = 16;
+    static constexpr size_t FRAME_HEADER_SIZE = 5;
+    static constexpr uint8_t BYTES_PER_LED = 4;
+
+    static constexpr uint8_t FRAME_KEY = 1;
+    static constexpr uint8_t FRAME_DELTA = 2;
+
+    struct Header {
+        uint16_t ledCount;
+        uint32_t frameInterval_us;
+        uint32_t frameCount;
+    };
+
+    static void WriteU16(uint8_t* ptr, uint16_t value) {
+        ptr[0] = value;
+        ptr[1] = value >> 8;
+    }
+
+    static void WriteU32(uint8_t* ptr, uint32_t value) {
+        WriteU16(ptr, value);
+        WriteU16(ptr + 2, value >> 16);
+    }
+
+    static uint16_t ReadU16(const uint8_t* ptr) {
+        return uint16_t(ptr[0]) | uint16_t(ptr[1]) << 8;
+    }
+
+    static uint32_t ReadU32(const uint8_t* ptr) {
+        return uint32_t(ReadU16(ptr)) | uint32_t(ReadU16(ptr + 2)) << 16;
+    }
+
+    static void AppendVarInt(std::vector<uint8_t>& output, uint32_t value) {
+        while (value >= 0x80) {
+            output.push_back(uint8_t(value) | 0x80);
+            value >>= 7;
+        }
+
+        output.push_back(value);
+    }
+
+    /// \returns false when the varint exceeds the end pointer.
+    static bool ReadVarInt(const uint8_t*& ptr, const uint8_t* end, uint32_t& output) {
+        output = 0;
+
+        for (uint8_t shift = 0; ptr < end && shift < 32; shift += 7) {
+            uint8_t byte = *ptr++;
+            output |= uint32_t(byte & 0x7F) << shift;
+
+            if ((byte & 0x80) == 0) {
+                return true;
+            }
+        }
+
+        return false;
+    }
+
+    static void WriteHeader(uint8_t* ptr, const Header& header) {
+        memcpy(ptr, "LCFS", 4);
+        ptr[4] = VERSION;
+        ptr[5] = BYTES_PER_LED;
+        WriteU16(ptr + 6, header.ledCount);
+        WriteU32(ptr + 8, header.frameInterval_us);
+        WriteU32(ptr + 12, header.frameCount);
+    }
+
+    /// \returns true when the data starts with a valid header.
+    static bool ReadHeader(const uint8_t* data, size_t size, Header& output) {
+        if (size < HEADER_SIZE || memcmp(data, "LCFS", 4) != 0 || data[4] != VERSION || data[5] != BYTES_PER_LED) {
+            return false;
+        }
+
+        output.ledCount = ReadU16(data + 6);
+        output.frameInterval_us = ReadU32(data + 8);
+        output.frameCount = ReadU32(data + 12);
+        return true;
+    }
+
+    /**
+     * Appends the XOR/RLE delta payload between the previous and the current frame.
+     */
+    static void EncodeDelta(const uint8_t* previous, const uint8_t* current, size_t size, std::vector<uint8_t>& output) {
+        size_t i = 0;
+
+        while (i < size) {
+            size_t unchangedStart = i;
+
+            while (i < size && previous[i] == current[i]) {
+                i++;
+            }
+
+            if (i == size) {
+                break;
+            }
+
+            size_t changedStart = i;
+
+            // A single unchanged byte costs less as literal than a new run pair
+            while (i < size && (previous[i] != current[i] || (i + 1 < size && previous[i + 1] != current[i + 1]))) {
+                i++;
+            }
+
+            AppendVarInt(output, changedStart - unchangedStart);
+            AppendVarInt(output, i - changedStart);
+
+            for (size_t j = changedStart; j < i; ++j) {
+                output.push_back(previous[j] ^ current[j]);
+            }
+        }
+    }
+
+    /**
+     * Applies the delta payload to the frame.
+     * \returns false when the payload is invalid.
+     */
+    static bool DecodeDelta(const uint8_t* payload, size_t payloadSize, uint8_t* frame, size_t frameSize) {
+        const uint8_t* ptr = payload;
+        const uint8_t* end = payload + payloadSize;
+        size_t offset = 0;
+
+        while (ptr < end) {
+            uint32_t unchanged;
+            uint32_t changed;
+
+            if (!ReadVarInt(ptr, end, unchanged) || !ReadVarInt(ptr, end, changed)) {
+                return false;
+            }
+
+            offset += unchanged;
+
+            if (offset + changed > frameSize || changed > size_t(end - ptr)) {
+                return false;
+            }
+
+            for (uint32_t i = 0; i < changed; ++i) {
+                frame[offset + i] ^= ptr[i];
+            }
+
+            ptr += changed;
+            offset += changed;
+        }
+
+        return true;
+    }
+};
+
+/**
+* Pass-through led strip which records every flushed frame of the base strip into a frame stream.
+*/
+class FrameStreamRecorder : public VirtualPassthroughLedStrip {
+    private:
+        std::vector<uint8_t>& output;
+        uint32_t keyframeInterval;
+
+        std::vector<uint8_t> previousFrame;
+        std::vector<uint8_t> currentFrame;
+        std::vector<uint8_t> deltaPayload;
+        uint32_t frameCount;
+
+        void appendFrame(uint8_t type, const uint8_t* payload, size_t size) {
+            size_t offset = output.size();
+
+            output.resize(offset + FrameStreamFormat::FRAME_HEADER_SIZE);
+            output[offset] = type;
+            FrameStreamFormat::WriteU32(output.data() + offset + 1, size);
+            output.insert(output.end(), payload, payload + size);
+        }
+
+    public:
+        /**
+         * \param output the stream is appended to this buffer, starting with the header
+         * \param frameInterval_us playback interval between two frames
+         * \param keyframeInterval a keyframe is stored at least every n frames
+         */
+        FrameStreamRecorder(ILedStripWithStorage& baseStrip, std::vector<uint8_t>& output, uint32_t frameInterval_us, uint32_t keyframeInterval = 100) :
+            VirtualPassthroughLedStrip(baseStrip),
+            output(output),
+            keyframeInterval(std::max<uint32_t>(1, keyframeInterval)),
+            previousFrame(baseStrip.getLedCount() * FrameStreamFormat::BYTES_PER_LED),
+            currentFrame(previousFrame.size()),
+            deltaPayload(),
+            frameCount(0) {
+
+            size_t offset = output.size();
+            output.resize(offset + FrameStreamFormat::HEADER_SIZE);
+            FrameStreamFormat::WriteHeader(output.data() + offset, {baseStrip.getLedCount(), frameInterval_us, 0});
+        }
+
+        // Flushes through updateLeds(), so flushing setters record the frame as well
+        virtual void setLed(ledoffset_t index, RGBW color, bool flush = false) override {
+            baseStrip.setLed(index, color, false);
+
+            if (flush) {
+                this->updateLeds();
+            }
+        }
+
+        virtual void setRange(ledoffset_t index, ledoffset_t count, RGBW color, bool flush = false) override {
+            baseStrip.setRange(index, count, color, false);
+
+            if (flush) {
+                this->updateLeds();
+            }
+        }
+
+        virtual void setLeds(ledoffset_t index, const RGBW* colors, ledoffset_t count, bool flush = false) override {
+            baseStrip.setLeds(index, colors, count, false);
+
+            if (flush) {
+                this->updateLeds();
+            }
+        }
+
+        virtual void updateLeds() override {
+            baseStrip.updateLeds();
+            captureFrame();
+        }
+
+        /**
+         * Appends the current state of the base strip as frame.
+         */
+        void captureFrame() {
+            static_assert(sizeof(RGBW) == FrameStreamFormat::BYTES_PER_LED, "RGBW must be stored as 4 bytes");
+
+            baseStrip.getLeds(0, reinterpret_cast<RGBW*>(currentFrame.data()), baseStrip.getLedCount());
+
+            bool keyframe = frameCount % keyframeInterval == 0;
+
+            if (!keyframe) {
+                deltaPayload.clear();
+                FrameStreamFormat::EncodeDelta(previousFrame.data(), currentFrame.data(), currentFrame.size(), deltaPayload);
+
+                keyframe = deltaPayload.size() >= currentFrame.size();
+            }
+
+            if (keyframe) {
+                appendFrame(FrameStreamFormat::FRAME_KEY, currentFrame.data(), currentFrame.size());
+            } else {
+                appendFrame(FrameStreamFormat::FRAME_DELTA, deltaPayload.data(), deltaPayload.size());
+            }
+
+            std::swap(previousFrame, currentFrame);
+            frameCount++;
+
+            // Keep the frame count in the header up to date
+            FrameStreamFormat::WriteU32(output.data() + 12, frameCount);
+        }
+
+        uint32_t getFrameCount() const {
+            return frameCount;
+        }
+};
+
+/**
+* Plays a frame stream into a led strip at the recorded frame rate.
+* Works directly on the given memory (e.g. a memory mapped file or data in flash),
+* only the current frame is kept in RAM.
+*/
+class FrameStreamPlayer {
+    private:
+        const uint8_t* data;
+        size_t size;
+        ILedStripWithStorage& target;
+
+        FrameStreamFormat::Header header;
+        bool valid;
+        bool loop;
+
+        std::vector<uint8_t> frame;
+        size_t position;
+        uint32_t frameIndex;
+        uint64_t startTime_us;
+
+        /// Decodes the next frame into the frame buffer, \returns false at the end of the stream or on errors.
+        bool decodeNextFrame() {
+            if (position + FrameStreamFormat::FRAME_HEADER_SIZE > size) {
+                return false;
+            }
+
+            uint8_t type = data[position];
+            uint32_t payloadSize = FrameStreamFormat::ReadU32(data + position + 1);
+            const uint8_t* payload = data + position + FrameStreamFormat::FRAME_HEADER_SIZE;
+
+            if (payloadSize > size - position - FrameStreamFormat::FRAME_HEADER_SIZE) {
+                return false;
+            }
+
+            if (type == FrameStreamFormat::FRAME_KEY) {
+                if (payloadSize != frame.size()) {
+                    return false;
+                }
+
+                memcpy(frame.data(), payload, payloadSize);
+            } else if (type != FrameStreamFormat::FRAME_DELTA || !FrameStreamFormat::DecodeDelta(payload, payloadSize, frame.data(), frame.size())) {
+                return false;
+            }
+
+            position += FrameStreamFormat::FRAME_HEADER_SIZE + payloadSize;
+            frameIndex++;
+            return true;
+        }
+
+        void rewind() {
+            position = FrameStreamFormat::HEADER_SIZE;
+            frameIndex = 0;
+            std::fill(frame.begin(), frame.end(), 0);
+        }
+
+    public:
+        FrameStreamPlayer(const uint8_t* data, size_t size, ILedStripWithStorage& target, bool loop = false) :
+            data(data),
+            size(size),
+            target(target),
+            header(),
+            valid(FrameStreamFormat::ReadHeader(data, size, header)),
+            loop(loop),
+            frame(valid ? header.ledCount * FrameStreamFormat::BYTES_PER_LED : 0),
+            position(FrameStreamFormat::HEADER_SIZE),
+            frameIndex(0),
+            startTime_us(0) {}
+
+        FrameStreamPlayer(const FrameStreamPlayer&) = delete;
+        FrameStreamPlayer& operator=(const FrameStreamPlayer&) = delete;
+
+        /// \returns true when the stream has a valid header.
+        bool isValid() const {
+            return valid;
+        }
+
+        const FrameStreamFormat::Header& getHeader() const {
+            return header;
+        }
+
+        /**
+         * Starts the playback from the beginning.
+         * \param currentTime_us time of the first frame, 64 bit without wrap around (e.g. IAnimationClock::nowMicros())
+         */
+        void start(uint64_t currentTime_us) {
+            startTime_us = currentTime_us;
+            rewind();
+        }
+
+        /// \returns true when the last frame was played (never in loop mode).
+        bool isFinished() const {
+            return !loop && valid && frameIndex >= header.frameCount;
+        }
+
+        /**
+         * Decodes all frames up to the given time and writes the latest one to the target strip.
+         * \param currentTime_us same time base as start(), nothing is played before the start time
+         * \returns true when a new frame was written to the target strip.
+         */
+        bool update(uint64_t currentTime_us, bool flush = true) {
+            if (!valid || header.frameCount == 0 || currentTime_us < startTime_us) {
+                return false;
+            }
+
+            uint64_t interval = std::max<uint32_t>(1, header.frameInterval_us);
+            uint64_t wantedFrame = (currentTime_us - startTime_us) / interval + 1;
+
+            if (loop && wantedFrame > header.frameCount) {
+                // Restart the loop at the frame matching the current time
+                uint64_t loopDuration = header.frameCount * interval;
+                startTime_us += (currentTime_us - startTime_us) / loopDuration * loopDuration;
+                wantedFrame = (currentTime_us - startTime_us) / interval + 1;
+                rewind();
+            }
+
+            wantedFrame = std::min<uint64_t>(wantedFrame, header.frameCount);
+
+            if (wantedFrame <= frameIndex) {
+                return false;
+            }
+
+            while (frameIndex < wantedFrame) {
+                if (!decodeNextFrame()) {
+                    break;
+                }
+            }
+
+            ledoffset_t count = std::min<size_t>(target.getLedCount(), header.ledCount);
+            const RGBW* pixels = reinterpret_cast<const RGBW*>(frame.data());
+
+            target.setLeds(0, pixels, count, flush);
+            return true;
+        }
+};
@@ -0,0 +1,301 @@
+#pragma once
+
+#include "ILedStripWithStorage.h"
+#include "ILedWireOutput.h"
+#include "VirtualLedStripWithPowerLimit.h"
+#include "Instrumentation.h"
+#include "ColorKernels.h"
+
+#include <array>
+#include <vector>
+#include <optional>
+#include <algorithm>
+
+/**
+* Render pipeline which composites, power limits, gamma corrects and encodes a frame in one pass
+* directly into the wire buffer of the driver.
+*
+* Replaces the chain LedStripCrossFadeHandler -> VirtualLedStripWithPowerLimit -> driver:
+* - The sources are read via their pixel buffers (or one getLeds() call if they have none)
+* - The power consumption is computed by a pre-pass over the sources, which gives one
+*   brightness scale for the whole frame (instead of the iterative reduction of VirtualLedStripWithPowerLimit)
+* - Each led is mixed, white extracted (optional), scaled, gamma corrected and encoded into the
+*   wire buffer in one step
+*
+* The pre-pass is recorded as InstrumentationStage::PowerLimit, the fused pass as InstrumentationStage::Encoding.
+*/
+class FusedRenderPipeline {
+    private:
+        ILedWireOutput& output;
+
+        ILedStripWithStorage* source0;
+        ILedStripWithStorage* source1;
+        uint16_t fadeFactor;    // 8.8 fixed point, 256 = only source1
+
+        std::optional<LedPowerConsumptionInfo> consumptionInfo;
+        float powerLimit_mA;
+        uint16_t powerScale;    // 8.8 fixed point of the last frame
+
+        const std::array<uint8_t, 256>* gammaTable;
+        std::optional<WhitePoint> whitePoint;
+
+        // Used for sources without pixel buffer
+        std::vector<RGBW> scratch0;
+        std::vector<RGBW> scratch1;
+
+        /// Rounds down (unlike a division, which rounds negative differences up), so the mixed value never exceeds the linear mix.
+        static uint8_t Mix(uint8_t from, uint8_t to, uint16_t factor) {
+            int32_t scaled = (int32_t(to) - int32_t(from)) * factor;
+            return uint8_t(from + (scaled >= 0 ? scaled >> 8 : -((-scaled + 255) >> 8)));
+        }
+
+        RGBW mixColor(const RGBW* pixels0, const RGBW* pixels1, ledoffset_t index) const {
+            RGBW color = pixels0[index];
+
+            if (pixels1) {
+                color.r = Mix(color.r, pixels1[index].r, fadeFactor);
+                color.g = Mix(color.g, pixels1[index].g, fadeFactor);
+                color.b = Mix(color.b, pixels1[index].b, fadeFactor);
+                color.w = Mix(color.w, pixels1[index].w, fadeFactor);
+            }
+
+            if (whitePoint) {
+                ExtractWhite(&color, 1, *whitePoint);
+            }
+
+            return color;
+        }
+
+        static const RGBW* GetPixels(const ILedStripWithStorage& source, ledoffset_t count, std::vector<RGBW>& scratch) {
+            const RGBW* pixels = source.getPixels();
+
+            if (!pixels) {
+                scratch.resize(count);
+                source.getLeds(0, scratch.data(), count);
+                pixels = scratch.data();
+            }
+
+            return pixels;
+        }
+
+        /// \returns the number of leds which fit into the wire buffer.
+        ledoffset_t getOutputLedCount() const {
+            LedWireProtocol protocol = output.getWireProtocol();
+            size_t overhead = LedWireTiming::GetFrameSize(protocol, 0);
+            size_t bytesPerLed = LedWireTiming::GetFrameSize(protocol, 1) - overhead;
+            size_t size = output.getWireBufferSize();
+
+            return size > overhead ? std::min<size_t>((size - overhead) / bytesPerLed, 255) : 0;
+        }
+
+        uint16_t computePowerScale(const RGBW* pixels0, const RGBW* pixels1, ledoffset_t count) const {
+            if (!consumptionInfo) {
+                return 256;
+            }
+
+            float sumColor;
+            float sumWhite;
+
+            if (whitePoint) {
+                // The white extraction is not linear, sum up the final colors
+                uint32_t sumColorFinal = 0;
+                uint32_t sumWhiteFinal = 0;
+
+                for (ledoffset_t i = 0; i < count; ++i) {
+                    RGBW color = mixColor(pixels0, pixels1, i);
+
+                    sumColorFinal += uint32_t(color.r) + color.g + color.b;
+                    sumWhiteFinal += color.w;
+                }
+
+                sumColor = sumColorFinal;
+                sumWhite = sumWhiteFinal;
+            } else {
+                uint32_t sumColor0 = 0;
+                uint32_t sumWhite0 = 0;
+                uint32_t sumColor1 = 0;
+                uint32_t sumWhite1 = 0;
+
+                for (ledoffset_t i = 0; i < count; ++i) {
+                    sumColor0 += uint32_t(pixels0[i].r) + pixels0[i].g + pixels0[i].b;
+                    sumWhite0 += pixels0[i].w;
+                }
+
+                if (pixels1) {
+                    for (ledoffset_t i = 0; i < count; ++i) {
+                        sumColor1 += uint32_t(pixels1[i].r) + pixels1[i].g + pixels1[i].b;
+                        sumWhite1 += pixels1[i].w;
+                    }
+                }
+
+                // The mix is linear, so the sums of the mixed frame follow from the sums of the sources.
+                // Mix() rounds down, so these sums are an upper bound of the actually mixed frame.
+                float factor = pixels1 ? fadeFactor / 256.f : 0.f;
+                sumColor = sumColor0 + (float(sumColor1) - float(sumColor0)) * factor;
+                sumWhite = sumWhite0 + (float(sumWhite1) - float(sumWhite0)) * factor;
+            }
+
+            return ComputePowerScale(*consumptionInfo, powerLimit_mA, count, sumColor, sumWhite);
+        }
+
+        template<typename Encode>
+        void renderPixels(const RGBW* pixels0, const RGBW* pixels1, ledoffset_t count, Encode encode) {
+            uint8_t* buffer = output.getWireBuffer();
+            const uint16_t scale = powerScale;
+
+            for (ledoffset_t i = 0; i < count; ++i) {
+                RGBW color = mixColor(pixels0, pixels1, i);
+
+                if (scale < 256) {
+                    color.r = (color.r * scale) >> 8;
+                    color.g = (color.g * scale) >> 8;
+                    color.b = (color.b * scale) >> 8;
+                    color.w = (color.w * scale) >> 8;
+                }
+
+                if (gammaTable) {
+                    const std::array<uint8_t, 256>& table = *gammaTable;
+
+                    color = RGBW(table[color.r], table[color.g], table[color.b], table[color.w]);
+                }
+
+                encode(buffer, i, color);
+            }
+        }
+
+    public:
+        FusedRenderPipeline(ILedWireOutput& output, ILedStripWithStorage& source) :
+            output(output),
+            source0(&source),
+            source1(nullptr),
+            fadeFactor(0),
+            consumptionInfo(),
+            powerLimit_mA(0.f),
+            powerScale(256),
+            gammaTable(nullptr),
+            whitePoint(),
+            scratch0(),
+            scratch1() {}
+
+        FusedRenderPipeline(const FusedRenderPipeline&) = delete;
+        FusedRenderPipeline& operator=(const FusedRenderPipeline&) = delete;
+
+        /**
+         * Renders only the given source.
+         */
+        void setSource(ILedStripWithStorage& source) {
+            source0 = &source;
+            source1 = nullptr;
+        }
+
+        /**
+         * Renders the cross fade between both sources (see LedStripCrossFadeHandler).
+         * \param factor value in [0.0, 1.0], 0 = only source0
+         */
+        void setCrossFade(ILedStripWithStorage& source0, ILedStripWithStorage& source1, float factor) {
+            this->source0 = &source0;
+            this->source1 = &source1;
+            setCrossFadeFactor(factor);
+        }
+
+        void setCrossFadeFactor(float factor) {
+            fadeFactor = uint16_t(std::min(std::max(factor, 0.f), 1.f) * 256.f + 0.5f);
+        }
+
+        void setPowerLimit(const LedPowerConsumptionInfo& consumptionInfo, float powerLimit_mA) {
+            this->consumptionInfo.emplace(consumptionInfo);
+            this->powerLimit_mA = powerLimit_mA;
+        }
+
+        void disablePowerLimit() {
+            consumptionInfo.reset();
+        }
+
+        /**
+         * Sets the gamma table applied to all channels after the power limit, nullptr to disable.
+         * Note: The LPD8806 encoding applies its own gamma correction in addition.
+         */
+        void setGammaTable(const std::array<uint8_t, 256>* gammaTable) {
+            this->gammaTable = gammaTable;
+        }
+
+        /**
+         * Enables the white extraction (see ExtractWhite()) for RGB content on RGBW leds.
+         * Applied before the power limit, so the lower consumption of the white channel is accounted.
+         */
+        void setWhiteExtraction(const WhitePoint& whitePoint) {
+            this->whitePoint.emplace(whitePoint);
+        }
+
+        void disableWhiteExtraction() {
+            whitePoint.reset();
+        }
+
+        /// \returns the brightness scale (8.8 fixed point) applied by the power limit in the last frame.
+        uint16_t getPowerScale() const {
+            return powerScale;
+        }
+
+        /**
+         * Renders the sources into the wire buffer and transmits it.
+         */
+        void render() {
+            ledoffset_t count = source0->getLedCount();
+
+            if (source1) {
+                count = std::min(count, source1->getLedCount());
+            }
+
+            count = std::min(count, getOutputLedCount());
+
+            const RGBW* pixels0 = GetPixels(*source0, count, scratch0);
+            const RGBW* pixels1 = nullptr;
+
+            // Skip the second source when it has no influence
+            if (source1 && fadeFactor > 0) {
+                pixels1 = GetPixels(*source1, count, scratch1);
+
+                if (fadeFactor == 256) {
+                    pixels0 = pixels1;
+                    pixels1 = nullptr;
+                }
+            }
+
+            {
+                ScopedStageTimer timer(InstrumentationStage::PowerLimit);
+                powerScale = computePowerScale(pixels0, pixels1, count);
+            }
+
+            {
+                ScopedStageTimer timer(InstrumentationStage::Encoding);
+
+                switch (output.getWireProtocol()) {
+                    case LedWireProtocol::APA102:
+                        renderPixels(pixels0, pixels1, count, [](uint8_t* buffer, size_t index, RGBW color) {
+                            APA102Encoding::EncodeLed(buffer, index, color);
+                        });
+                        break;
+                    case LedWireProtocol::LPD8806: {
+                        const std::array<uint8_t, 256>& lpdGammaTable = LPD8806Encoding::GetGammaTable();
+
+                        renderPixels(pixels0, pixels1, count, [&lpdGammaTable](uint8_t* buffer, size_t index, RGBW color) {
+                            LPD8806Encoding::EncodeLed(buffer, index, color, lpdGammaTable);
+                        });
+                        break;
+                    }
+                    case LedWireProtocol::WS2812:
+                        renderPixels(pixels0, pixels1, count, [](uint8_t* buffer, size_t index, RGBW color) {
+                            WS2812Encoding<false>::EncodeLed(buffer, index, color);
+                        });
+                        break;
+                    case LedWireProtocol::WS2812_RGBW:
+                        renderPixels(pixels0, pixels1, count, [](uint8_t* buffer, size_t index, RGBW color) {
+                            WS2812Encoding<true>::EncodeLed(buffer, index, color);
+                        });
+                        break;
+                }
+            }
+
+            output.transmitWireBuffer();
+        }
+};
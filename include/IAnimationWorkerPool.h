@@ -0,0 +1,22 @@
+#pragma once
+
+#include <functional>
+#include <stddef.h>
+
+/**
+* Interface for a pool of workers used by the AnimationManager to update animations in parallel.
+* See AnimationWorkerPool for an implementation based on std::thread.
+*/
+class IAnimationWorkerPool {
+    public:
+        virtual ~IAnimationWorkerPool() = default;
+
+        /// \returns the number of tasks which can be executed at the same time.
+        virtual size_t getWorkerCount() const = 0;
+
+        /**
+         * Executes task(i) for each i in [0, taskCount).
+         * Tasks may run in parallel, returns when all tasks are finished.
+         */
+        virtual void run(size_t taskCount, const std::function<void(size_t)>& task) = 0;
+};
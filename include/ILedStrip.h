@@ -8,6 +8,8 @@ typedef uint8_t ledoffset_t;
 
 class ILedStrip {
     public:
+        virtual ~ILedStrip() = default;
+
         virtual ledoffset_t getLedCount() const = 0;
 
         virtual void setLed(ledoffset_t index, RGBW color, bool flush = false) = 0;
@@ -22,6 +24,21 @@ class ILedStrip {
             }
         }
 
+        /**
+        * Sets count LEDs starting at index to the given colors.
+        * \param colors array with at least count entries
+        * \param flush performs a update to the physics leds
+        */
+        virtual void setLeds(ledoffset_t index, const RGBW* colors, ledoffset_t count, bool flush = false) {
+            for (ledoffset_t i = 0; i < count; ++i) {
+                setLed(index + i, colors[i], false);
+            }
+
+            if (flush) {
+                updateLeds();
+            }
+        }
+
         /**
         * Sets all LEDs to the specified color.
         * \param flush performs a update to the physics leds
@@ -9,6 +9,29 @@ class ILedStripWithStorage : public virtual ILedStrip {
     public:
         virtual RGBW getLed(ledoffset_t index) const = 0;
 
+        /**
+         * Reads count LEDs starting at index into the given output array.
+         * \param output array with at least count entries
+         */
+        virtual void getLeds(ledoffset_t index, RGBW* output, ledoffset_t count) const {
+            for (ledoffset_t i = 0; i < count; ++i) {
+                output[i] = getLed(index + i);
+            }
+        }
+
+        /// \returns the number of LEDs which are not off.
+        virtual ledoffset_t activeCount() const {
+            ledoffset_t count = 0;
+
+            for (ledoffset_t i = 0; i < getLedCount(); ++i) {
+                if (getLed(i) != COLOR_OFF) {
+                    count++;
+                }
+            }
+
+            return count;
+        }
+
         /// \returns true if any LED is not off, false otherwise.
         virtual bool isAnyActive() const {
             for (ledoffset_t i = 0; i < getLedCount(); ++i) {
@@ -20,6 +43,43 @@ class ILedStripWithStorage : public virtual ILedStrip {
             return false;
         }
 
+        /**
+         * Resolves the given index to the led strip which actually holds the led.
+         * Virtual led strips which only transform the index forward this to their base strip.
+         * \param inout_index returns the actual offset in the returned led strip.
+         * \returns the led strip which stores the led, this strip by default.
+         */
+        virtual ILedStripWithStorage& resolveLed(ledoffset_t& inout_index) {
+            (void)inout_index;
+            return *this;
+        }
+
+        /**
+         * \returns true when different leds of this strip may be written concurrently from different threads
+         * (e.g. by the parallel update of AnimationManager). False by default, as strips may share state
+         * between leds, like packed storage or caches.
+         */
+        virtual bool supportsConcurrentWrites() const {
+            return false;
+        }
+
+        /**
+         * \returns pointer to the contiguous pixel storage of this led strip, or nullptr when
+         * the strip does not store its leds as RGBW values.
+         * Writes through this pointer bypass setLed(), call updateLeds() afterwards.
+         * Holders which keep the pointer request it again before that, as the strip may track the writes.
+         */
+        virtual RGBW* getPixelBuffer() {
+            return nullptr;
+        }
+
+        /**
+         * \returns pointer to the contiguous pixel storage for reading, or nullptr like getPixelBuffer().
+         */
+        virtual const RGBW* getPixels() const {
+            return nullptr;
+        }
+
         /**
          * Copies the current content of this led strip to the given led strip
          * starting at offset 0. Checks for the size of the target.
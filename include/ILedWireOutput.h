@@ -0,0 +1,27 @@
+#pragma once
+
+#include "LedWireEncoding.h"
+
+#include <stddef.h>
+#include <stdint.h>
+
+/**
+* Interface for led drivers which expose their encoded wire buffer.
+* Allows render stages (e.g. FusedRenderPipeline) to encode directly into the buffer
+* which is transmitted, instead of writing each led via setLed().
+*/
+class ILedWireOutput {
+    public:
+        virtual ~ILedWireOutput() = default;
+
+        virtual LedWireProtocol getWireProtocol() const = 0;
+
+        /// \returns the buffer in the format of getWireProtocol(), including header and latch bytes.
+        virtual uint8_t* getWireBuffer() = 0;
+        virtual size_t getWireBufferSize() const = 0;
+
+        /**
+         * Transmits the wire buffer as it is, without encoding the leds again.
+         */
+        virtual void transmitWireBuffer() = 0;
+};
@@ -0,0 +1,182 @@
+#pragma once
+
+/**
+* Compile-time switchable timing instrumentation of the render stages.
+* Define LEDCONTROL_INSTRUMENTATION (e.g. "build_flags = -D LEDCONTROL_INSTRUMENTATION")
+* to record the timings, otherwise all timers are empty and cost nothing.
+*
+* Stages may be recorded from several threads (e.g. the audio analysis), see Instrumentation::Record().
+*/
+
+#include <atomic>
+#include <stdint.h>
+#include <stddef.h>
+
+#ifdef LEDCONTROL_INSTRUMENTATION
+#include <Arduino.h>
+#endif
+
+enum class InstrumentationStage : uint8_t {
+    AnimationUpdate,
+    Compositing,
+    PowerLimit,
+    Encoding,
+    Transmit,
+    AudioAnalysis,
+    Count
+};
+
+/**
+* Timing statistics of one stage.
+* The histogram uses power of two buckets: bucket 0 counts durations < 2 us,
+* bucket i durations in [2^i, 2^(i+1)) us, the last bucket all longer durations.
+*/
+struct StageStatistics {
+    static constexpr size_t HISTOGRAM_BUCKETS = 16;
+
+    uint32_t count;
+    uint64_t totalMicros;
+    uint32_t maxMicros;
+    uint32_t histogram[HISTOGRAM_BUCKETS];
+
+    static size_t GetBucket(uint32_t durationMicros) {
+        size_t bucket = 0;
+
+        while (bucket < HISTOGRAM_BUCKETS - 1 && (durationMicros >> (bucket + 1)) > 0) {
+            bucket++;
+        }
+
+        return bucket;
+    }
+
+    uint32_t getAverageMicros() const {
+        return count > 0 ? uint32_t(totalMicros / count) : 0;
+    }
+};
+
+class Instrumentation {
+    private:
+        /**
+        * Statistics of one stage as relaxed atomics, so stages may be recorded from any thread
+        * (e.g. the audio analysis) while another thread takes a snapshot.
+        * The fields of a snapshot may disagree by the records which happened during the snapshot.
+        */
+        struct AtomicStageStatistics {
+            std::atomic<uint32_t> count;
+            std::atomic<uint64_t> totalMicros;
+            std::atomic<uint32_t> maxMicros;
+            std::atomic<uint32_t> histogram[StageStatistics::HISTOGRAM_BUCKETS];
+
+            void add(uint32_t durationMicros) {
+                count.fetch_add(1, std::memory_order_relaxed);
+                totalMicros.fetch_add(durationMicros, std::memory_order_relaxed);
+                histogram[StageStatistics::GetBucket(durationMicros)].fetch_add(1, std::memory_order_relaxed);
+
+                uint32_t currentMax = maxMicros.load(std::memory_order_relaxed);
+                while (durationMicros > currentMax && !maxMicros.compare_exchange_weak(currentMax, durationMicros, std::memory_order_relaxed)) {}
+            }
+
+            /// Copies the statistics, resets them at the same time when reset is true.
+            void copyTo(StageStatistics& output, bool reset) {
+                output.count = reset ? count.exchange(0, std::memory_order_relaxed) : count.load(std::memory_order_relaxed);
+                output.totalMicros = reset ? totalMicros.exchange(0, std::memory_order_relaxed) : totalMicros.load(std::memory_order_relaxed);
+                output.maxMicros = reset ? maxMicros.exchange(0, std::memory_order_relaxed) : maxMicros.load(std::memory_order_relaxed);
+
+                for (size_t i = 0; i < StageStatistics::HISTOGRAM_BUCKETS; ++i) {
+                    output.histogram[i] = reset ? histogram[i].exchange(0, std::memory_order_relaxed) : histogram[i].load(std::memory_order_relaxed);
+                }
+            }
+        };
+
+        static AtomicStageStatistics* GetStatisticsArray() {
+            static AtomicStageStatistics statistics[size_t(InstrumentationStage::Count)] = {};
+            return statistics;
+        }
+
+    public:
+        static constexpr bool ENABLED =
+#ifdef LEDCONTROL_INSTRUMENTATION
+            true;
+#else
+            false;
+#endif
+
+        static const char* GetStageName(InstrumentationStage stage) {
+            switch (stage) {
+                case InstrumentationStage::AnimationUpdate:
+                    return "AnimationUpdate";
+                case InstrumentationStage::Compositing:
+                    return "Compositing";
+                case InstrumentationStage::PowerLimit:
+                    return "PowerLimit";
+                case InstrumentationStage::Encoding:
+                    return "Encoding";
+                case InstrumentationStage::Transmit:
+                    return "Transmit";
+                case InstrumentationStage::AudioAnalysis:
+                    return "AudioAnalysis";
+                default:
+                    return "Unknown";
+            }
+        }
+
+        static StageStatistics GetStatistics(InstrumentationStage stage) {
+            StageStatistics statistics;
+            GetStatisticsArray()[size_t(stage)].copyTo(statistics, false);
+            return statistics;
+        }
+
+        /// Records a duration of the stage, may be called from any thread.
+        static void Record(InstrumentationStage stage, uint32_t durationMicros) {
+            GetStatisticsArray()[size_t(stage)].add(durationMicros);
+        }
+
+        /**
+        * Copies the statistics of all stages and resets them at the same time,
+        * records of other threads are either in this or in the next snapshot.
+        * Call this periodically to get the timings per interval.
+        * \param output array with at least InstrumentationStage::Count entries
+        */
+        static void TakeSnapshot(StageStatistics* output) {
+            for (size_t i = 0; i < size_t(InstrumentationStage::Count); ++i) {
+                GetStatisticsArray()[i].copyTo(output[i], true);
+            }
+        }
+
+        static void Reset() {
+            StageStatistics discarded;
+
+            for (size_t i = 0; i < size_t(InstrumentationStage::Count); ++i) {
+                GetStatisticsArray()[i].copyTo(discarded, true);
+            }
+        }
+};
+
+#ifdef LEDCONTROL_INSTRUMENTATION
+
+/**
+* Measures the time between construction and destruction and records it for the stage.
+*/
+class ScopedStageTimer {
+    private:
+        InstrumentationStage stage;
+        uint32_t startTime;
+
+    public:
+        ScopedStageTimer(InstrumentationStage stage) :
+            stage(stage),
+            startTime(micros()) {}
+
+        ~ScopedStageTimer() {
+            Instrumentation::Record(stage, micros() - startTime);
+        }
+};
+
+#else
+
+class ScopedStageTimer {
+    public:
+        constexpr ScopedStageTimer(InstrumentationStage) {}
+};
+
+#endif
@@ -3,24 +3,102 @@
 #include "ILedStripWithStorage.h"
 
 #include <vector>
+#include <atomic>
+#include <algorithm>
 
 /**
  * Simple storage class.
  * Implements the ILedStripWithStorage interface but only stores the values.
+ * Keeps the number of active leds up to date, so isAnyActive() and activeCount() do not scan the leds.
+ * Writes through the pixel buffer (see getPixelBuffer()) are counted again once on the next updateLeds().
+ * See StaticLedBufferStorage for a variant without heap allocation.
  */
 class LedBufferStorage : public ILedStripWithStorage {
     private:
-        std::vector<RGBW> pixels;
+        std::vector<RGBW> ownPixels;
+        RGBW* pixels;
+        ledoffset_t ledCount;
+
+        // Number of leds which are not off, atomic as the parallel animation update writes different leds concurrently.
+        // Not maintained while dirty: The pixel buffer was handed out since the last updateLeds().
+        std::atomic<int16_t> countActive;
+        std::atomic<bool> countDirty;
+
+        static ledoffset_t CountActive(const RGBW* pixels, ledoffset_t count) {
+            return ledoffset_t(std::count_if(pixels, pixels + count, [](RGBW color) {
+                return color != COLOR_OFF;
+            }));
+        }
+
+        void addActive(int16_t delta) {
+            if (delta != 0 && !countDirty.load(std::memory_order_relaxed)) {
+                countActive.fetch_add(delta, std::memory_order_relaxed);
+            }
+        }
+
+    protected:
+        /**
+         * Uses the given buffer instead of an own allocation, the buffer must outlive this object.
+         */
+        LedBufferStorage(RGBW* externalPixels, ledoffset_t ledCount) :
+            ownPixels(),
+            pixels(externalPixels),
+            ledCount(ledCount),
+            countActive(CountActive(externalPixels, ledCount)),
+            countDirty(false) {}
+
+        /**
+         * Counts the active leds again when the pixel buffer was handed out since the last call.
+         * Subclasses which override updateLeds() call this.
+         */
+        void refreshActiveCount() {
+            if (countDirty.load(std::memory_order_relaxed)) {
+                countActive = CountActive(pixels, ledCount);
+                countDirty = false;
+            }
+        }
 
     public:
         LedBufferStorage(ledoffset_t ledCount) :
-            pixels(ledCount) {}
+            ownPixels(ledCount),
+            pixels(ownPixels.data()),
+            ledCount(ledCount),
+            countActive(0),
+            countDirty(false) {}
+
+        /// The copy always owns its pixels.
+        LedBufferStorage(const LedBufferStorage& other) :
+            ILedStripWithStorage(other),
+            ownPixels(other.pixels, other.pixels + other.ledCount),
+            pixels(ownPixels.data()),
+            ledCount(other.ledCount),
+            countActive(other.activeCount()),
+            countDirty(false) {}
+
+        LedBufferStorage& operator=(const LedBufferStorage& other) {
+            if (this == &other) {
+                return *this;
+            }
+
+            if (ledCount == other.ledCount) {
+                std::copy_n(other.pixels, ledCount, pixels);
+            } else {
+                ownPixels.assign(other.pixels, other.pixels + other.ledCount);
+                pixels = ownPixels.data();
+                ledCount = other.ledCount;
+            }
+
+            countActive = other.activeCount();
+            countDirty = false;
+            return *this;
+        }
 
         virtual ledoffset_t getLedCount() const override {
-            return pixels.size();
+            return ledCount;
         }
 
         virtual void setLed(ledoffset_t index, RGBW color, bool flush = false) override {
+            addActive(int16_t(color != COLOR_OFF) - int16_t(pixels[index] != COLOR_OFF));
             pixels[index] = color;
 
             if (flush) {
@@ -28,11 +106,80 @@ class LedBufferStorage : public ILedStripWithStorage {
             }
         }
 
+        virtual void setRange(ledoffset_t index, ledoffset_t count, RGBW color, bool flush = false) override {
+            if (!countDirty.load(std::memory_order_relaxed)) {
+                addActive(int16_t(color != COLOR_OFF ? count : 0) - int16_t(CountActive(pixels + index, count)));
+            }
+
+            std::fill_n(pixels + index, count, color);
+
+            if (flush) {
+                updateLeds();
+            }
+        }
+
+        virtual void setLeds(ledoffset_t index, const RGBW* colors, ledoffset_t count, bool flush = false) override {
+            if (!countDirty.load(std::memory_order_relaxed)) {
+                addActive(int16_t(CountActive(colors, count)) - int16_t(CountActive(pixels + index, count)));
+            }
+
+            std::copy_n(colors, count, pixels + index);
+
+            if (flush) {
+                updateLeds();
+            }
+        }
+
         virtual RGBW getLed(ledoffset_t index) const override {
             return pixels[index];
         }
 
+        virtual void getLeds(ledoffset_t index, RGBW* output, ledoffset_t count) const override {
+            std::copy_n(pixels + index, count, output);
+        }
+
+        /// Each led is stored separately.
+        virtual bool supportsConcurrentWrites() const override {
+            return true;
+        }
+
+        /**
+         * Until the next updateLeds() counts the active leds again, activeCount() and isAnyActive() scan the leds.
+         */
+        virtual RGBW* getPixelBuffer() override {
+            countDirty = true;
+            return pixels;
+        }
+
+        virtual const RGBW* getPixels() const override {
+            return pixels;
+        }
+
+        /// \returns true when activeCount() and isAnyActive() use the maintained count instead of scanning the leds.
+        bool isActiveCountValid() const {
+            return !countDirty.load(std::memory_order_relaxed);
+        }
+
+        virtual ledoffset_t activeCount() const override {
+            if (countDirty.load(std::memory_order_relaxed)) {
+                return CountActive(pixels, ledCount);
+            }
+
+            return ledoffset_t(countActive.load(std::memory_order_relaxed));
+        }
+
+        virtual bool isAnyActive() const override {
+            if (countDirty.load(std::memory_order_relaxed)) {
+                return std::any_of(pixels, pixels + ledCount, [](RGBW color) {
+                    return color != COLOR_OFF;
+                });
+            }
+
+            return countActive.load(std::memory_order_relaxed) > 0;
+        }
+
         virtual void updateLeds() override {
-            // This is only a storage, nothing to do here
+            // This is only a storage, only the active led count may need an update
+            refreshActiveCount();
         }
 };
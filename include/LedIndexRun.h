@@ -0,0 +1,55 @@
+#pragma once
+
+#include "ILedStrip.h"
+
+#include <vector>
+#include <algorithm>
+
+/**
+* Compression of led index mappings into runs of (baseIndex, count, stride),
+* shared by VirtualMappedLedStrip and VirtualFlattenedLedStrip.
+* A Run type provides at least the members offset, baseIndex, count and stride.
+*/
+
+/**
+* Appends the led at offset (mapped to baseIndex) to the runs. Extends the last run when the stride
+* to its last led fits into it, otherwise starts a new run.
+* \param extendable false to always start a new run (e.g. when the led is stored in another strip)
+* \returns the run which contains the led
+*/
+template<typename Run>
+inline Run& AppendLedIndexRun(std::vector<Run>& runs, ledoffset_t offset, ledoffset_t baseIndex, bool extendable = true) {
+    if (extendable && !runs.empty()) {
+        Run& run = runs.back();
+        int16_t previous = int16_t(run.baseIndex) + int16_t(run.count - 1) * run.stride;
+        int16_t stride = int16_t(baseIndex) - previous;
+        bool validStride = stride != 0 && stride >= INT8_MIN && stride <= INT8_MAX;
+
+        if (validStride && (run.count == 1 || stride == run.stride)) {
+            run.stride = int8_t(stride);
+            run.count++;
+            return run;
+        }
+    }
+
+    runs.emplace_back();
+
+    Run& run = runs.back();
+    run.offset = offset;
+    run.baseIndex = baseIndex;
+    run.count = 1;
+    run.stride = 1;
+    return run;
+}
+
+/**
+* \returns the run which contains the led at offset index, the runs must cover the index.
+*/
+template<typename Run>
+inline const Run& FindLedIndexRun(const std::vector<Run>& runs, ledoffset_t index) {
+    auto iter = std::upper_bound(runs.begin(), runs.end(), index, [](ledoffset_t value, const Run& run) {
+        return value < run.offset;
+    });
+
+    return *(iter - 1);
+}
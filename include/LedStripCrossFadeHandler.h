@@ -2,6 +2,7 @@
 
 #include <LedBufferStorageWithCallback.h>
 #include <LedBufferStorage.h>
+#include <Instrumentation.h>
 
 /**
 * Handler class to fade between two led strip states.
@@ -64,10 +65,14 @@ class LedStripCrossFadeHandler : public ILedBufferStorageCallback {
 		* Computes the cross-faded values and updates the target led strip.
 		*/
 		void updateLeds() {
-			for (ledoffset_t i = 0; i < target.getLedCount(); ++i) {
-				RGBW mixedColor = strip0.getLed(i).interpolateTo(strip1.getLed(i), factor);
+			{
+				ScopedStageTimer timer(InstrumentationStage::Compositing);
 
-				target.setLed(i, mixedColor);
+				for (ledoffset_t i = 0; i < target.getLedCount(); ++i) {
+					RGBW mixedColor = strip0.getLed(i).interpolateTo(strip1.getLed(i), factor);
+
+					target.setLed(i, mixedColor);
+				}
 			}
 
 			target.updateLeds();
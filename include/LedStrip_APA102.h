@@ -1,6 +1,12 @@
 #pragma once
 
 #include <ILedStripWithStorage.h>
+#include <FrameDeduplicator.h>
+#include <ILedWireOutput.h>
+#include <Instrumentation.h>
+#include <LedWireEncoding.h>
+#include <StaticLedBufferStorage.h>
+#include <SoftwareSPI.h>
 
 #include <vector>
 #include <Arduino.h>
@@ -10,80 +16,123 @@
 * They use two signals, clock + data.
 *
 * This implementation uses bit banging to transmit the data to the leds.
+* Frames identical to the last transmitted one are skipped, see getFrameDeduplicator().
 */
-class LedStrip_APA102 : public ILedStripWithStorage {
+class LedStrip_APA102 : public ILedStripWithStorage, public ILedWireOutput {
     private:
-        std::vector<uint8_t> sendBuffer;
+        std::vector<uint8_t> ownSendBuffer;
+        uint8_t* sendBuffer;
+        size_t sendBufferSize;
         uint16_t countLeds;
         uint16_t pinClock;
         uint16_t pinData;
+        FrameDeduplicator deduplicator;
 
-        static void WriteGPIO(const uint8_t* ptr, size_t length, uint16_t pinClock, uint16_t pinData) {
-            for (size_t i = 0; i < length; ++i) {
-                uint8_t byte = ptr[i];
+        void writeGPIO() {
+            SoftwareSPIWrite(sendBuffer, sendBufferSize, pinClock, pinData);
+        }
 
-                for (int j = 7; j >= 0; j--) {
-                    bool state = byte & (1 << j);
+        void init() {
+            // Set initial value (including header byte)
+            clear();
 
-                    digitalWrite(pinData, state);
-                    digitalWrite(pinClock, 1);
-                    digitalWrite(pinClock, 0);
-                }
-            }
+            pinMode(pinClock, OUTPUT);
+            pinMode(pinData, OUTPUT);
         }
 
-        void writeGPIO() {
-            WriteGPIO(sendBuffer.data(), sendBuffer.size(), pinClock, pinData);
+    protected:
+        /**
+         * Uses the given send buffer of APA102Encoding::GetBufferSize(countLeds) bytes instead of an own allocation.
+         */
+        LedStrip_APA102(uint8_t* externalSendBuffer, uint16_t countLeds, uint16_t pinClock, uint16_t pinData) :
+            ILedStripWithStorage(),
+            ownSendBuffer(),
+            sendBuffer(externalSendBuffer),
+            sendBufferSize(APA102Encoding::GetBufferSize(countLeds)),
+            countLeds(countLeds),
+            pinClock(pinClock),
+            pinData(pinData),
+            deduplicator() {
+
+            init();
         }
 
     public:
         LedStrip_APA102(uint16_t countLeds, uint16_t pinClock, uint16_t pinData) :
             ILedStripWithStorage(),
-            sendBuffer(4 + countLeds * 4),
+            ownSendBuffer(APA102Encoding::GetBufferSize(countLeds)),
+            sendBuffer(ownSendBuffer.data()),
+            sendBufferSize(ownSendBuffer.size()),
             countLeds(countLeds),
             pinClock(pinClock),
-            pinData(pinData) {
+            pinData(pinData),
+            deduplicator() {
 
-            // Set initial value (including header byte)
-            clear();
-
-            pinMode(pinClock, OUTPUT);
-            pinMode(pinData, OUTPUT);
+            init();
         }
 
+        LedStrip_APA102(const LedStrip_APA102&) = delete;
+        LedStrip_APA102& operator=(const LedStrip_APA102&) = delete;
+
         virtual void updateLeds() override {
+            transmitWireBuffer();
+        }
+
+        virtual LedWireProtocol getWireProtocol() const override {
+            return LedWireProtocol::APA102;
+        }
+
+        virtual uint8_t* getWireBuffer() override {
+            return sendBuffer;
+        }
+
+        virtual size_t getWireBufferSize() const override {
+            return sendBufferSize;
+        }
+
+        virtual void transmitWireBuffer() override {
+            if (!deduplicator.shouldTransmit(sendBuffer, sendBufferSize, millis())) {
+                return;
+            }
+
+            ScopedStageTimer timer(InstrumentationStage::Transmit);
             writeGPIO();
         }
 
-        void setLed(ledoffset_t index, RGBW color, uint8_t brightness, bool flush = false) {
-            size_t offset = 4 + index * 4;
+        FrameDeduplicator& getFrameDeduplicator() {
+            return deduplicator;
+        }
 
-            sendBuffer[offset + 0] = (0x07 << 5) | (brightness & 0b11111);
-            sendBuffer[offset + 1] = color.b;
-            sendBuffer[offset + 2] = color.g;
-            sendBuffer[offset + 3] = color.r;
+        void setLed(ledoffset_t index, RGBW color, uint8_t brightness, bool flush = false) {
+            APA102Encoding::EncodeLed(sendBuffer, index, color, brightness);
 
             if (flush)
                 updateLeds();
         }
 
         virtual void setLed(ledoffset_t index, RGBW color, bool flush = false) override {
-            uint8_t brightness = ((color.r > 0) | (color.g > 0) | (color.b > 0)) * 31;
-
-            setLed(index, color, brightness, flush);
+            setLed(index, color, APA102Encoding::GetBrightness(color), flush);
         }
 
         virtual RGBW getLed(ledoffset_t index) const override {
-            size_t offset = 4 + index * 4;
-
-            uint8_t r = sendBuffer[offset + 3];
-            uint8_t g = sendBuffer[offset + 2];
-            uint8_t b = sendBuffer[offset + 1];
-
-            return RGBW(r, g, b, 0);
+            return APA102Encoding::DecodeLed(sendBuffer, index);
         }
 
         virtual ledoffset_t getLedCount() const override {
             return countLeds;
         }
 };
+
+/**
+* LedStrip_APA102 with an in-object send buffer for LedCount leds, does not allocate memory.
+*/
+template<ledoffset_t LedCount>
+class StaticLedStrip_APA102 : private StaticBufferHolder<uint8_t, APA102Encoding::GetBufferSize(LedCount)>, public LedStrip_APA102 {
+    private:
+        typedef StaticBufferHolder<uint8_t, APA102Encoding::GetBufferSize(LedCount)> Holder;
+
+    public:
+        StaticLedStrip_APA102(uint16_t pinClock, uint16_t pinData) :
+            Holder(),
+            LedStrip_APA102(Holder::staticBuffer.data(), LedCount, pinClock, pinData) {}
+};
@@ -1,6 +1,11 @@
 #pragma once
 
-#include "LedBufferStorage.h"
+#include "StaticLedBufferStorage.h"
+#include "Instrumentation.h"
+#include "FrameDeduplicator.h"
+#include "ILedWireOutput.h"
+#include "LedWireEncoding.h"
+#include "SoftwareSPI.h"
 
 #include <array>
 #include <Arduino.h>
@@ -11,69 +16,148 @@
 *
 * This implementation uses bit banging to transmit the data to the leds.
 * Also it directly applies gamma correction before sending the data to the leds.
+* Frames identical to the last transmitted one are skipped, see getFrameDeduplicator().
+*
+* Note: Frames rendered directly into the wire buffer (ILedWireOutput) are not reflected by getLed().
 */
-class LedStrip_LPD8806 : public LedBufferStorage {
+class LedStrip_LPD8806 : public LedBufferStorage, public ILedWireOutput {
     private:
-        std::vector<uint8_t> sendBuffer;
+        std::vector<uint8_t> ownSendBuffer;
+        uint8_t* sendBuffer;
+        size_t sendBufferSize;
         uint16_t pinClock;
         uint16_t pinData;
+        FrameDeduplicator deduplicator;
+
+    protected:
+        /**
+         * Uses the given buffers (countLeds pixels, LPD8806Encoding::GetBufferSize(countLeds) bytes to send)
+         * instead of own allocations.
+         */
+        LedStrip_LPD8806(RGBW* externalPixels, uint8_t* externalSendBuffer, ledoffset_t countLeds, uint16_t pinClock, uint16_t pinData) :
+            LedBufferStorage(externalPixels, countLeds),
+            ownSendBuffer(),
+            sendBuffer(externalSendBuffer),
+            sendBufferSize(LPD8806Encoding::GetBufferSize(countLeds)),
+            pinClock(pinClock),
+            pinData(pinData),
+            deduplicator() {
 
-        static std::array<uint8_t, 256> CreateGammaTable() {
-            std::array<uint8_t, 256> table;
+            pinMode(pinClock, OUTPUT);
+            pinMode(pinData, OUTPUT);
+        }
 
-            for (uint32_t i = 0; i < 256; ++i) {
-                table[i] = 0x80 | (uint32_t)(pow((float)i / 255.0f, 2.5f) * 127.0 + 0.5f);
-            }
+    public:
+        LedStrip_LPD8806(ledoffset_t countLeds, uint16_t pinClock, uint16_t pinData) :
+            LedBufferStorage(countLeds),
+            ownSendBuffer(LPD8806Encoding::GetBufferSize(countLeds)),
+            sendBuffer(ownSendBuffer.data()),
+            sendBufferSize(ownSendBuffer.size()),
+            pinClock(pinClock),
+            pinData(pinData),
+            deduplicator() {
 
-            return table;
+            pinMode(pinClock, OUTPUT);
+            pinMode(pinData, OUTPUT);
         }
 
-        // TODO: Extract to own header
-        static void WriteGPIO(const uint8_t* ptr, size_t length, uint16_t pinClock, uint16_t pinData) {
-            for (size_t i = 0; i < length; ++i) {
-                uint8_t byte = ptr[i];
+        LedStrip_LPD8806(const LedStrip_LPD8806&) = delete;
+        LedStrip_LPD8806& operator=(const LedStrip_LPD8806&) = delete;
+
+        virtual void updateLeds() override {
+            {
+                ScopedStageTimer timer(InstrumentationStage::Encoding);
 
-                for (int j = 7; j >= 0; j--) {
-                    bool state = byte & (1 << j);
+                // Encode all leds in one pass, then transmit
+                const std::array<uint8_t, 256>& gammaTable = getGammaTable();
+                const RGBW* pixels = getPixels();
 
-                    digitalWrite(pinData, state);
-                    digitalWrite(pinClock, 1);
-                    digitalWrite(pinClock, 0);
+                for (ledoffset_t i = 0; i < getLedCount(); ++i) {
+                    LPD8806Encoding::EncodeLed(sendBuffer, i, pixels[i], gammaTable);
                 }
             }
+
+            transmitWireBuffer();
         }
 
-    public:
-        LedStrip_LPD8806(ledoffset_t countLeds, uint16_t pinClock, uint16_t pinData) :
-            LedBufferStorage(countLeds),
-            sendBuffer(countLeds * 3 + 3),
-            pinClock(pinClock),
-            pinData(pinData) {
+        virtual LedWireProtocol getWireProtocol() const override {
+            return LedWireProtocol::LPD8806;
+        }
 
-            pinMode(pinClock, OUTPUT);
-            pinMode(pinData, OUTPUT);
+        virtual uint8_t* getWireBuffer() override {
+            return sendBuffer;
         }
 
-        virtual void updateLeds() override {
-            WriteGPIO(sendBuffer.data(), sendBuffer.size(), pinClock, pinData);
+        virtual size_t getWireBufferSize() const override {
+            return sendBufferSize;
+        }
+
+        virtual void transmitWireBuffer() override {
+            if (!deduplicator.shouldTransmit(sendBuffer, sendBufferSize, millis())) {
+                return;
+            }
+
+            ScopedStageTimer timer(InstrumentationStage::Transmit);
+            SoftwareSPIWrite(sendBuffer, sendBufferSize, pinClock, pinData);
         }
 
         virtual void setLed(ledoffset_t index, RGBW color, bool flush = false) override {
             color.w = 0;    // This led strip does not support the W component
 
             LedBufferStorage::setLed(index, color, flush);
+        }
 
-            sendBuffer[index * 3 + 0] = getGammaTable()[color.r];
-            sendBuffer[index * 3 + 1] = getGammaTable()[color.g];
-            sendBuffer[index * 3 + 2] = getGammaTable()[color.b];
+        virtual void setRange(ledoffset_t index, ledoffset_t count, RGBW color, bool flush = false) override {
+            color.w = 0;
+
+            LedBufferStorage::setRange(index, count, color, flush);
+        }
+
+        virtual void setLeds(ledoffset_t index, const RGBW* colors, ledoffset_t count, bool flush = false) override {
+            for (ledoffset_t i = 0; i < count; ++i) {
+                RGBW color = colors[i];
+                color.w = 0;
+
+                LedBufferStorage::setLed(index + i, color, false);
+            }
 
             if (flush) {
                 updateLeds();
             }
         }
 
+        /**
+         * Not available, this led strip does not support the W component:
+         * Writes have to go through setLed(), which drops it.
+         */
+        virtual RGBW* getPixelBuffer() override {
+            return nullptr;
+        }
+
+        FrameDeduplicator& getFrameDeduplicator() {
+            return deduplicator;
+        }
+
         const std::array<uint8_t, 256>& getGammaTable() const {
-            static std::array<uint8_t, 256> GammaTable = CreateGammaTable();
-            return GammaTable;
+            return LPD8806Encoding::GetGammaTable();
         }
 };
+
+/**
+* LedStrip_LPD8806 with in-object pixel and send buffers for LedCount leds, does not allocate memory.
+*/
+template<ledoffset_t LedCount>
+class StaticLedStrip_LPD8806 :
+        private StaticBufferHolder<RGBW, LedCount>,
+        private StaticBufferHolder<uint8_t, LPD8806Encoding::GetBufferSize(LedCount)>,
+        public LedStrip_LPD8806 {
+    private:
+        typedef StaticBufferHolder<RGBW, LedCount> PixelHolder;
+        typedef StaticBufferHolder<uint8_t, LPD8806Encoding::GetBufferSize(LedCount)> SendBufferHolder;
+
+    public:
+        StaticLedStrip_LPD8806(uint16_t pinClock, uint16_t pinData) :
+            PixelHolder(),
+            SendBufferHolder(),
+            LedStrip_LPD8806(PixelHolder::staticBuffer.data(), SendBufferHolder::staticBuffer.data(), LedCount, pinClock, pinData) {}
+};
@@ -7,6 +7,8 @@
 #include <NeoPixelBus.h>
 
 #include "ILedStripWithStorage.h"
+#include "Instrumentation.h"
+#include "FrameDeduplicator.h"
 
 #include <type_traits>
 
@@ -18,15 +20,19 @@
  * LedStrip_NeoPixelBus<NeoGrbwFeature, NeoEsp32Rmt0Ws2812xMethod>
  * for RGBW leds with RMT control.
  * Note to use different RMT channels when controlling multiple strips!
+ *
+ * Frames identical to the last transmitted one are skipped, see getFrameDeduplicator().
  */
 template<typename T_COLOR_FEATURE, typename T_METHOD>
 class LedStrip_NeoPixelBus : public ILedStripWithStorage {
 	private:
 		NeoPixelBus<T_COLOR_FEATURE, T_METHOD> leds;
+		FrameDeduplicator deduplicator;
 
 	public:
 		LedStrip_NeoPixelBus(ledoffset_t countLeds, uint16_t pin) :
-			leds(countLeds, pin) {
+			leds(countLeds, pin),
+			deduplicator() {
 
 			leds.Begin();
 		}
@@ -46,11 +52,22 @@ class LedStrip_NeoPixelBus : public ILedStripWithStorage {
 		}
 
 		virtual void updateLeds() override {
+			if (!deduplicator.shouldTransmit(leds.Pixels(), leds.PixelsSize(), millis())) {
+				return;
+			}
+
+			ScopedStageTimer timer(InstrumentationStage::Transmit);
+
 			// Explicit set dirty to force a update of the physical leds
+			// (the dirty flag of NeoPixelBus is also set by writes with unchanged colors)
 			leds.Dirty();
 			leds.Show();
 		}
 
+		FrameDeduplicator& getFrameDeduplicator() {
+			return deduplicator;
+		}
+
 		virtual ledoffset_t getLedCount() const override {
 			return leds.PixelCount();
 		}
@@ -8,18 +8,26 @@
 
 #include "ILedStripWithStorage.h"
 #include "IGPIOMappedDevice.h"
+#include "Instrumentation.h"
+#include "FrameDeduplicator.h"
 
 /**
 * Leds strip with storage implementation of the NeoPixel protocol.
 * Uses the Adafruid NeoPixel library.
+* Frames identical to the last transmitted one are skipped, see getFrameDeduplicator().
 */
 class LedStrip_Neopixel : public ILedStripWithStorage, IGPIOMappedDevice {
 	private:
 		Adafruit_NeoPixel leds;
+		uint8_t bytesPerLed;
+		FrameDeduplicator deduplicator;
 
 	public:
 		LedStrip_Neopixel(uint16_t countLeds, uint16_t pin, neoPixelType type = NEO_GRBW + NEO_KHZ800) :
-			leds(countLeds, pin, type) {
+			leds(countLeds, pin, type),
+			// Same as in Adafruit_NeoPixel: W offset == R offset means no W channel
+			bytesPerLed(((type >> 6) & 0b11) == ((type >> 4) & 0b11) ? 3 : 4),
+			deduplicator() {
 
 			leds.begin();
 		}
@@ -33,9 +41,18 @@ class LedStrip_Neopixel : public ILedStripWithStorage, IGPIOMappedDevice {
 		}
 
 		virtual void updateLeds() {
+			if (!deduplicator.shouldTransmit(leds.getPixels(), size_t(leds.numPixels()) * bytesPerLed, millis())) {
+				return;
+			}
+
+			ScopedStageTimer timer(InstrumentationStage::Transmit);
 			leds.show();
 		}
 
+		FrameDeduplicator& getFrameDeduplicator() {
+			return deduplicator;
+		}
+
 		virtual ledoffset_t getLedCount() const {
 			return leds.numPixels();
 		}
@@ -0,0 +1,162 @@
+#pragma once
+
+#include "LedBufferStorage.h"
+#include "LedWireEncoding.h"
+#include "Instrumentation.h"
+#include "FrameDeduplicator.h"
+#include "ILedWireOutput.h"
+
+#include <deque>
+#include <vector>
+
+/**
+* Headless led strip for native builds (tests, benchmarks, CI).
+* Encodes each frame exactly like the hardware drivers and records the encoded frames in memory
+* instead of transmitting them. Additionally accumulates the time the transmission would take
+* on the wire, based on the given LedWireTiming.
+*
+* The frame deduplication of the hardware drivers is disabled by default, enable it via
+* getFrameDeduplicator() and drive its keep alive clock with setCurrentTime().
+*/
+class LedStrip_Simulated : public LedBufferStorage, public ILedWireOutput {
+    private:
+        LedWireTiming timing;
+        std::vector<uint8_t> sendBuffer;
+
+        std::deque<std::vector<uint8_t>> recordedFrames;
+        size_t maxRecordedFrames;
+
+        uint32_t frameCount;
+        uint64_t totalWireTime_us;
+
+        FrameDeduplicator deduplicator;
+        uint32_t currentTime_ms;
+
+        void encode() {
+            const RGBW* pixels = getPixels();
+            uint8_t* buffer = sendBuffer.data();
+
+            for (ledoffset_t i = 0; i < getLedCount(); ++i) {
+                switch (timing.protocol) {
+                    case LedWireProtocol::APA102:
+                        APA102Encoding::EncodeLed(buffer, i, pixels[i]);
+                        break;
+                    case LedWireProtocol::LPD8806:
+                        LPD8806Encoding::EncodeLed(buffer, i, pixels[i]);
+                        break;
+                    case LedWireProtocol::WS2812:
+                        WS2812Encoding<false>::EncodeLed(buffer, i, pixels[i]);
+                        break;
+                    case LedWireProtocol::WS2812_RGBW:
+                        WS2812Encoding<true>::EncodeLed(buffer, i, pixels[i]);
+                        break;
+                }
+            }
+        }
+
+    public:
+        /**
+         * \param maxRecordedFrames number of frames to keep, older frames are dropped (0 disables the recording)
+         */
+        LedStrip_Simulated(ledoffset_t countLeds, const LedWireTiming& timing, size_t maxRecordedFrames = 1) :
+            LedBufferStorage(countLeds),
+            timing(timing),
+            sendBuffer(LedWireTiming::GetFrameSize(timing.protocol, countLeds)),
+            recordedFrames(),
+            maxRecordedFrames(maxRecordedFrames),
+            frameCount(0),
+            totalWireTime_us(0),
+            deduplicator(FrameDeduplicator::DEFAULT_KEEP_ALIVE_MS, false),
+            currentTime_ms(0) {}
+
+        LedStrip_Simulated(ledoffset_t countLeds, LedWireProtocol protocol, size_t maxRecordedFrames = 1) :
+            LedStrip_Simulated(countLeds, LedWireTiming::GetDefault(protocol), maxRecordedFrames) {}
+
+        virtual void updateLeds() override {
+            refreshActiveCount();
+
+            {
+                ScopedStageTimer timer(InstrumentationStage::Encoding);
+                encode();
+            }
+
+            transmitWireBuffer();
+        }
+
+        virtual LedWireProtocol getWireProtocol() const override {
+            return timing.protocol;
+        }
+
+        virtual uint8_t* getWireBuffer() override {
+            return sendBuffer.data();
+        }
+
+        virtual size_t getWireBufferSize() const override {
+            return sendBuffer.size();
+        }
+
+        virtual void transmitWireBuffer() override {
+            if (!deduplicator.shouldTransmit(sendBuffer.data(), sendBuffer.size(), currentTime_ms)) {
+                return;
+            }
+
+            if (maxRecordedFrames > 0) {
+                if (recordedFrames.size() >= maxRecordedFrames) {
+                    recordedFrames.pop_front();
+                }
+
+                recordedFrames.push_back(sendBuffer);
+            }
+
+            frameCount++;
+            totalWireTime_us += getFrameTime_us();
+        }
+
+        const LedWireTiming& getTiming() const {
+            return timing;
+        }
+
+        /// \returns the encoded data of the last frame.
+        const std::vector<uint8_t>& getSendBuffer() const {
+            return sendBuffer;
+        }
+
+        /// \returns the recorded frames, the oldest first.
+        const std::deque<std::vector<uint8_t>>& getRecordedFrames() const {
+            return recordedFrames;
+        }
+
+        void clearRecordedFrames() {
+            recordedFrames.clear();
+        }
+
+        /// \returns the number of frames transmitted since construction or resetStatistics().
+        uint32_t getFrameCount() const {
+            return frameCount;
+        }
+
+        /// \returns the modeled wire time of one frame of this strip.
+        uint32_t getFrameTime_us() const {
+            return timing.getFrameTime_us(getLedCount());
+        }
+
+        /// \returns the summed modeled wire time of all frames since construction or resetStatistics().
+        uint64_t getTotalWireTime_us() const {
+            return totalWireTime_us;
+        }
+
+        void resetStatistics() {
+            frameCount = 0;
+            totalWireTime_us = 0;
+            deduplicator.resetSkippedCount();
+        }
+
+        FrameDeduplicator& getFrameDeduplicator() {
+            return deduplicator;
+        }
+
+        /// Sets the time used for the keep alive interval of the frame deduplication.
+        void setCurrentTime(uint32_t currentTime_ms) {
+            this->currentTime_ms = currentTime_ms;
+        }
+};
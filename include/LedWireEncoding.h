@@ -0,0 +1,189 @@
+#pragma once
+
+#include "RGBW.h"
+
+#include <array>
+#include <math.h>
+#include <stddef.h>
+#include <stdint.h>
+
+/**
+* Wire format encodings of the supported led controllers.
+* Used by the hardware drivers and by LedStrip_Simulated, so both produce identical frames.
+*/
+enum class LedWireProtocol : uint8_t {
+    APA102,
+    LPD8806,
+    WS2812,     ///< GRB byte order
+    WS2812_RGBW ///< GRBW byte order (e.g. SK6812)
+};
+
+/**
+* APA102: 4 byte start frame (zeros), then per led 0b111 + 5 bit brightness, blue, green, red.
+*/
+struct APA102Encoding {
+    static constexpr size_t HEADER_SIZE = 4;
+    static constexpr size_t BYTES_PER_LED = 4;
+
+    static constexpr size_t GetBufferSize(size_t ledCount) {
+        return HEADER_SIZE + ledCount * BYTES_PER_LED;
+    }
+
+    /// \returns the global brightness used for the given color, full brightness unless all colors are off.
+    static uint8_t GetBrightness(RGBW color) {
+        return ((color.r > 0) | (color.g > 0) | (color.b > 0)) * 31;
+    }
+
+    static void EncodeLed(uint8_t* buffer, size_t index, RGBW color, uint8_t brightness) {
+        uint8_t* ptr = buffer + HEADER_SIZE + index * BYTES_PER_LED;
+
+        ptr[0] = (0x07 << 5) | (brightness & 0b11111);
+        ptr[1] = color.b;
+        ptr[2] = color.g;
+        ptr[3] = color.r;
+    }
+
+    static void EncodeLed(uint8_t* buffer, size_t index, RGBW color) {
+        EncodeLed(buffer, index, color, GetBrightness(color));
+    }
+
+    static RGBW DecodeLed(const uint8_t* buffer, size_t index) {
+        const uint8_t* ptr = buffer + HEADER_SIZE + index * BYTES_PER_LED;
+        return RGBW(ptr[3], ptr[2], ptr[1], 0);
+    }
+};
+
+/**
+* LPD8806: per led red, green, blue as 7 bit values with the MSB set (gamma corrected),
+* followed by 3 latch bytes (zeros).
+*/
+struct LPD8806Encoding {
+    static constexpr size_t BYTES_PER_LED = 3;
+    static constexpr size_t LATCH_SIZE = 3;
+
+    static constexpr size_t GetBufferSize(size_t ledCount) {
+        return ledCount * BYTES_PER_LED + LATCH_SIZE;
+    }
+
+    static std::array<uint8_t, 256> CreateGammaTable() {
+        std::array<uint8_t, 256> table;
+
+        for (uint32_t i = 0; i < 256; ++i) {
+            table[i] = 0x80 | (uint32_t)(pow((float)i / 255.0f, 2.5f) * 127.0 + 0.5f);
+        }
+
+        return table;
+    }
+
+    static const std::array<uint8_t, 256>& GetGammaTable() {
+        static const std::array<uint8_t, 256> GammaTable = CreateGammaTable();
+        return GammaTable;
+    }
+
+    static void EncodeLed(uint8_t* buffer, size_t index, RGBW color, const std::array<uint8_t, 256>& gammaTable = GetGammaTable()) {
+        uint8_t* ptr = buffer + index * BYTES_PER_LED;
+
+        ptr[0] = gammaTable[color.r];
+        ptr[1] = gammaTable[color.g];
+        ptr[2] = gammaTable[color.b];
+    }
+};
+
+/**
+* WS2812 / SK6812: per led green, red, blue (and white), no header or latch bytes.
+* The latch is a low period on the data line (reset time).
+*/
+template<bool WithWhite>
+struct WS2812Encoding {
+    static constexpr size_t BYTES_PER_LED = WithWhite ? 4 : 3;
+
+    static constexpr size_t GetBufferSize(size_t ledCount) {
+        return ledCount * BYTES_PER_LED;
+    }
+
+    static void EncodeLed(uint8_t* buffer, size_t index, RGBW color) {
+        uint8_t* ptr = buffer + index * BYTES_PER_LED;
+
+        ptr[0] = color.g;
+        ptr[1] = color.r;
+        ptr[2] = color.b;
+
+        if (WithWhite) {
+            ptr[3] = color.w;
+        }
+    }
+};
+
+/**
+* Timing model for the transmission of one frame.
+*/
+struct LedWireTiming {
+    LedWireProtocol protocol;
+    uint32_t bitRate_Hz;        ///< Clock rate for APA102 / LPD8806, bit rate for WS2812 (usually 800 kHz)
+    uint32_t latchTime_us;      ///< Additional idle time per frame (WS2812 reset time)
+    uint8_t parallelOutputs;    ///< Number of outputs transmitting at the same time
+
+    LedWireTiming(LedWireProtocol protocol, uint32_t bitRate_Hz, uint32_t latchTime_us = 0, uint8_t parallelOutputs = 1) :
+        protocol(protocol),
+        bitRate_Hz(bitRate_Hz),
+        latchTime_us(latchTime_us),
+        parallelOutputs(parallelOutputs) {}
+
+    /// \returns the default timing of the protocol (1 MHz clock for SPI-like protocols, 800 kHz + 300 us reset for WS2812).
+    static LedWireTiming GetDefault(LedWireProtocol protocol, uint8_t parallelOutputs = 1) {
+        switch (protocol) {
+            case LedWireProtocol::WS2812:
+            case LedWireProtocol::WS2812_RGBW:
+                return LedWireTiming(protocol, 800000, 300, parallelOutputs);
+            default:
+                return LedWireTiming(protocol, 1000000, 0, parallelOutputs);
+        }
+    }
+
+    /// \returns the size of one encoded frame in bytes.
+    static size_t GetFrameSize(LedWireProtocol protocol, size_t ledCount) {
+        switch (protocol) {
+            case LedWireProtocol::APA102:
+                return APA102Encoding::GetBufferSize(ledCount);
+            case LedWireProtocol::LPD8806:
+                return LPD8806Encoding::GetBufferSize(ledCount);
+            case LedWireProtocol::WS2812:
+                return WS2812Encoding<false>::GetBufferSize(ledCount);
+            case LedWireProtocol::WS2812_RGBW:
+                return WS2812Encoding<true>::GetBufferSize(ledCount);
+        }
+
+        return 0;
+    }
+
+    /**
+     * \returns the time to transmit one frame in microseconds,
+     * with the leds split evenly over all parallel outputs.
+     */
+    uint32_t getFrameTime_us(size_t ledCount) const {
+        size_t ledsPerOutput = (ledCount + parallelOutputs - 1) / parallelOutputs;
+        uint64_t bits = uint64_t(GetFrameSize(protocol, ledsPerOutput)) * 8;
+
+        return uint32_t((bits * 1000000 + bitRate_Hz - 1) / bitRate_Hz) + latchTime_us;
+    }
+
+    /// \returns the maximum frame rate for the given number of leds.
+    float getMaxFrameRate(size_t ledCount) const {
+        return 1e6f / float(getFrameTime_us(ledCount));
+    }
+
+    /// \returns the maximum number of leds per output which can be updated with the given frame rate.
+    size_t getMaxLedsPerOutput(float framesPerSecond) const {
+        uint64_t frameTime_us = uint64_t(1e6f / framesPerSecond);
+
+        if (frameTime_us <= latchTime_us) {
+            return 0;
+        }
+
+        uint64_t bytes = (frameTime_us - latchTime_us) * bitRate_Hz / 8 / 1000000;
+        size_t overhead = GetFrameSize(protocol, 0);
+        size_t bytesPerLed = GetFrameSize(protocol, 1) - overhead;
+
+        return bytes > overhead ? (bytes - overhead) / bytesPerLed : 0;
+    }
+};
@@ -0,0 +1,118 @@
+#pragma once
+
+#include <atomic>
+#include <memory>
+#include <stddef.h>
+
+/**
+* Bounded lock-free queue for multiple producers and consumers.
+* push() and pop() never block and never allocate, so they can be used
+* from other threads or interrupt handlers.
+*
+* Based on the bounded MPMC queue by Dmitry Vyukov, each cell carries a sequence number
+* which tells producers and consumers whether the cell is free or filled.
+*/
+template<typename T>
+class LockFreeQueue {
+    private:
+        struct Cell {
+            std::atomic<size_t> sequence;
+            T data;
+        };
+
+        std::unique_ptr<Cell[]> cells;
+        const size_t mask;
+
+        std::atomic<size_t> enqueuePosition;
+        std::atomic<size_t> dequeuePosition;
+
+        static size_t RoundUpToPowerOfTwo(size_t value) {
+            size_t result = 1;
+
+            while (result < value) {
+                result <<= 1;
+            }
+
+            return result;
+        }
+
+    public:
+        /**
+         * \param capacity maximum number of elements, rounded up to the next power of two.
+         */
+        LockFreeQueue(size_t capacity) :
+            cells(new Cell[RoundUpToPowerOfTwo(capacity)]),
+            mask(RoundUpToPowerOfTwo(capacity) - 1),
+            enqueuePosition(0),
+            dequeuePosition(0) {
+
+            for (size_t i = 0; i <= mask; ++i) {
+                cells[i].sequence.store(i, std::memory_order_relaxed);
+            }
+        }
+
+        LockFreeQueue(const LockFreeQueue&) = delete;
+        LockFreeQueue& operator=(const LockFreeQueue&) = delete;
+
+        size_t capacity() const {
+            return mask + 1;
+        }
+
+        /**
+         * Adds the value to the queue.
+         * \returns true on success, false when the queue is full.
+         */
+        bool push(const T& value) {
+            size_t position = enqueuePosition.load(std::memory_order_relaxed);
+
+            while (true) {
+                Cell& cell = cells[position & mask];
+                size_t sequence = cell.sequence.load(std::memory_order_acquire);
+                intptr_t diff = intptr_t(sequence) - intptr_t(position);
+
+                if (diff == 0) {
+                    if (enqueuePosition.compare_exchange_weak(position, position + 1, std::memory_order_relaxed)) {
+                        cell.data = value;
+                        cell.sequence.store(position + 1, std::memory_order_release);
+                        return true;
+                    }
+                } else if (diff < 0) {
+                    return false;
+                } else {
+                    position = enqueuePosition.load(std::memory_order_relaxed);
+                }
+            }
+        }
+
+        /**
+         * Removes the oldest value from the queue.
+         * \param output Output variable for the value, only defined when the return value is true.
+         * \returns true on success, false when the queue is empty.
+         */
+        bool pop(T& output) {
+            size_t position = dequeuePosition.load(std::memory_order_relaxed);
+
+            while (true) {
+                Cell& cell = cells[position & mask];
+                size_t sequence = cell.sequence.load(std::memory_order_acquire);
+                intptr_t diff = intptr_t(sequence) - intptr_t(position + 1);
+
+                if (diff == 0) {
+                    if (dequeuePosition.compare_exchange_weak(position, position + 1, std::memory_order_relaxed)) {
+                        output = cell.data;
+                        cell.sequence.store(position + mask + 1, std::memory_order_release);
+                        return true;
+                    }
+                } else if (diff < 0) {
+                    return false;
+                } else {
+                    position = dequeuePosition.load(std::memory_order_relaxed);
+                }
+            }
+        }
+
+        /// \returns true when the queue was empty at the time of the call.
+        bool empty() const {
+            return enqueuePosition.load(std::memory_order_acquire) == dequeuePosition.load(std::memory_order_acquire);
+        }
+};
@@ -0,0 +1,71 @@
+#pragma once
+
+#include <stdint.h>
+#include <stddef.h>
+
+#if defined(__unix__) || defined(__APPLE__)
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#define LEDCONTROL_HAS_MMAP
+#endif
+
+#ifdef LEDCONTROL_HAS_MMAP
+
+/**
+* Read-only memory mapped file, e.g. to play frame streams or audio files without copying them into memory.
+*/
+class MappedFile {
+    private:
+        const uint8_t* data;
+        size_t size;
+
+    public:
+        MappedFile(const char* fileName) :
+            data(nullptr),
+            size(0) {
+
+            int fd = open(fileName, O_RDONLY);
+
+            if (fd < 0) {
+                return;
+            }
+
+            struct stat info;
+
+            if (fstat(fd, &info) == 0 && info.st_size > 0) {
+                void* ptr = mmap(nullptr, info.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+
+                if (ptr != MAP_FAILED) {
+                    data = static_cast<const uint8_t*>(ptr);
+                    size = info.st_size;
+                }
+            }
+
+            close(fd);
+        }
+
+        MappedFile(const MappedFile&) = delete;
+        MappedFile& operator=(const MappedFile&) = delete;
+
+        ~MappedFile() {
+            if (data) {
+                munmap(const_cast<uint8_t*>(data), size);
+            }
+        }
+
+        bool isOpen() const {
+            return data != nullptr;
+        }
+
+        const uint8_t* getData() const {
+            return data;
+        }
+
+        size_t getSize() const {
+            return size;
+        }
+};
+
+#endif
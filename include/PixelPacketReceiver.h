@@ -0,0 +1,471 @@
+#pragma once
+
+#include "ILedStripWithStorage.h"
+
+#include <vector>
+#include <algorithm>
+#include <string.h>
+
+/**
+* Result of handling one received network packet.
+*/
+enum class PixelPacketResult : uint8_t {
+    Invalid,    ///< Malformed packet or wrong protocol
+    Ignored,    ///< Valid packet, but not for this receiver (other universe, query, preview data, out of order, ...)
+    Written,    ///< Pixel data was written, waiting for the frame sync
+    Displayed   ///< The frame was completed and the led strips were updated
+};
+
+/**
+* Maps the linear channel space of a network pixel protocol onto led strips.
+* Strips are appended one after another, so the first led of a strip directly follows
+* the last led of the previous strip.
+*
+* Each strip is resolved via ILedStripWithStorage::resolveLed(), contiguous ranges of leds
+* which end in a pixel buffer are written directly into that buffer without temporaries.
+* All other leds are written via setLed() of the added strip.
+*/
+class PixelPacketTarget {
+    private:
+        struct Segment {
+            uint32_t firstLed;          // Global led index of the first led
+            ledoffset_t count;
+            ledoffset_t stripIndex;     // Index of the first led in the added strip
+            RGBW* pixels;               // Direct storage of the first led, nullptr if not available
+            ILedStripWithStorage* leaf; // Strip which owns the direct storage
+            uint8_t source;
+        };
+
+        struct Source {
+            ILedStripWithStorage* strip;
+            bool dirty;
+        };
+
+        std::vector<Source> sources;
+        std::vector<Segment> segments;
+        uint32_t ledCount;
+        uint8_t bytesPerLed;
+
+        static RGBW ReadColor(const uint8_t* data, uint8_t bytesPerLed) {
+            return RGBW(data[0], data[1], data[2], bytesPerLed >= 4 ? data[3] : 0);
+        }
+
+        void writeLeds(const Segment& segment, ledoffset_t index, const uint8_t* data, ledoffset_t count, uint8_t bytesPerLed) {
+            if (segment.pixels) {
+                RGBW* pixels = segment.pixels + index;
+
+                for (ledoffset_t i = 0; i < count; ++i) {
+                    pixels[i] = ReadColor(data + i * bytesPerLed, bytesPerLed);
+                }
+            } else {
+                ILedStripWithStorage& strip = *sources[segment.source].strip;
+
+                for (ledoffset_t i = 0; i < count; ++i) {
+                    strip.setLed(segment.stripIndex + index + i, ReadColor(data + i * bytesPerLed, bytesPerLed), false);
+                }
+            }
+
+            sources[segment.source].dirty = true;
+        }
+
+        void writeChannel(const Segment& segment, ledoffset_t index, uint8_t channel, uint8_t value) {
+            ILedStripWithStorage& strip = *sources[segment.source].strip;
+            RGBW color = segment.pixels ? segment.pixels[index] : strip.getLed(segment.stripIndex + index);
+
+            switch (channel) {
+                case 0: color.r = value; break;
+                case 1: color.g = value; break;
+                case 2: color.b = value; break;
+                default: color.w = value; break;
+            }
+
+            if (segment.pixels) {
+                segment.pixels[index] = color;
+            } else {
+                strip.setLed(segment.stripIndex + index, color, false);
+            }
+
+            sources[segment.source].dirty = true;
+        }
+
+    public:
+        /**
+         * \param bytesPerLed default layout of the channel data, 3 = RGB or 4 = RGBW
+         */
+        PixelPacketTarget(uint8_t bytesPerLed = 3) :
+            sources(),
+            segments(),
+            ledCount(0),
+            bytesPerLed(bytesPerLed == 4 ? 4 : 3) {}
+
+        /**
+         * Appends the leds of the given strip to the channel space.
+         * Must be called again (after clear()) when the structure of the strip changes.
+         */
+        void addStrip(ILedStripWithStorage& strip) {
+            uint8_t source = sources.size();
+            sources.push_back({&strip, false});
+
+            for (ledoffset_t i = 0; i < strip.getLedCount(); ++i) {
+                ledoffset_t baseIndex = i;
+                ILedStripWithStorage& leaf = strip.resolveLed(baseIndex);
+                RGBW* pixels = leaf.getPixelBuffer();
+
+                if (pixels) {
+                    pixels += baseIndex;
+                }
+
+                if (!segments.empty()) {
+                    Segment& last = segments.back();
+
+                    bool continuesDirect = pixels && last.pixels && last.pixels + last.count == pixels && last.leaf == &leaf;
+                    bool continuesIndirect = !pixels && !last.pixels;
+
+                    if (last.source == source && (continuesDirect || continuesIndirect)) {
+                        last.count++;
+                        continue;
+                    }
+                }
+
+                segments.push_back({ledCount + i, 1, i, pixels, &leaf, source});
+            }
+
+            ledCount += strip.getLedCount();
+        }
+
+        void clear() {
+            sources.clear();
+            segments.clear();
+            ledCount = 0;
+        }
+
+        uint32_t getLedCount() const {
+            return ledCount;
+        }
+
+        uint8_t getBytesPerLed() const {
+            return bytesPerLed;
+        }
+
+        /// \returns the size of the mapped channel space in bytes.
+        uint32_t getChannelCount() const {
+            return ledCount * bytesPerLed;
+        }
+
+        /// \returns the number of contiguous ranges the leds were resolved to.
+        size_t getSegmentCount() const {
+            return segments.size();
+        }
+
+        /**
+         * Writes channel data starting at the given byte offset of the channel space.
+         * Data beyond the mapped leds is ignored, partial leds at the borders are supported.
+         * \param bytesPerLed layout of the data, 0 for the default of this target
+         */
+        void write(uint32_t byteOffset, const uint8_t* data, size_t length, uint8_t bytesPerLed = 0) {
+            if (bytesPerLed == 0) {
+                bytesPerLed = this->bytesPerLed;
+            }
+
+            const uint32_t end = std::min<uint64_t>(uint64_t(byteOffset) + length, uint64_t(ledCount) * bytesPerLed);
+
+            auto segment = std::upper_bound(segments.begin(), segments.end(), byteOffset / bytesPerLed, [](uint32_t led, const Segment& segment) {
+                return led < segment.firstLed;
+            });
+
+            while (byteOffset < end) {
+                uint32_t led = byteOffset / bytesPerLed;
+                uint8_t channel = byteOffset % bytesPerLed;
+
+                while (led >= (segment - 1)->firstLed + (segment - 1)->count) {
+                    ++segment;
+                }
+
+                const Segment& current = *(segment - 1);
+                ledoffset_t index = led - current.firstLed;
+
+                if (channel == 0 && end - byteOffset >= bytesPerLed) {
+                    ledoffset_t count = std::min<uint32_t>(current.count - index, (end - byteOffset) / bytesPerLed);
+
+                    writeLeds(current, index, data, count, bytesPerLed);
+                    data += count * bytesPerLed;
+                    byteOffset += count * bytesPerLed;
+                } else {
+                    writeChannel(current, index, channel, *data);
+                    data++;
+                    byteOffset++;
+                }
+            }
+        }
+
+        /// \returns true when data was written since the last flush().
+        bool isDirty() const {
+            for (const Source& source : sources) {
+                if (source.dirty) {
+                    return true;
+                }
+            }
+
+            return false;
+        }
+
+        /**
+         * Updates all strips which were written since the last flush.
+         */
+        void flush() {
+            // Writes went through the kept pixel buffers, request them again so the strips notice them
+            for (const Segment& segment : segments) {
+                if (segment.pixels && sources[segment.source].dirty) {
+                    segment.leaf->getPixelBuffer();
+                }
+            }
+
+            for (Source& source : sources) {
+                if (source.dirty) {
+                    source.strip->updateLeds();
+                    source.dirty = false;
+                }
+            }
+        }
+};
+
+/**
+* Receiver for the Distributed Display Protocol (DDP).
+* The byte offset of the packets addresses the channel space of the target,
+* the frame is displayed when a packet with the push flag is received.
+*/
+class DDPReceiver {
+    private:
+        PixelPacketTarget& target;
+
+        static uint32_t ReadU32BE(const uint8_t* ptr) {
+            return uint32_t(ptr[0]) << 24 | uint32_t(ptr[1]) << 16 | uint32_t(ptr[2]) << 8 | ptr[3];
+        }
+
+    public:
+        static constexpr uint16_t DEFAULT_PORT = 4048;
+        static constexpr size_t HEADER_SIZE = 10;
+        static constexpr size_t TIMECODE_SIZE = 4;
+
+        static constexpr uint8_t FLAG_VERSION_MASK = 0xC0;
+        static constexpr uint8_t FLAG_VERSION_1 = 0x40;
+        static constexpr uint8_t FLAG_TIMECODE = 0x10;
+        static constexpr uint8_t FLAG_STORAGE = 0x08;
+        static constexpr uint8_t FLAG_REPLY = 0x04;
+        static constexpr uint8_t FLAG_QUERY = 0x02;
+        static constexpr uint8_t FLAG_PUSH = 0x01;
+
+        static constexpr uint8_t TYPE_UNDEFINED = 0x00;
+        static constexpr uint8_t TYPE_RGB8_LEGACY = 0x01;
+        static constexpr uint8_t TYPE_RGB8 = 0x0B;
+        static constexpr uint8_t TYPE_RGBW8 = 0x1B;
+
+        static constexpr uint8_t ID_DISPLAY = 1;
+        static constexpr uint8_t ID_ALL = 255;
+
+        DDPReceiver(PixelPacketTarget& target) :
+            target(target) {}
+
+        PixelPacketResult handlePacket(const uint8_t* data, size_t size) {
+            if (size < HEADER_SIZE || (data[0] & FLAG_VERSION_MASK) != FLAG_VERSION_1) {
+                return PixelPacketResult::Invalid;
+            }
+
+            const uint8_t flags = data[0];
+            const size_t headerSize = HEADER_SIZE + ((flags & FLAG_TIMECODE) ? TIMECODE_SIZE : 0);
+            const uint32_t offset = ReadU32BE(data + 4);
+            const uint16_t length = uint16_t(data[8]) << 8 | data[9];
+
+            if (size < headerSize + length) {
+                return PixelPacketResult::Invalid;
+            }
+
+            if ((flags & (FLAG_QUERY | FLAG_REPLY | FLAG_STORAGE)) || (data[3] != ID_DISPLAY && data[3] != ID_ALL)) {
+                return PixelPacketResult::Ignored;
+            }
+
+            uint8_t bytesPerLed;
+
+            switch (data[2]) {
+                case TYPE_UNDEFINED:
+                case TYPE_RGB8_LEGACY:
+                    bytesPerLed = 0;
+                    break;
+                case TYPE_RGB8:
+                    bytesPerLed = 3;
+                    break;
+                case TYPE_RGBW8:
+                    bytesPerLed = 4;
+                    break;
+                default:
+                    return PixelPacketResult::Ignored;
+            }
+
+            target.write(offset, data + headerSize, length, bytesPerLed);
+
+            if (flags & FLAG_PUSH) {
+                target.flush();
+                return PixelPacketResult::Displayed;
+            }
+
+            return PixelPacketResult::Written;
+        }
+};
+
+/**
+* Receiver for E1.31 (sACN).
+* Consecutive universes starting at firstUniverse are mapped onto the channel space of the target,
+* each universe covers channelsPerUniverse bytes (510 = 170 RGB leds by default).
+*
+* Packets without synchronization address are displayed immediately, otherwise the frame is
+* displayed when the matching synchronization packet is received.
+* Out of order packets and preview data are ignored.
+*/
+class E131Receiver {
+    private:
+        PixelPacketTarget& target;
+        uint16_t firstUniverse;
+        uint16_t channelsPerUniverse;
+
+        std::vector<int16_t> lastSequences;
+        uint16_t pendingSyncAddress;
+
+        static uint16_t ReadU16BE(const uint8_t* ptr) {
+            return uint16_t(ptr[0]) << 8 | ptr[1];
+        }
+
+        static uint32_t ReadU32BE(const uint8_t* ptr) {
+            return uint32_t(ReadU16BE(ptr)) << 16 | ReadU16BE(ptr + 2);
+        }
+
+        /// \returns false when the sequence number is older than the last one of the universe.
+        bool acceptSequence(size_t universeIndex, uint8_t sequence) {
+            int16_t& last = lastSequences[universeIndex];
+
+            if (last >= 0) {
+                int8_t diff = int8_t(sequence - uint8_t(last));
+
+                if (diff <= 0 && diff > -20) {
+                    return false;
+                }
+            }
+
+            last = sequence;
+            return true;
+        }
+
+        PixelPacketResult handleData(const uint8_t* data, size_t size) {
+            if (size < DATA_OFFSET || ReadU32BE(data + 40) != VECTOR_E131_DATA_PACKET || data[117] != VECTOR_DMP_SET_PROPERTY
+                    || data[118] != 0xA1 || ReadU16BE(data + 119) != 0 || ReadU16BE(data + 121) != 1) {
+                return PixelPacketResult::Invalid;
+            }
+
+            const uint16_t propertyCount = ReadU16BE(data + 123);
+
+            if (propertyCount == 0 || size < DATA_OFFSET - 1 + propertyCount) {
+                return PixelPacketResult::Invalid;
+            }
+
+            const uint16_t syncAddress = ReadU16BE(data + 109);
+            const uint8_t sequence = data[111];
+            const uint8_t options = data[112];
+            const uint16_t universe = ReadU16BE(data + 113);
+
+            if (data[125] != 0 || (options & (OPTION_PREVIEW | OPTION_TERMINATED))
+                    || universe < firstUniverse || size_t(universe - firstUniverse) >= lastSequences.size()) {
+                return PixelPacketResult::Ignored;
+            }
+
+            const size_t universeIndex = universe - firstUniverse;
+
+            if (!acceptSequence(universeIndex, sequence)) {
+                return PixelPacketResult::Ignored;
+            }
+
+            uint16_t channels = std::min<uint16_t>(propertyCount - 1, channelsPerUniverse);
+            target.write(universeIndex * channelsPerUniverse, data + DATA_OFFSET, channels);
+
+            if (syncAddress == 0) {
+                target.flush();
+                return PixelPacketResult::Displayed;
+            }
+
+            pendingSyncAddress = syncAddress;
+            return PixelPacketResult::Written;
+        }
+
+        PixelPacketResult handleSync(const uint8_t* data, size_t size) {
+            if (size < SYNC_PACKET_SIZE || ReadU32BE(data + 40) != VECTOR_E131_EXTENDED_SYNCHRONIZATION) {
+                return PixelPacketResult::Ignored;
+            }
+
+            if (pendingSyncAddress == 0 || ReadU16BE(data + 45) != pendingSyncAddress) {
+                return PixelPacketResult::Ignored;
+            }
+
+            pendingSyncAddress = 0;
+            target.flush();
+            return PixelPacketResult::Displayed;
+        }
+
+    public:
+        static constexpr uint16_t DEFAULT_PORT = 5568;
+        static constexpr uint16_t MAX_CHANNELS = 512;
+
+        static constexpr uint32_t VECTOR_ROOT_E131_DATA = 0x00000004;
+        static constexpr uint32_t VECTOR_ROOT_E131_EXTENDED = 0x00000008;
+        static constexpr uint32_t VECTOR_E131_DATA_PACKET = 0x00000002;
+        static constexpr uint32_t VECTOR_E131_EXTENDED_SYNCHRONIZATION = 0x00000001;
+        static constexpr uint8_t VECTOR_DMP_SET_PROPERTY = 0x02;
+
+        static constexpr uint8_t OPTION_PREVIEW = 0x80;
+        static constexpr uint8_t OPTION_TERMINATED = 0x40;
+
+        /// Offset of the first DMX channel (after the start code).
+        static constexpr size_t DATA_OFFSET = 126;
+        static constexpr size_t SYNC_PACKET_SIZE = 49;
+
+        /**
+         * \param channelsPerUniverse used channels of each universe, should be a multiple of the bytes per led
+         */
+        E131Receiver(PixelPacketTarget& target, uint16_t firstUniverse = 1, uint16_t channelsPerUniverse = 510) :
+            target(target),
+            firstUniverse(firstUniverse),
+            channelsPerUniverse(std::max<uint16_t>(1, std::min(channelsPerUniverse, MAX_CHANNELS))),
+            lastSequences(),
+            pendingSyncAddress(0) {
+
+            reset();
+        }
+
+        /**
+         * Forgets the sequence numbers and pending synchronization.
+         * Call this when leds were added to the target.
+         */
+        void reset() {
+            lastSequences.assign((target.getChannelCount() + channelsPerUniverse - 1) / channelsPerUniverse, -1);
+            pendingSyncAddress = 0;
+        }
+
+        /// \returns the number of universes covered by the target.
+        size_t getUniverseCount() const {
+            return lastSequences.size();
+        }
+
+        PixelPacketResult handlePacket(const uint8_t* data, size_t size) {
+            static const uint8_t Identifier[12] = {'A', 'S', 'C', '-', 'E', '1', '.', '1', '7', 0, 0, 0};
+
+            if (size < 38 || ReadU16BE(data) != 0x0010 || ReadU16BE(data + 2) != 0 || memcmp(data + 4, Identifier, sizeof(Identifier)) != 0) {
+                return PixelPacketResult::Invalid;
+            }
+
+            switch (ReadU32BE(data + 18)) {
+                case VECTOR_ROOT_E131_DATA:
+                    return handleData(data, size);
+                case VECTOR_ROOT_E131_EXTENDED:
+                    return handleSync(data, size);
+                default:
+                    return PixelPacketResult::Ignored;
+            }
+        }
+};
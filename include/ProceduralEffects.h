@@ -0,0 +1,331 @@
+#pragma once
+
+#include "AnimationManager.h"
+#include "Instrumentation.h"
+
+#include <algorithm>
+
+/**
+* Procedural effects: Kernels evaluated per frame over a range of leds from (time, led index).
+* Each effect is a single AnimationManager entry with constant memory, independent of the led count.
+*/
+
+/// \returns a pseudo random value for the given lattice point.
+inline uint8_t Hash8(uint16_t x, uint16_t y) {
+    uint32_t h = uint32_t(x) * 0x9E3779B1u ^ uint32_t(y) * 0x85EBCA77u;
+    h ^= h >> 15;
+    h *= 0xC2B2AE3Du;
+    h ^= h >> 13;
+    return h >> 24;
+}
+
+/// Linear interpolation between a and b, factor in [0, 256].
+inline uint8_t Lerp8(uint8_t a, uint8_t b, uint16_t factor) {
+    return a + ((int16_t(b) - int16_t(a)) * int16_t(factor)) / 256;
+}
+
+/**
+* Smooth 2D value noise in fixed point.
+* \param x coordinate as 8.8 fixed point value (one lattice cell = 256)
+* \param y coordinate as 8.8 fixed point value
+* \returns noise value in [0, 255]
+*/
+inline uint8_t Noise8(uint32_t x, uint32_t y) {
+    uint16_t cellX = x >> 8;
+    uint16_t cellY = y >> 8;
+
+    // Smoothstep of the fractional parts: t * t * (3 - 2t)
+    uint32_t fx = x & 0xFF;
+    uint32_t fy = y & 0xFF;
+    uint16_t sx = (fx * fx * (768 - 2 * fx)) >> 16;
+    uint16_t sy = (fy * fy * (768 - 2 * fy)) >> 16;
+
+    uint8_t top = Lerp8(Hash8(cellX, cellY), Hash8(cellX + 1, cellY), sx);
+    uint8_t bottom = Lerp8(Hash8(cellX, cellY + 1), Hash8(cellX + 1, cellY + 1), sx);
+
+    return Lerp8(top, bottom, sy);
+}
+
+/// \returns the color between a (amount 0) and b (amount 255).
+inline RGBW BlendColor(RGBW a, RGBW b, uint8_t amount) {
+    uint16_t factor = amount + (amount >> 7);   // Maps 255 to 256
+
+    return RGBW(Lerp8(a.r, b.r, factor), Lerp8(a.g, b.g, factor), Lerp8(a.b, b.b, factor), Lerp8(a.w, b.w, factor));
+}
+
+/// \returns the color of a black body like fire palette (black, red, yellow, white) for the heat.
+inline RGBW HeatColor(uint8_t heat) {
+    // Scale to [0, 191] and split into three ranges of 64 steps
+    uint8_t t = Scale8(heat, 191);
+    uint8_t ramp = (t & 0x3F) << 2;
+
+    if (t & 0x80) {
+        return RGBW(255, 255, ramp);
+    } else if (t & 0x40) {
+        return RGBW(255, ramp, 0);
+    } else {
+        return RGBW(ramp, 0, 0);
+    }
+}
+
+/**
+* Base class of all procedural effects.
+* Evaluates the effect for the configured led range once per update, directly into the pixel
+* buffer of the led strip when available, otherwise in chunks via setLeds().
+*
+* Effects run until the end of the duration, by default until they are removed.
+*/
+class AProceduralEffect : public ALedAnimation {
+    private:
+        ledoffset_t firstLed;
+        ledoffset_t ledCount;
+
+        static constexpr ledoffset_t CHUNK_SIZE = 32;
+
+    protected:
+        /**
+         * Renders the effect.
+         * \param output colors of the leds [offset, offset + count) of the effect range
+         * \param time time since the start of the effect in milliseconds
+         */
+        virtual void render(RGBW* output, ledoffset_t offset, ledoffset_t count, uint32_t time) = 0;
+
+        ledoffset_t getEffectLedCount() const {
+            return ledCount;
+        }
+
+    public:
+        /**
+         * \param ledCount number of leds of the effect range, 0 for all leds starting at firstLed.
+         * The range is clamped to the leds of the strip.
+         * \param duration 0 to run until the effect is removed (AAnimation::DURATION_INFINITE)
+         */
+        AProceduralEffect(uint32_t startTime, uint32_t duration, ILedStripWithStorage& ledControl, ledoffset_t firstLed = 0, ledoffset_t ledCount = 0) :
+            ALedAnimation(startTime, duration > 0 ? duration : DURATION_INFINITE, ledControl),
+            firstLed(std::min(firstLed, ledControl.getLedCount())),
+            ledCount(std::min<ledoffset_t>(ledCount > 0 ? ledCount : ledControl.getLedCount(), ledControl.getLedCount() - this->firstLed)) {}
+
+        virtual void update(uint32_t currentTime) override {
+            const uint32_t time = currentTime - startTime;
+            RGBW* pixels = ledControl.getPixelBuffer();
+
+            if (pixels) {
+                render(pixels + firstLed, 0, ledCount, time);
+                return;
+            }
+
+            RGBW chunk[CHUNK_SIZE];
+
+            for (ledoffset_t offset = 0; offset < ledCount; offset += std::min<ledoffset_t>(CHUNK_SIZE, ledCount - offset)) {
+                ledoffset_t chunkCount = std::min<ledoffset_t>(CHUNK_SIZE, ledCount - offset);
+
+                render(chunk, offset, chunkCount, time);
+                ledControl.setLeds(firstLed + offset, chunk, chunkCount, false);
+            }
+        }
+};
+
+/**
+* Smoothly moving noise pattern, blends between two colors.
+*/
+class NoiseEffect : public AProceduralEffect {
+    private:
+        RGBW color0;
+        RGBW color1;
+        uint16_t scale;
+        uint16_t speed;
+
+    protected:
+        virtual void render(RGBW* output, ledoffset_t offset, ledoffset_t count, uint32_t time) override {
+            const uint32_t y = (time * speed) >> 8;
+
+            for (ledoffset_t i = 0; i < count; ++i) {
+                output[i] = BlendColor(color0, color1, Noise8(uint32_t(offset + i) * scale, y));
+            }
+        }
+
+    public:
+        /**
+         * \param scale noise coordinate step per led (8.8, 256 = one noise cell per led)
+         * \param speed noise coordinate step per millisecond (8.8 of a cell)
+         */
+        NoiseEffect(uint32_t startTime, uint32_t duration, ILedStripWithStorage& ledControl, RGBW color0, RGBW color1, uint16_t scale = 64, uint16_t speed = 64, ledoffset_t firstLed = 0, ledoffset_t ledCount = 0) :
+            AProceduralEffect(startTime, duration, ledControl, firstLed, ledCount),
+            color0(color0),
+            color1(color1),
+            scale(scale),
+            speed(speed) {}
+};
+
+/**
+* Stateless fire: noise rising from the first led, cooling with the height.
+*/
+class FireEffect : public AProceduralEffect {
+    private:
+        uint16_t speed;
+        uint8_t cooling;
+
+    protected:
+        virtual void render(RGBW* output, ledoffset_t offset, ledoffset_t count, uint32_t time) override {
+            const uint32_t rise = time * speed;
+            const uint16_t length = std::max<uint16_t>(1, getEffectLedCount());
+
+            for (ledoffset_t i = 0; i < count; ++i) {
+                const uint16_t led = offset + i;
+
+                // Flames move upwards: sample the noise below the led
+                uint8_t heat = Noise8(uint32_t(led) * 96 + 0x10000 - (rise & 0xFFFF), rise >> 10);
+                uint16_t cool = uint32_t(led) * cooling * 2 / length;
+
+                heat = heat > cool ? heat - cool : 0;
+                output[i] = HeatColor(heat);
+            }
+        }
+
+    public:
+        /**
+         * \param speed movement speed of the flames
+         * \param cooling heat loss from the first to the last led
+         */
+        FireEffect(uint32_t startTime, uint32_t duration, ILedStripWithStorage& ledControl, uint16_t speed = 4, uint8_t cooling = 160, ledoffset_t firstLed = 0, ledoffset_t ledCount = 0) :
+            AProceduralEffect(startTime, duration, ledControl, firstLed, ledCount),
+            speed(speed),
+            cooling(cooling) {}
+};
+
+/**
+* Groups of lit leds running along the strip, anti-aliased for continuous motion.
+*/
+class ChaseEffect : public AProceduralEffect {
+    private:
+        RGBW color;
+        RGBW background;
+        uint8_t spacing;
+        uint8_t width;
+        uint16_t speed;
+
+    protected:
+        virtual void render(RGBW* output, ledoffset_t offset, ledoffset_t count, uint32_t time) override {
+            // Position in 1/256 leds
+            const uint32_t period = uint32_t(spacing) << 8;
+            const uint32_t shift = uint32_t((uint64_t(time) * speed * 256 / 1000) % period);
+
+            for (ledoffset_t i = 0; i < count; ++i) {
+                uint32_t position = ((uint32_t(offset + i) << 8) + period - shift) % period;
+                uint32_t end = uint32_t(width) << 8;
+
+                // Coverage of the led [position, position + 256) by the lit range [0, end) (and its wrap at period)
+                uint32_t covered = position < end ? std::min<uint32_t>(256, end - position) : 0;
+
+                if (position + 256 > period) {
+                    covered += std::min<uint32_t>(position + 256 - period, end);
+                }
+
+                output[i] = BlendColor(background, color, std::min<uint32_t>(covered, 255));
+            }
+        }
+
+    public:
+        /**
+         * \param spacing distance between the start of two groups in leds
+         * \param width lit leds per group
+         * \param speed leds per second
+         */
+        ChaseEffect(uint32_t startTime, uint32_t duration, ILedStripWithStorage& ledControl, RGBW color, RGBW background, uint8_t spacing = 4, uint8_t width = 1, uint16_t speed = 10, ledoffset_t firstLed = 0, ledoffset_t ledCount = 0) :
+            AProceduralEffect(startTime, duration, ledControl, firstLed, ledCount),
+            color(color),
+            background(background),
+            spacing(std::max<uint8_t>(1, spacing)),
+            width(std::min(width, this->spacing)),
+            speed(speed) {}
+};
+
+/**
+* Randomly twinkling leds. Each led has its own phase, in each period a led twinkles with the given probability.
+*/
+class TwinkleEffect : public AProceduralEffect {
+    private:
+        RGBW color;
+        RGBW background;
+        uint8_t density;
+        uint16_t period;
+        uint16_t seed;
+
+    protected:
+        virtual void render(RGBW* output, ledoffset_t offset, ledoffset_t count, uint32_t time) override {
+            for (ledoffset_t i = 0; i < count; ++i) {
+                const uint16_t led = offset + i;
+
+                // Per led phase shift, so not all leds change at the same time
+                uint32_t ledTime = time + uint32_t(Hash8(led, seed)) * period / 256;
+                uint16_t cycle = ledTime / period;
+
+                if (Hash8(led ^ seed, cycle) >= density) {
+                    output[i] = background;
+                    continue;
+                }
+
+                // Triangle: fade in during the first half, fade out during the second half
+                uint32_t phase = (ledTime % period) * 512 / period;
+                uint8_t brightness = phase < 256 ? phase : 511 - phase;
+
+                output[i] = BlendColor(background, color, brightness);
+            }
+        }
+
+    public:
+        /**
+         * \param density probability of a led to twinkle in each period (255 = always)
+         * \param period duration of one twinkle in milliseconds
+         */
+        TwinkleEffect(uint32_t startTime, uint32_t duration, ILedStripWithStorage& ledControl, RGBW color, RGBW background, uint8_t density = 64, uint16_t period = 1000, uint16_t seed = 0, ledoffset_t firstLed = 0, ledoffset_t ledCount = 0) :
+            AProceduralEffect(startTime, duration, ledControl, firstLed, ledCount),
+            color(color),
+            background(background),
+            density(density),
+            period(std::max<uint16_t>(1, period)),
+            seed(seed) {}
+};
+
+/**
+* A single bright head with a fading tail, moving along the strip and wrapping around.
+*/
+class CometEffect : public AProceduralEffect {
+    private:
+        RGBW color;
+        RGBW background;
+        uint8_t tailLength;
+        uint16_t speed;
+
+    protected:
+        virtual void render(RGBW* output, ledoffset_t offset, ledoffset_t count, uint32_t time) override {
+            // The head travels over the range plus the tail, so the comet fully leaves the strip
+            const uint32_t track = (uint32_t(getEffectLedCount()) + tailLength) << 8;
+            const uint32_t head = uint32_t((uint64_t(time) * speed * 256 / 1000) % track);
+            const uint32_t tail = uint32_t(tailLength) << 8;
+
+            for (ledoffset_t i = 0; i < count; ++i) {
+                uint32_t position = uint32_t(offset + i) << 8;
+
+                if (position > head || head - position >= tail) {
+                    output[i] = background;
+                    continue;
+                }
+
+                uint8_t brightness = 255 - ((head - position) * 255 / tail);
+                output[i] = BlendColor(background, color, brightness);
+            }
+        }
+
+    public:
+        /**
+         * \param tailLength length of the tail in leds
+         * \param speed leds per second
+         */
+        CometEffect(uint32_t startTime, uint32_t duration, ILedStripWithStorage& ledControl, RGBW color, RGBW background = COLOR_OFF, uint8_t tailLength = 8, uint16_t speed = 30, ledoffset_t firstLed = 0, ledoffset_t ledCount = 0) :
+            AProceduralEffect(startTime, duration, ledControl, firstLed, ledCount),
+            color(color),
+            background(background),
+            tailLength(std::max<uint8_t>(1, tailLength)),
+            speed(speed) {}
+};
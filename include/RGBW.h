@@ -1,9 +1,10 @@
 #pragma once
 
-// Include CiString for case insensitive string comparison
-#include <CiString.h>
-
-#include <map>
+#include <array>
+#include <algorithm>
+#include <string>
+#include <string_view>
+#include <stdlib.h>
 
 static uint8_t AddWOOverflow(uint8_t a, uint8_t b) {
     if (uint16_t(a) + uint16_t(b) > 0xFF)
@@ -12,26 +13,63 @@ static uint8_t AddWOOverflow(uint8_t a, uint8_t b) {
     return a + b;
 }
 
+/// Scales the value by scale / 256, a scale of 255 keeps the value.
+inline uint8_t Scale8(uint8_t value, uint8_t scale) {
+    return (uint16_t(value) * (uint16_t(scale) + 1)) >> 8;
+}
+
+/**
+* Color in the HSV color space, all components as 8 bit values.
+* The hue covers the full circle with 256 steps (0 = red, 85 = green, 170 = blue).
+*/
+struct HSV {
+    uint8_t h;
+    uint8_t s;
+    uint8_t v;
+
+    HSV() :
+        h(0), s(0), v(0) {}
+
+    HSV(uint8_t h, uint8_t s, uint8_t v) :
+        h(h), s(s), v(v) {}
+};
+
+/**
+* Color in the HSL color space, all components as 8 bit values.
+* The hue uses the same scale as HSV.
+*/
+struct HSL {
+    uint8_t h;
+    uint8_t s;
+    uint8_t l;
+
+    HSL() :
+        h(0), s(0), l(0) {}
+
+    HSL(uint8_t h, uint8_t s, uint8_t l) :
+        h(h), s(s), l(l) {}
+};
+
 struct RGBW {
     uint8_t r;
     uint8_t g;
     uint8_t b;
     uint8_t w;
 
-    RGBW() :
+    constexpr RGBW() :
         r(0), g(0), b(0), w(0) {}
 
-    RGBW(uint8_t r, uint8_t g, uint8_t b, uint8_t w = 0) :
+    constexpr RGBW(uint8_t r, uint8_t g, uint8_t b, uint8_t w = 0) :
         r(r), g(g), b(b), w(w) {}
 
-    RGBW(uint32_t packedColor) :
+    constexpr RGBW(uint32_t packedColor) :
         r((packedColor & 0xFF0000) >> 16),
         g((packedColor & 0xFF00) >> 8),
         b((packedColor & 0xFF)),
         w((packedColor & 0xFF000000) >> 24) {}
 
     /// Returns the RGBW value as packed uint32_t (byte order: WRGB)
-    uint32_t getAsPackedColor() const {
+    constexpr uint32_t getAsPackedColor() const {
         return uint32_t(w) << 24 | uint32_t(r) << 16 | uint32_t(g) << 8 | uint32_t(b);
     }
 
@@ -95,11 +133,11 @@ struct RGBW {
                );
     }
 
-    bool operator==(const RGBW& other) const {
+    constexpr bool operator==(const RGBW& other) const {
         return r == other.r && g == other.g && b == other.b && w == other.w;
     }
 
-    bool operator!=(const RGBW& other) const {
+    constexpr bool operator!=(const RGBW& other) const {
         return r != other.r || g != other.g || b != other.b || w != other.w;
     }
 
@@ -107,6 +145,131 @@ struct RGBW {
         return *this * (1.f - factor) + other * factor;
     }
 
+    /**
+    * Returns the fully saturated color of each of the 256 hues, with maximum value.
+    */
+    static const std::array<RGBW, 256>& GetHueTable() {
+        static const std::array<RGBW, 256> HueTable = []() {
+            std::array<RGBW, 256> table;
+
+            for (uint16_t h = 0; h < 256; ++h) {
+                uint16_t h6 = h * 6;
+                uint8_t up = h6 & 0xFF;
+                uint8_t down = 0xFF - up;
+
+                switch (h6 >> 8) {
+                    case 0: table[h] = RGBW(0xFF, up, 0); break;
+                    case 1: table[h] = RGBW(down, 0xFF, 0); break;
+                    case 2: table[h] = RGBW(0, 0xFF, up); break;
+                    case 3: table[h] = RGBW(0, down, 0xFF); break;
+                    case 4: table[h] = RGBW(up, 0, 0xFF); break;
+                    default: table[h] = RGBW(0xFF, 0, down); break;
+                }
+            }
+
+            return table;
+        }();
+
+        return HueTable;
+    }
+
+    /**
+    * Converts the HSV color, uses only integer math and the hue table.
+    * \param extractWhite moves the common part of r, g and b into the W channel (for RGBW leds)
+    */
+    static RGBW FromHSV(const HSV& hsv, bool extractWhite = false) {
+        const RGBW& hue = GetHueTable()[hsv.h];
+
+        RGBW color(
+            Scale8(hsv.v, 0xFF - Scale8(hsv.s, 0xFF - hue.r)),
+            Scale8(hsv.v, 0xFF - Scale8(hsv.s, 0xFF - hue.g)),
+            Scale8(hsv.v, 0xFF - Scale8(hsv.s, 0xFF - hue.b))
+        );
+
+        return extractWhite ? color.getWithWhiteExtracted() : color;
+    }
+
+    /**
+    * Converts the HSL color, see FromHSV().
+    */
+    static RGBW FromHSL(const HSL& hsl, bool extractWhite = false) {
+        // HSL -> HSV: v = l + s * min(l, 1 - l), s_v = 2 * (1 - l / v)
+        uint8_t v = hsl.l + (uint16_t(hsl.s) * std::min<uint8_t>(hsl.l, 0xFF - hsl.l) + 127) / 0xFF;
+        uint8_t s = v > 0 ? std::min<uint16_t>(0xFF, (uint32_t(v - hsl.l) * 2 * 0xFF + v / 2) / v) : 0;
+
+        return FromHSV(HSV(hsl.h, s, v), extractWhite);
+    }
+
+    /**
+    * Returns the hue in the same scale as HSV, based on the r, g and b channels.
+    */
+    static uint8_t GetHue(uint8_t r, uint8_t g, uint8_t b, uint8_t max, uint8_t delta) {
+        if (delta == 0) {
+            return 0;
+        }
+
+        // Hue in sixths of the circle: sector * delta + difference
+        int32_t sixths;
+
+        if (max == r) {
+            sixths = int32_t(g) - int32_t(b);
+        } else if (max == g) {
+            sixths = 2 * int32_t(delta) + int32_t(b) - int32_t(r);
+        } else {
+            sixths = 4 * int32_t(delta) + int32_t(r) - int32_t(g);
+        }
+
+        if (sixths < 0) {
+            sixths += 6 * int32_t(delta);
+        }
+
+        return uint8_t((sixths * 256 + 3 * int32_t(delta)) / (6 * int32_t(delta)));
+    }
+
+    /**
+    * Converts to HSV, uses only integer math.
+    * The W channel is added to r, g and b before the conversion.
+    */
+    HSV toHSV() const {
+        uint8_t rw = AddWOOverflow(r, w);
+        uint8_t gw = AddWOOverflow(g, w);
+        uint8_t bw = AddWOOverflow(b, w);
+
+        uint8_t max = std::max(rw, std::max(gw, bw));
+        uint8_t min = std::min(rw, std::min(gw, bw));
+        uint8_t delta = max - min;
+
+        uint8_t s = max > 0 ? (uint16_t(delta) * 0xFF + max / 2) / max : 0;
+        return HSV(GetHue(rw, gw, bw, max, delta), s, max);
+    }
+
+    /**
+    * Converts to HSL, see toHSV().
+    */
+    HSL toHSL() const {
+        uint8_t rw = AddWOOverflow(r, w);
+        uint8_t gw = AddWOOverflow(g, w);
+        uint8_t bw = AddWOOverflow(b, w);
+
+        uint8_t max = std::max(rw, std::max(gw, bw));
+        uint8_t min = std::min(rw, std::min(gw, bw));
+        uint8_t delta = max - min;
+
+        uint16_t sum = uint16_t(max) + min;
+        uint16_t divisor = 0xFF - abs(int16_t(sum) - 0xFF);
+        uint8_t s = divisor > 0 ? std::min<uint16_t>(0xFF, (uint16_t(delta) * 0xFF + divisor / 2) / divisor) : 0;
+
+        return HSL(GetHue(rw, gw, bw, max, delta), s, (sum + 1) / 2);
+    }
+
+    /**
+    * Returns the color with the common part of r, g and b moved into the W channel.
+    */
+    RGBW getWithWhiteExtracted() const {
+        uint8_t white = std::min(r, std::min(g, b));
+        return RGBW(r - white, g - white, b - white, AddWOOverflow(w, white));
+    }
+
     static RGBW Max(const RGBW& a, const RGBW& b) {
         return RGBW(
                    std::max(a.r, b.r),
@@ -126,19 +289,25 @@ struct RGBW {
     }
 };
 
-static const RGBW COLOR_OFF = RGBW();
-static const RGBW COLOR_RED = RGBW(255, 0, 0, 0);
-static const RGBW COLOR_GREEN = RGBW(0, 255, 0, 0);
-static const RGBW COLOR_BLUE = RGBW(0, 0, 255, 0);
-static const RGBW COLOR_YELLOW = RGBW(0xFF, 0xFF, 0, 0);
-static const RGBW COLOR_WWHITE = RGBW(0, 0, 0, 255);
-static const RGBW COLOR_TURQUOISE = RGBW(0, 0xFF, 0xFF, 0);
-static const RGBW COLOR_MAGENTA = RGBW(0xFF, 0, 0xFF, 0);
-static const RGBW COLOR_KWHITE = RGBW(255, 255, 255, 0);
-static const RGBW COLOR_NWHITE = RGBW(255, 255, 255, 255);
-static const RGBW COLOR_ALL = COLOR_NWHITE;
-
-static const std::map<CiString, RGBW> NamedColors = {
+static constexpr RGBW COLOR_OFF = RGBW();
+static constexpr RGBW COLOR_RED = RGBW(255, 0, 0, 0);
+static constexpr RGBW COLOR_GREEN = RGBW(0, 255, 0, 0);
+static constexpr RGBW COLOR_BLUE = RGBW(0, 0, 255, 0);
+static constexpr RGBW COLOR_YELLOW = RGBW(0xFF, 0xFF, 0, 0);
+static constexpr RGBW COLOR_WWHITE = RGBW(0, 0, 0, 255);
+static constexpr RGBW COLOR_TURQUOISE = RGBW(0, 0xFF, 0xFF, 0);
+static constexpr RGBW COLOR_MAGENTA = RGBW(0xFF, 0, 0xFF, 0);
+static constexpr RGBW COLOR_KWHITE = RGBW(255, 255, 255, 0);
+static constexpr RGBW COLOR_NWHITE = RGBW(255, 255, 255, 255);
+static constexpr RGBW COLOR_ALL = COLOR_NWHITE;
+
+/// Entry of the named color table, see FindNamedColor().
+struct NamedColor {
+    const char* name;
+    RGBW color;
+};
+
+static constexpr NamedColor NamedColorTable[] = {
     {"Off", COLOR_OFF},
     {"Full", COLOR_ALL},
     {"Red", COLOR_RED},
@@ -152,6 +321,115 @@ static const std::map<CiString, RGBW> NamedColors = {
     {"Magenta", COLOR_MAGENTA},
 };
 
+/// Case insensitive hash functions for the named colors.
+struct NamedColorHash {
+    static constexpr size_t TABLE_SIZE = 32;
+    static constexpr size_t COLOR_COUNT = sizeof(NamedColorTable) / sizeof(NamedColorTable[0]);
+    static constexpr uint8_t EMPTY_SLOT = 0xFF;
+
+    static_assert(COLOR_COUNT < TABLE_SIZE, "NamedColorHash::TABLE_SIZE too small");
+
+    static constexpr char ToLower(char c) {
+        return c >= 'A' && c <= 'Z' ? char(c + ('a' - 'A')) : c;
+    }
+
+    static constexpr size_t Length(const char* str) {
+        size_t length = 0;
+
+        while (str[length] != '\0') {
+            ++length;
+        }
+
+        return length;
+    }
+
+    /// FNV-1a over the lower case characters, mixed with the seed.
+    static constexpr size_t GetSlot(std::string_view name, uint32_t seed) {
+        uint32_t hash = 2166136261u ^ seed;
+
+        for (char c : name) {
+            hash = (hash ^ uint8_t(ToLower(c))) * 16777619u;
+        }
+
+        return (hash ^ (hash >> 16)) & (TABLE_SIZE - 1);
+    }
+
+    static constexpr bool IsPerfect(uint32_t seed) {
+        std::array<bool, TABLE_SIZE> used{};
+
+        for (const NamedColor& entry : NamedColorTable) {
+            size_t slot = GetSlot(std::string_view(entry.name, Length(entry.name)), seed);
+
+            if (used[slot]) {
+                return false;
+            }
+
+            used[slot] = true;
+        }
+
+        return true;
+    }
+
+    static constexpr uint32_t FindSeed() {
+        uint32_t seed = 0;
+
+        while (!IsPerfect(seed)) {
+            ++seed;
+        }
+
+        return seed;
+    }
+
+    static constexpr std::array<uint8_t, TABLE_SIZE> BuildSlots(uint32_t seed) {
+        std::array<uint8_t, TABLE_SIZE> slots{};
+
+        for (uint8_t& slot : slots) {
+            slot = EMPTY_SLOT;
+        }
+
+        for (size_t i = 0; i < COLOR_COUNT; ++i) {
+            const char* name = NamedColorTable[i].name;
+            slots[GetSlot(std::string_view(name, Length(name)), seed)] = uint8_t(i);
+        }
+
+        return slots;
+    }
+
+    static constexpr bool EqualsIgnoreCase(std::string_view a, const char* b) {
+        for (char c : a) {
+            if (*b == '\0' || ToLower(c) != ToLower(*b)) {
+                return false;
+            }
+
+            ++b;
+        }
+
+        return *b == '\0';
+    }
+};
+
+/// Perfect hash table of NamedColorTable, slot -> table index.
+struct NamedColorLookup {
+    static constexpr uint32_t SEED = NamedColorHash::FindSeed();
+    static constexpr std::array<uint8_t, NamedColorHash::TABLE_SIZE> SLOTS = NamedColorHash::BuildSlots(SEED);
+};
+
+/**
+* Finds the named color by name, the comparison is case insensitive.
+* \param output Output variable for the found color, only defined when the return value is true.
+* \returns true when the color by name was found, false otherwise.
+*/
+constexpr bool FindNamedColor(std::string_view name, RGBW& output) {
+    uint8_t index = NamedColorLookup::SLOTS[NamedColorHash::GetSlot(name, NamedColorLookup::SEED)];
+
+    if (index == NamedColorHash::EMPTY_SLOT || !NamedColorHash::EqualsIgnoreCase(name, NamedColorTable[index].name)) {
+        return false;
+    }
+
+    output = NamedColorTable[index].color;
+    return true;
+}
+
 /**
 * Finds the named color by name.
 * \param name The input name, comparison will be case insensitive.
@@ -160,16 +438,16 @@ static const std::map<CiString, RGBW> NamedColors = {
 * \returns true when the color by name was found, false otherwise.
 */
 inline bool GetNamedColor(const std::string& name, float factor, RGBW& output) {
-    auto colorIter = NamedColors.find(name);
+    RGBW color;
 
-    if (colorIter == NamedColors.end()) {
+    if (!FindNamedColor(name, color)) {
         return false;
     }
 
     factor = std::min(1.f, factor);
     factor = std::max(0.f, factor);
 
-    output = colorIter->second * factor;
+    output = color * factor;
     return true;
 }
 
@@ -0,0 +1,332 @@
+#pragma once
+
+#include "SceneVM.h"
+#include "ColorParser.h"
+
+#include <string>
+#include <vector>
+#include <sstream>
+#include <cmath>
+#include <stdlib.h>
+#include <ctype.h>
+
+/**
+* Compiles the text form of a scene into bytecode for SceneVM.
+*
+* One instruction per line, '#' starts a comment. A range is "<first> <count>" and can be omitted for all leds.
+* Colors are parsed by ParseColor(), named colors (e.g. "red*0.5") or hex values "#RRGGBB" / "#RRGGBBWW".
+* Durations are milliseconds, optionally with the suffix "ms" or "s" (e.g. "1.5s").
+*
+*   fill [range] <color>
+*   fade [range] <from> <to> <duration> [linear|in|out|inout]
+*   wait <duration>
+*   loop [count]            Repeats the lines up to "end", without count forever
+*   end
+*   rainbow [range] [speed] Hue gradient over the range, rotating with speed hues per second
+*   dim [range] <amount>    Scales the colors by amount / 255
+*
+* Instructions before a wait run at the same time, so parallel fades are written one after another.
+*/
+class SceneCompiler {
+    private:
+        struct Loop {
+            size_t headerPosition;
+            uint8_t count;
+            uint32_t outerDuration;
+        };
+
+        std::vector<uint8_t>* output;
+        std::vector<Loop> loops;
+        uint32_t duration;      // Duration of the current block
+
+        size_t errorLine;
+        std::string error;
+
+        bool fail(const std::string& message) {
+            error = message;
+            return false;
+        }
+
+        void writeU16(uint16_t value) {
+            output->push_back(value & 0xFF);
+            output->push_back(value >> 8);
+        }
+
+        void writeU32(uint32_t value) {
+            writeU16(value & 0xFFFF);
+            writeU16(value >> 16);
+        }
+
+        void writeColor(RGBW color) {
+            output->push_back(color.r);
+            output->push_back(color.g);
+            output->push_back(color.b);
+            output->push_back(color.w);
+        }
+
+        static bool ParseNumber(const std::string& token, uint32_t maximum, uint32_t& out_value) {
+            if (token.empty() || token[0] < '0' || token[0] > '9') {
+                return false;
+            }
+
+            char* end;
+            unsigned long value = strtoul(token.c_str(), &end, 10);
+
+            if (*end != '\0' || value > maximum) {
+                return false;
+            }
+
+            out_value = uint32_t(value);
+            return true;
+        }
+
+        static bool ParseDuration(const std::string& token, uint32_t& out_duration) {
+            char* end;
+            double value = strtod(token.c_str(), &end);
+            std::string suffix(end);
+
+            // strtod also accepts "nan" and "inf"
+            if (end == token.c_str() || !std::isfinite(value) || value < 0.0) {
+                return false;
+            }
+
+            if (suffix == "s") {
+                value *= 1000.0;
+            } else if (!suffix.empty() && suffix != "ms") {
+                return false;
+            }
+
+            if (value >= double(SceneBytecode::DURATION_INFINITE)) {
+                return false;
+            }
+
+            out_duration = uint32_t(value + 0.5);
+            return true;
+        }
+
+        static bool ParseEasing(const std::string& token, uint8_t& out_easing) {
+            if (token == "linear") {
+                out_easing = SceneBytecode::EASE_LINEAR;
+            } else if (token == "in") {
+                out_easing = SceneBytecode::EASE_IN;
+            } else if (token == "out") {
+                out_easing = SceneBytecode::EASE_OUT;
+            } else if (token == "inout") {
+                out_easing = SceneBytecode::EASE_IN_OUT;
+            } else {
+                return false;
+            }
+
+            return true;
+        }
+
+        /**
+         * Parses an optional range at tokens[index] and writes it.
+         * \returns the index after the range.
+         */
+        size_t writeRange(const std::vector<std::string>& tokens, size_t index) {
+            uint32_t first;
+            uint32_t count;
+
+            if (tokens.size() >= index + 2 && ParseNumber(tokens[index], 255, first) && ParseNumber(tokens[index + 1], 255, count)) {
+                output->push_back(uint8_t(first));
+                output->push_back(uint8_t(count));
+                return index + 2;
+            }
+
+            output->push_back(0);
+            output->push_back(0);
+            return index;
+        }
+
+        bool compileLine(const std::vector<std::string>& tokens) {
+            const std::string& instruction = tokens[0];
+            size_t index;
+
+            if (instruction == "fill") {
+                RGBW color;
+
+                output->push_back(SceneBytecode::OP_FILL);
+                index = writeRange(tokens, 1);
+
+                if (tokens.size() != index + 1 || !ParseColor(tokens[index], color)) {
+                    return fail("expected: fill [first count] color");
+                }
+
+                writeColor(color);
+            } else if (instruction == "fade") {
+                RGBW from;
+                RGBW to;
+                uint32_t fadeDuration;
+                uint8_t easing = SceneBytecode::EASE_LINEAR;
+
+                output->push_back(SceneBytecode::OP_FADE);
+                index = writeRange(tokens, 1);
+
+                if (tokens.size() < index + 3 || tokens.size() > index + 4
+                        || !ParseColor(tokens[index], from) || !ParseColor(tokens[index + 1], to)
+                        || !ParseDuration(tokens[index + 2], fadeDuration)
+                        || (tokens.size() == index + 4 && !ParseEasing(tokens[index + 3], easing))) {
+                    return fail("expected: fade [first count] from to duration [linear|in|out|inout]");
+                }
+
+                writeColor(from);
+                writeColor(to);
+                writeU32(fadeDuration);
+                output->push_back(easing);
+            } else if (instruction == "wait") {
+                uint32_t waitDuration;
+
+                if (tokens.size() != 2 || !ParseDuration(tokens[1], waitDuration)) {
+                    return fail("expected: wait duration");
+                }
+
+                output->push_back(SceneBytecode::OP_WAIT);
+                writeU32(waitDuration);
+                duration = SceneBytecode::AddDuration(duration, waitDuration);
+            } else if (instruction == "loop") {
+                uint32_t count = 0;
+
+                if (tokens.size() > 2 || (tokens.size() == 2 && (!ParseNumber(tokens[1], 255, count) || count == 0))) {
+                    return fail("expected: loop [count 1-255]");
+                }
+
+                if (loops.size() >= SceneBytecode::MAX_LOOP_DEPTH) {
+                    return fail("too many nested loops");
+                }
+
+                loops.push_back(Loop{output->size(), uint8_t(count), duration});
+                output->resize(output->size() + SceneBytecode::GetInstructionSize(SceneBytecode::OP_LOOP));
+                duration = 0;
+            } else if (instruction == "end") {
+                if (tokens.size() != 1 || loops.empty()) {
+                    return fail("end without loop");
+                }
+
+                Loop loop = loops.back();
+                size_t bodyLength = output->size() - loop.headerPosition - SceneBytecode::GetInstructionSize(SceneBytecode::OP_LOOP);
+
+                if (bodyLength > 0xFFFF) {
+                    return fail("loop body too long");
+                }
+
+                uint8_t* header = output->data() + loop.headerPosition;
+                header[0] = SceneBytecode::OP_LOOP;
+                header[1] = loop.count;
+                header[2] = bodyLength & 0xFF;
+                header[3] = bodyLength >> 8;
+
+                for (int i = 0; i < 4; ++i) {
+                    header[4 + i] = (duration >> (8 * i)) & 0xFF;
+                }
+
+                uint32_t loopDuration = 0;
+
+                if (duration > 0) {
+                    loopDuration = loop.count > 0 ? SceneBytecode::MultiplyDuration(duration, loop.count) : SceneBytecode::DURATION_INFINITE;
+                }
+
+                duration = SceneBytecode::AddDuration(loop.outerDuration, loopDuration);
+                loops.pop_back();
+            } else if (instruction == "rainbow") {
+                uint32_t speed = 0;
+
+                output->push_back(SceneBytecode::OP_RAINBOW);
+                index = writeRange(tokens, 1);
+
+                if (tokens.size() > index + 1 || (tokens.size() == index + 1 && !ParseNumber(tokens[index], 0xFFFF, speed))) {
+                    return fail("expected: rainbow [first count] [speed]");
+                }
+
+                writeU16(0);    // One full rainbow over the range
+                writeU16(uint16_t(speed));
+            } else if (instruction == "dim") {
+                uint32_t amount;
+
+                output->push_back(SceneBytecode::OP_DIM);
+                index = writeRange(tokens, 1);
+
+                if (tokens.size() != index + 1 || !ParseNumber(tokens[index], 255, amount)) {
+                    return fail("expected: dim [first count] amount");
+                }
+
+                output->push_back(uint8_t(amount));
+            } else {
+                return fail("unknown instruction '" + instruction + "'");
+            }
+
+            return true;
+        }
+
+    public:
+        SceneCompiler() :
+            output(nullptr),
+            loops(),
+            duration(0),
+            errorLine(0),
+            error() {}
+
+        SceneCompiler(const SceneCompiler&) = delete;
+        SceneCompiler& operator=(const SceneCompiler&) = delete;
+
+        /**
+         * Compiles the scene.
+         * \param output Output for the bytecode, only defined when the return value is true.
+         * \returns false on errors, see getError() and getErrorLine().
+         */
+        bool compile(const std::string& source, std::vector<uint8_t>& output) {
+            this->output = &output;
+            loops.clear();
+            duration = 0;
+            errorLine = 0;
+            error.clear();
+
+            output.assign({'L', 'S', SceneBytecode::VERSION});
+
+            std::istringstream lines(source);
+            std::string line;
+
+            while (std::getline(lines, line)) {
+                ++errorLine;
+
+                size_t comment = line.find('#');
+
+                // '#' directly followed by a hex digit is a color
+                while (comment != std::string::npos && comment + 1 < line.size() && isxdigit(line[comment + 1])) {
+                    comment = line.find('#', comment + 1);
+                }
+
+                if (comment != std::string::npos) {
+                    line.resize(comment);
+                }
+
+                std::istringstream lineTokens(line);
+                std::vector<std::string> tokens;
+                std::string token;
+
+                while (lineTokens >> token) {
+                    tokens.push_back(token);
+                }
+
+                if (!tokens.empty() && !compileLine(tokens)) {
+                    return false;
+                }
+            }
+
+            if (!loops.empty()) {
+                return fail("missing end of loop");
+            }
+
+            errorLine = 0;
+            return true;
+        }
+
+        /// \returns the line of the last error, starting at 1.
+        size_t getErrorLine() const {
+            return errorLine;
+        }
+
+        const std::string& getError() const {
+            return error;
+        }
+};
@@ -0,0 +1,374 @@
+#pragma once
+
+#include "ILedStripWithStorage.h"
+#include "ColorKernels.h"
+#include "ProceduralEffects.h"
+#include "Instrumentation.h"
+
+#include <algorithm>
+#include <stddef.h>
+#include <stdint.h>
+
+/**
+* Bytecode of compiled scenes (see SceneCompiler).
+*
+* Layout: "LS", version (u8), followed by instructions. All values little endian.
+* A range is encoded as first led (u8) + count (u8), a count of 0 means up to the last led.
+*
+*   FILL    range, color (4)                                  Sets the leds
+*   FADE    range, from (4), to (4), duration (u32), easing   Fades the leds, starting at the current time
+*   WAIT    duration (u32)                                    Advances the current time
+*   LOOP    count (u8, 0 = forever), body length (u16),       Repeats the body, the body duration is
+*           body duration (u32), body                         computed by the compiler
+*   RAINBOW range, hue step per led (u16, 8.8), speed (u16)   Hue gradient, rotating with speed hues per second,
+*                                                             hue step 0 = one full rainbow over the range
+*   DIM     range, amount (u8)                                Scales the current colors by amount / 255
+*/
+struct SceneBytecode {
+    static constexpr uint8_t VERSION = 1;
+    static constexpr size_t HEADER_SIZE = 3;
+    static constexpr uint8_t MAX_LOOP_DEPTH = 8;
+    static constexpr uint32_t DURATION_INFINITE = UINT32_MAX;
+
+    enum Opcode : uint8_t {
+        OP_FILL = 1,
+        OP_FADE = 2,
+        OP_WAIT = 3,
+        OP_LOOP = 4,
+        OP_RAINBOW = 5,
+        OP_DIM = 6
+    };
+
+    enum Easing : uint8_t {
+        EASE_LINEAR = 0,
+        EASE_IN = 1,
+        EASE_OUT = 2,
+        EASE_IN_OUT = 3
+    };
+
+    /// \returns the size of the instruction including the opcode, not including a loop body, 0 for invalid opcodes.
+    static size_t GetInstructionSize(uint8_t opcode) {
+        switch (opcode) {
+            case OP_FILL: return 1 + 2 + 4;
+            case OP_FADE: return 1 + 2 + 4 + 4 + 4 + 1;
+            case OP_WAIT: return 1 + 4;
+            case OP_LOOP: return 1 + 1 + 2 + 4;
+            case OP_RAINBOW: return 1 + 2 + 2 + 2;
+            case OP_DIM: return 1 + 2 + 1;
+            default: return 0;
+        }
+    }
+
+    static uint16_t ReadU16(const uint8_t* ptr) {
+        return uint16_t(ptr[0]) | uint16_t(ptr[1]) << 8;
+    }
+
+    static uint32_t ReadU32(const uint8_t* ptr) {
+        return uint32_t(ReadU16(ptr)) | uint32_t(ReadU16(ptr + 2)) << 16;
+    }
+
+    static RGBW ReadColor(const uint8_t* ptr) {
+        return RGBW(ptr[0], ptr[1], ptr[2], ptr[3]);
+    }
+
+    static uint32_t AddDuration(uint32_t a, uint32_t b) {
+        return uint64_t(a) + b >= DURATION_INFINITE ? DURATION_INFINITE : a + b;
+    }
+
+    static uint32_t MultiplyDuration(uint32_t duration, uint32_t count) {
+        return uint64_t(duration) * count >= DURATION_INFINITE ? DURATION_INFINITE : duration * count;
+    }
+
+    /// Applies the easing to the factor in [0, 256].
+    static uint16_t Ease(uint8_t easing, uint16_t x) {
+        uint32_t inverse = 256 - x;
+
+        switch (easing) {
+            case EASE_IN:
+                return (uint32_t(x) * x) >> 8;
+            case EASE_OUT:
+                return 256 - ((inverse * inverse) >> 8);
+            case EASE_IN_OUT:
+                return x < 128 ? (uint32_t(x) * x) >> 7 : 256 - ((inverse * inverse) >> 7);
+            default:
+                return x;
+        }
+    }
+
+    /**
+     * Checks the instructions in [ptr, end) and computes their duration.
+     * \returns false when the bytecode is invalid.
+     */
+    static bool Validate(const uint8_t* ptr, const uint8_t* end, uint8_t depth, uint32_t& out_duration) {
+        out_duration = 0;
+
+        while (ptr < end) {
+            size_t size = GetInstructionSize(*ptr);
+
+            if (size == 0 || size_t(end - ptr) < size) {
+                return false;
+            }
+
+            if (*ptr == OP_WAIT) {
+                out_duration = AddDuration(out_duration, ReadU32(ptr + 1));
+            } else if (*ptr == OP_LOOP) {
+                uint8_t count = ptr[1];
+                uint16_t bodyLength = ReadU16(ptr + 2);
+                uint32_t bodyDuration = ReadU32(ptr + 4);
+                uint32_t validatedDuration;
+
+                if (depth >= MAX_LOOP_DEPTH || size_t(end - ptr) < size + bodyLength
+                        || !Validate(ptr + size, ptr + size + bodyLength, depth + 1, validatedDuration)
+                        || validatedDuration != bodyDuration) {
+                    return false;
+                }
+
+                if (bodyDuration > 0) {
+                    out_duration = AddDuration(out_duration, count > 0 ? MultiplyDuration(bodyDuration, count) : DURATION_INFINITE);
+                }
+
+                ptr += bodyLength;
+            }
+
+            ptr += size;
+        }
+
+        return true;
+    }
+};
+
+/**
+* Interpreter for compiled scenes.
+* Each frame the program is evaluated for the current time: Instructions run in order, WAIT advances
+* the time cursor and the evaluation stops at the first instruction after the current time.
+* Loops jump directly to the current iteration, so the work per frame does not grow with the elapsed time.
+* Leds which are not written by the scene keep their color.
+*
+* The VM does not copy the bytecode and does not allocate memory.
+*/
+class SceneVM {
+    private:
+        ILedStripWithStorage& ledControl;
+
+        const uint8_t* code;
+        size_t codeSize;
+        uint32_t duration;
+        uint32_t startTime;
+
+        void getRange(const uint8_t* ptr, ledoffset_t& out_first, ledoffset_t& out_count) const {
+            ledoffset_t ledCount = ledControl.getLedCount();
+
+            out_first = std::min(ptr[0], ledCount);
+            out_count = ptr[1] == 0 ? ledCount - out_first : std::min<ledoffset_t>(ptr[1], ledCount - out_first);
+        }
+
+        void fill(RGBW* pixels, ledoffset_t first, ledoffset_t count, RGBW color) {
+            if (pixels) {
+                std::fill_n(pixels + first, count, color);
+            } else {
+                ledControl.setRange(first, count, color, false);
+            }
+        }
+
+        void rainbow(RGBW* pixels, ledoffset_t first, ledoffset_t count, uint16_t hueStep, uint16_t speed, uint32_t time) {
+            uint16_t startHue = uint16_t((uint64_t(time) * speed * 256 / 1000) & 0xFFFF);
+
+            if (hueStep == 0 && count > 0) {
+                hueStep = 0x10000 / count;
+            }
+
+            if (pixels) {
+                FillHueGradient(pixels + first, count, startHue, hueStep);
+                return;
+            }
+
+            RGBW chunk[32];
+
+            for (ledoffset_t offset = 0; offset < count; offset += std::min<ledoffset_t>(32, count - offset)) {
+                ledoffset_t chunkCount = std::min<ledoffset_t>(32, count - offset);
+
+                FillHueGradient(chunk, chunkCount, startHue + offset * hueStep, hueStep);
+                ledControl.setLeds(first + offset, chunk, chunkCount, false);
+            }
+        }
+
+        void dim(RGBW* pixels, ledoffset_t first, ledoffset_t count, uint8_t amount) {
+            for (ledoffset_t i = first; i < first + count; ++i) {
+                RGBW color = pixels ? pixels[i] : ledControl.getLed(i);
+                color = RGBW(Scale8(color.r, amount), Scale8(color.g, amount), Scale8(color.b, amount), Scale8(color.w, amount));
+
+                if (pixels) {
+                    pixels[i] = color;
+                } else {
+                    ledControl.setLed(i, color, false);
+                }
+            }
+        }
+
+        /**
+         * Executes the instructions in [ptr, end) for the time.
+         * \returns false when the time cursor passed the time, the evaluation stops then.
+         */
+        bool execute(const uint8_t* ptr, const uint8_t* end, uint32_t& cursor, uint32_t time, RGBW* pixels) {
+            while (ptr < end) {
+                const uint8_t opcode = *ptr;
+                const size_t size = SceneBytecode::GetInstructionSize(opcode);
+                const uint8_t* operands = ptr + 1;
+                ledoffset_t first;
+                ledoffset_t count;
+
+                switch (opcode) {
+                    case SceneBytecode::OP_FILL:
+                        getRange(operands, first, count);
+                        fill(pixels, first, count, SceneBytecode::ReadColor(operands + 2));
+                        break;
+
+                    case SceneBytecode::OP_FADE: {
+                        getRange(operands, first, count);
+
+                        uint32_t fadeDuration = SceneBytecode::ReadU32(operands + 10);
+                        uint32_t elapsed = time - cursor;
+                        uint16_t factor = elapsed >= fadeDuration ? 256 : uint16_t((uint64_t(elapsed) << 8) / fadeDuration);
+
+                        factor = SceneBytecode::Ease(operands[14], factor);
+
+                        RGBW from = SceneBytecode::ReadColor(operands + 2);
+                        RGBW to = SceneBytecode::ReadColor(operands + 6);
+                        RGBW color(Lerp8(from.r, to.r, factor), Lerp8(from.g, to.g, factor), Lerp8(from.b, to.b, factor), Lerp8(from.w, to.w, factor));
+
+                        fill(pixels, first, count, color);
+                        break;
+                    }
+
+                    case SceneBytecode::OP_WAIT:
+                        cursor = SceneBytecode::AddDuration(cursor, SceneBytecode::ReadU32(operands));
+
+                        if (cursor > time) {
+                            return false;
+                        }
+                        break;
+
+                    case SceneBytecode::OP_LOOP: {
+                        const uint8_t loopCount = operands[0];
+                        const uint16_t bodyLength = SceneBytecode::ReadU16(operands + 1);
+                        const uint32_t bodyDuration = SceneBytecode::ReadU32(operands + 3);
+                        const uint8_t* body = ptr + size;
+
+                        ptr += bodyLength;
+
+                        if (bodyDuration == 0) {
+                            if (!execute(body, body + bodyLength, cursor, time, pixels)) {
+                                return false;
+                            }
+                            break;
+                        }
+
+                        // Jump to the current iteration (or the last one, when the loop is finished)
+                        uint32_t iteration = (time - cursor) / bodyDuration;
+
+                        if (loopCount > 0) {
+                            iteration = std::min<uint32_t>(iteration, loopCount - 1);
+                        }
+
+                        uint32_t iterationCursor = cursor + iteration * bodyDuration;
+
+                        if (!execute(body, body + bodyLength, iterationCursor, time, pixels) || loopCount == 0) {
+                            return false;
+                        }
+
+                        cursor = SceneBytecode::AddDuration(cursor, SceneBytecode::MultiplyDuration(bodyDuration, loopCount));
+
+                        if (cursor > time) {
+                            return false;
+                        }
+                        break;
+                    }
+
+                    case SceneBytecode::OP_RAINBOW:
+                        getRange(operands, first, count);
+                        rainbow(pixels, first, count, SceneBytecode::ReadU16(operands + 2), SceneBytecode::ReadU16(operands + 4), time - cursor);
+                        break;
+
+                    case SceneBytecode::OP_DIM:
+                        getRange(operands, first, count);
+                        dim(pixels, first, count, operands[2]);
+                        break;
+                }
+
+                ptr += size;
+            }
+
+            return true;
+        }
+
+    public:
+        SceneVM(ILedStripWithStorage& ledControl) :
+            ledControl(ledControl),
+            code(nullptr),
+            codeSize(0),
+            duration(0),
+            startTime(0) {}
+
+        /**
+         * Loads the bytecode, the data is not copied and must stay valid while the scene is used.
+         * \returns false when the bytecode is invalid, the VM has no scene loaded then.
+         */
+        bool load(const uint8_t* data, size_t size, uint32_t startTime = 0) {
+            code = nullptr;
+            codeSize = 0;
+
+            if (size < SceneBytecode::HEADER_SIZE || data[0] != 'L' || data[1] != 'S' || data[2] != SceneBytecode::VERSION) {
+                return false;
+            }
+
+            if (!SceneBytecode::Validate(data + SceneBytecode::HEADER_SIZE, data + size, 0, duration)) {
+                return false;
+            }
+
+            code = data;
+            codeSize = size;
+            this->startTime = startTime;
+            return true;
+        }
+
+        bool isLoaded() const {
+            return code != nullptr;
+        }
+
+        /// Restarts the scene at the given time.
+        void start(uint32_t startTime) {
+            this->startTime = startTime;
+        }
+
+        /// \returns the total duration of the scene in milliseconds, SceneBytecode::DURATION_INFINITE for endless loops.
+        uint32_t getDuration() const {
+            return duration;
+        }
+
+        bool isFinished(uint32_t currentTime) const {
+            return duration != SceneBytecode::DURATION_INFINITE && currentTime - startTime >= duration;
+        }
+
+        /**
+         * Evaluates the scene for the current time and writes the leds.
+         * \returns false when no scene is loaded.
+         */
+        bool render(uint32_t currentTime, bool flush = true) {
+            if (!code) {
+                return false;
+            }
+
+            {
+                ScopedStageTimer timer(InstrumentationStage::AnimationUpdate);
+
+                uint32_t cursor = 0;
+                execute(code + SceneBytecode::HEADER_SIZE, code + codeSize, cursor, currentTime - startTime, ledControl.getPixelBuffer());
+            }
+
+            if (flush) {
+                ledControl.updateLeds();
+            }
+
+            return true;
+        }
+};
@@ -0,0 +1,24 @@
+#pragma once
+
+#include <Arduino.h>
+
+#include <stddef.h>
+#include <stdint.h>
+
+/**
+* Writes the data MSB first via bit banging on the clock and data pin (SPI mode 0, no chip select).
+* Used by the two wire led controllers (APA102, LPD8806).
+*/
+inline void SoftwareSPIWrite(const uint8_t* ptr, size_t length, uint16_t pinClock, uint16_t pinData) {
+    for (size_t i = 0; i < length; ++i) {
+        uint8_t byte = ptr[i];
+
+        for (int j = 7; j >= 0; j--) {
+            bool state = byte & (1 << j);
+
+            digitalWrite(pinData, state);
+            digitalWrite(pinClock, 1);
+            digitalWrite(pinClock, 0);
+        }
+    }
+}
@@ -0,0 +1,168 @@
+#pragma once
+
+#include "AnimationManager.h"
+
+#include <array>
+#include <new>
+#include <utility>
+#include <cstddef>
+
+/**
+ * AnimationManager with a fixed capacity, does not allocate memory.
+ * The animations are constructed in place into in-object slots of SlotSize bytes (see emplaceAnimation()),
+ * so the worst case memory usage is known at compile time.
+ * Animations are updated in the order they were added, each affected strip is flushed once per update.
+ */
+template<size_t MaxAnimations, size_t SlotSize = 64>
+class StaticAnimationManager {
+    private:
+        struct Slot {
+            alignas(alignof(std::max_align_t)) uint8_t storage[SlotSize];
+        };
+
+        struct Entry {
+            ALedAnimation* animation;
+            Slot* slot;     // Start of the constructed object, may differ from the ALedAnimation base
+        };
+
+        std::array<Slot, MaxAnimations> slots;
+        std::array<Entry, MaxAnimations> queue;         // Active animations, in order of adding
+        std::array<Slot*, MaxAnimations> freeSlots;     // Stack of unused slots
+        std::array<ILedStripWithStorage*, MaxAnimations> strips;
+        size_t countAnimations;
+        size_t countFreeSlots;
+        IAnimationClock* clock;
+
+        void destroy(const Entry& entry) {
+            entry.animation->~ALedAnimation();
+            freeSlots[countFreeSlots++] = entry.slot;
+        }
+
+    public:
+        StaticAnimationManager() :
+            slots(),
+            queue(),
+            freeSlots(),
+            strips(),
+            countAnimations(0),
+            countFreeSlots(MaxAnimations),
+            clock(nullptr) {
+
+            for (size_t i = 0; i < MaxAnimations; ++i) {
+                freeSlots[i] = &slots[MaxAnimations - 1 - i];
+            }
+        }
+
+        StaticAnimationManager(const StaticAnimationManager&) = delete;
+        StaticAnimationManager& operator=(const StaticAnimationManager&) = delete;
+
+        ~StaticAnimationManager() {
+            clear();
+        }
+
+        /**
+         * Constructs the animation in a free slot, e.g. emplaceAnimation<FadeAnimation>(startTime, duration, strip, ...).
+         * \returns the animation, nullptr when all slots are in use.
+         */
+        template<typename Animation, typename... Args>
+        Animation* emplaceAnimation(Args&&... args) {
+            static_assert(sizeof(Animation) <= SlotSize, "Animation does not fit into the slot, increase SlotSize");
+            static_assert(alignof(Animation) <= alignof(std::max_align_t), "Unsupported alignment of the animation");
+
+            if (countFreeSlots == 0) {
+                return nullptr;
+            }
+
+            Slot* slot = freeSlots[--countFreeSlots];
+            Animation* animation = new (slot->storage) Animation(std::forward<Args>(args)...);
+
+            queue[countAnimations++] = Entry{animation, slot};
+            return animation;
+        }
+
+        /**
+         * Sets the time source of update(), nullptr to use millis(), see AnimationManager::setClock().
+         */
+        void setClock(IAnimationClock* newClock) {
+            clock = newClock;
+        }
+
+        void update() {
+            if (clock) {
+                updateMicros(clock->nowMicros());
+            } else {
+                update(millis());
+            }
+        }
+
+        void updateMicros(uint64_t currentMicros) {
+            update(uint32_t(currentMicros / 1000), uint16_t(currentMicros % 1000));
+        }
+
+        void update(uint32_t currentTime, uint16_t frameMicros = 0) {
+            size_t countStrips = 0;
+
+            {
+                ScopedStageTimer timer(InstrumentationStage::AnimationUpdate);
+
+                for (size_t i = 0; i < countAnimations; ++i) {
+                    ALedAnimation* animation = queue[i].animation;
+
+                    if (!animation->hasStarted(currentTime))
+                        continue;
+
+                    animation->setFrameMicros(frameMicros);
+                    animation->update(currentTime);
+
+                    ILedStripWithStorage* strip = &animation->getLedControl();
+
+                    if (std::find(strips.begin(), strips.begin() + countStrips, strip) == strips.begin() + countStrips) {
+                        strips[countStrips++] = strip;
+                    }
+                }
+            }
+
+            for (size_t i = 0; i < countStrips; ++i) {
+                strips[i]->updateLeds();
+            }
+
+            // Drop the finished animations, keeping the order of the remaining ones
+            size_t remaining = 0;
+
+            for (size_t i = 0; i < countAnimations; ++i) {
+                const ALedAnimation* animation = queue[i].animation;
+
+                if (animation->isFinished(currentTime)) {
+                    destroy(queue[i]);
+                } else {
+                    queue[remaining++] = queue[i];
+                }
+            }
+
+            countAnimations = remaining;
+        }
+
+        bool empty() const {
+            return countAnimations == 0;
+        }
+
+        size_t size() const {
+            return countAnimations;
+        }
+
+        static constexpr size_t capacity() {
+            return MaxAnimations;
+        }
+
+        /**
+         * Deletes all active animations.
+         * Note that the end color of animations will not be applied.
+         */
+        void clear() {
+            for (size_t i = 0; i < countAnimations; ++i) {
+                destroy(queue[i]);
+            }
+
+            countAnimations = 0;
+        }
+};
@@ -0,0 +1,40 @@
+#pragma once
+
+#include "LedBufferStorage.h"
+
+#include <array>
+
+/**
+ * In-object buffer for fixed capacity classes.
+ * Used as first (private) base class, so the buffer is constructed before the classes using it (base from member).
+ */
+template<typename T, size_t Size>
+struct StaticBufferHolder {
+    std::array<T, Size> staticBuffer;
+
+    StaticBufferHolder() :
+        staticBuffer() {}
+};
+
+/**
+ * LedBufferStorage with an in-object pixel buffer for LedCount leds, does not allocate memory.
+ */
+template<ledoffset_t LedCount>
+class StaticLedBufferStorage : private StaticBufferHolder<RGBW, LedCount>, public LedBufferStorage {
+    private:
+        typedef StaticBufferHolder<RGBW, LedCount> Holder;
+
+    public:
+        StaticLedBufferStorage() :
+            Holder(),
+            LedBufferStorage(Holder::staticBuffer.data(), LedCount) {}
+
+        StaticLedBufferStorage(const StaticLedBufferStorage& other) :
+            Holder(other),
+            LedBufferStorage(Holder::staticBuffer.data(), LedCount) {}
+
+        StaticLedBufferStorage& operator=(const StaticLedBufferStorage& other) {
+            LedBufferStorage::operator=(other);
+            return *this;
+        }
+};
@@ -0,0 +1,389 @@
+#pragma once
+
+#include "ILedStripWithStorage.h"
+#include "ILedWireOutput.h"
+#include "LedWireEncoding.h"
+#include "VirtualLedStripWithPowerLimit.h"
+#include "ColorKernels.h"
+#include "SoftwareSPI.h"
+#include "Instrumentation.h"
+
+#include <array>
+#include <tuple>
+#include <utility>
+#include <algorithm>
+
+/**
+* Led pipeline composed at compile time, e.g.
+*   StaticPipeline<APA102Output<60, PIN_CLOCK, PIN_DATA>, InverseStage, PowerLimitStage<CONSUMPTION, 2000>>
+*
+* The pipeline owns the pixels, each render() passes every pixel through all stages (in order) and encodes
+* it into the output. All calls are resolved statically, so the compiler can inline the whole per-pixel path.
+* Use StaticPipelineLedStrip to use the pipeline via the ILedStripWithStorage interface.
+*
+* A stage derives from PipelineStage and overrides (hides) the functions it needs.
+* An output provides LED_COUNT, encode(index, color) and transmit().
+*/
+
+/**
+* Base of the pipeline stages, all functions do nothing.
+*/
+struct PipelineStage {
+    /// Stages which need the whole frame before the first pixel set this to true, see observe().
+    static constexpr bool OBSERVES_FRAME = false;
+
+    /// Called before the pre-pass over the frame.
+    void beginFrame() {}
+
+    /// Called in the pre-pass for each pixel, with the color after all previous stages.
+    void observe(RGBW color) {
+        (void)color;
+    }
+
+    /// Called after the pre-pass over the frame.
+    void endFrame(ledoffset_t ledCount) {
+        (void)ledCount;
+    }
+
+    /// \returns the output index of the led.
+    ledoffset_t mapIndex(ledoffset_t index, ledoffset_t ledCount) const {
+        (void)ledCount;
+        return index;
+    }
+
+    RGBW apply(RGBW color) const {
+        return color;
+    }
+};
+
+/**
+* Reverses the led order, see VirtualInversedLedStrip.
+*/
+struct InverseStage : public PipelineStage {
+    ledoffset_t mapIndex(ledoffset_t index, ledoffset_t ledCount) const {
+        return ledCount - 1 - index;
+    }
+};
+
+/**
+* Scales all channels by brightness / 255.
+*/
+struct BrightnessStage : public PipelineStage {
+    uint8_t brightness = 0xFF;
+
+    RGBW apply(RGBW color) const {
+        return RGBW(Scale8(color.r, brightness), Scale8(color.g, brightness), Scale8(color.b, brightness), Scale8(color.w, brightness));
+    }
+};
+
+/**
+* Moves the white part of each color into the W channel, see ExtractWhite().
+*/
+struct WhiteExtractionStage : public PipelineStage {
+    WhitePoint whitePoint;
+
+    RGBW apply(RGBW color) const {
+        ExtractWhite(&color, 1, whitePoint);
+        return color;
+    }
+};
+
+/**
+* Limits the power consumption of the frame (see ComputePowerScale()), by scaling all leds with the same factor.
+* \tparam ConsumptionInfo consumption of one led, must have static storage duration
+* \tparam PowerLimit_mA initial power limit, see setPowerLimit()
+*/
+template<const LedPowerConsumptionInfo& ConsumptionInfo, uint32_t PowerLimit_mA>
+class PowerLimitStage : public PipelineStage {
+    private:
+        float powerLimit_mA = PowerLimit_mA;
+        uint32_t sumColor = 0;
+        uint32_t sumWhite = 0;
+        uint16_t scale = 256;   // 8.8 fixed point
+
+    public:
+        static constexpr bool OBSERVES_FRAME = true;
+
+        void beginFrame() {
+            sumColor = 0;
+            sumWhite = 0;
+        }
+
+        void observe(RGBW color) {
+            sumColor += uint32_t(color.r) + color.g + color.b;
+            sumWhite += color.w;
+        }
+
+        void endFrame(ledoffset_t ledCount) {
+            scale = ComputePowerScale(ConsumptionInfo, powerLimit_mA, ledCount, float(sumColor), float(sumWhite));
+        }
+
+        RGBW apply(RGBW color) const {
+            if (scale >= 256) {
+                return color;
+            }
+
+            return RGBW((color.r * scale) >> 8, (color.g * scale) >> 8, (color.b * scale) >> 8, (color.w * scale) >> 8);
+        }
+
+        void setPowerLimit(float newPowerLimit_mA) {
+            powerLimit_mA = newPowerLimit_mA;
+        }
+
+        /// \returns the scale (8.8 fixed point) of the last frame.
+        uint16_t getScale() const {
+            return scale;
+        }
+};
+
+/**
+* Output with an in-object wire buffer, Encoding is one of the LedWireEncoding.h encodings.
+* Does not transmit the buffer itself, see getWireBuffer() (e.g. for a DMA transfer).
+*/
+template<typename Encoding, ledoffset_t LedCount>
+class StaticWireBuffer {
+    protected:
+        std::array<uint8_t, Encoding::GetBufferSize(LedCount)> wireBuffer;
+
+    public:
+        static constexpr ledoffset_t LED_COUNT = LedCount;
+
+        StaticWireBuffer() :
+            wireBuffer() {}
+
+        void encode(ledoffset_t index, RGBW color) {
+            Encoding::EncodeLed(wireBuffer.data(), index, color);
+        }
+
+        void transmit() {}
+
+        const uint8_t* getWireBuffer() const {
+            return wireBuffer.data();
+        }
+
+        static constexpr size_t getWireBufferSize() {
+            return Encoding::GetBufferSize(LedCount);
+        }
+};
+
+/**
+* Two wire output (clock + data) via SoftwareSPIWrite().
+*/
+template<typename Encoding, ledoffset_t LedCount, uint16_t PinClock, uint16_t PinData>
+class SoftwareSPIOutput : public StaticWireBuffer<Encoding, LedCount> {
+    public:
+        SoftwareSPIOutput() {
+            pinMode(PinClock, OUTPUT);
+            pinMode(PinData, OUTPUT);
+        }
+
+        void transmit() {
+            ScopedStageTimer timer(InstrumentationStage::Transmit);
+            SoftwareSPIWrite(this->wireBuffer.data(), this->wireBuffer.size(), PinClock, PinData);
+        }
+};
+
+template<ledoffset_t LedCount, uint16_t PinClock, uint16_t PinData>
+using APA102Output = SoftwareSPIOutput<APA102Encoding, LedCount, PinClock, PinData>;
+
+template<ledoffset_t LedCount, uint16_t PinClock, uint16_t PinData>
+using LPD8806Output = SoftwareSPIOutput<LPD8806Encoding, LedCount, PinClock, PinData>;
+
+/**
+* Output into the wire buffer of a driver which implements ILedWireOutput
+* (e.g. LedStrip_Simulated, LedStrip_APA102 or LedStrip_LPD8806), the encoding must match the protocol of the driver.
+* When the wire buffer does not have the size of LedCount leds in this encoding, nothing is encoded or transmitted.
+*/
+template<typename Encoding, ledoffset_t LedCount>
+class WireOutputSink {
+    private:
+        ILedWireOutput& output;
+        uint8_t* wireBuffer;    // nullptr when the wire buffer size does not match
+
+    public:
+        static constexpr ledoffset_t LED_COUNT = LedCount;
+
+        WireOutputSink(ILedWireOutput& output) :
+            output(output),
+            wireBuffer(output.getWireBufferSize() == Encoding::GetBufferSize(LedCount) ? output.getWireBuffer() : nullptr) {}
+
+        WireOutputSink(const WireOutputSink&) = delete;
+        WireOutputSink& operator=(const WireOutputSink&) = delete;
+
+        /// \returns true when the wire buffer of the driver matches the encoding and led count.
+        bool isValid() const {
+            return wireBuffer != nullptr;
+        }
+
+        void encode(ledoffset_t index, RGBW color) {
+            if (wireBuffer) {
+                Encoding::EncodeLed(wireBuffer, index, color);
+            }
+        }
+
+        void transmit() {
+            if (wireBuffer) {
+                output.transmitWireBuffer();
+            }
+        }
+};
+
+template<typename Output, typename... Stages>
+class StaticPipeline {
+    public:
+        static constexpr ledoffset_t LED_COUNT = Output::LED_COUNT;
+
+    private:
+        static constexpr bool OBSERVES_FRAME = (false || ... || Stages::OBSERVES_FRAME);
+
+        std::array<RGBW, LED_COUNT> pixels;
+        std::tuple<Stages...> stages;
+        Output output;
+
+        void observeFrame() {
+            ScopedStageTimer timer(InstrumentationStage::PowerLimit);
+
+            std::apply([](Stages&... stage) {
+                (stage.beginFrame(), ...);
+            }, stages);
+
+            for (ledoffset_t i = 0; i < LED_COUNT; ++i) {
+                RGBW color = pixels[i];
+
+                std::apply([&color](Stages&... stage) {
+                    ((stage.observe(color), color = stage.apply(color)), ...);
+                }, stages);
+            }
+
+            std::apply([](Stages&... stage) {
+                (stage.endFrame(LED_COUNT), ...);
+            }, stages);
+        }
+
+    public:
+        /**
+         * \param outputArgs arguments for the constructor of the output
+         */
+        template<typename... OutputArgs>
+        StaticPipeline(OutputArgs&&... outputArgs) :
+            pixels(),
+            stages(),
+            output(std::forward<OutputArgs>(outputArgs)...) {}
+
+        RGBW* getPixels() {
+            return pixels.data();
+        }
+
+        const RGBW* getPixels() const {
+            return pixels.data();
+        }
+
+        void setLed(ledoffset_t index, RGBW color) {
+            pixels[index] = color;
+        }
+
+        RGBW getLed(ledoffset_t index) const {
+            return pixels[index];
+        }
+
+        void setAll(RGBW color) {
+            pixels.fill(color);
+        }
+
+        template<typename Stage>
+        Stage& getStage() {
+            return std::get<Stage>(stages);
+        }
+
+        Output& getOutput() {
+            return output;
+        }
+
+        /**
+         * Passes all pixels through the stages, encodes them into the output and transmits the frame.
+         */
+        void render() {
+            if constexpr (OBSERVES_FRAME) {
+                observeFrame();
+            }
+
+            {
+                ScopedStageTimer timer(InstrumentationStage::Encoding);
+
+                for (ledoffset_t i = 0; i < LED_COUNT; ++i) {
+                    RGBW color = pixels[i];
+                    ledoffset_t index = i;
+
+                    std::apply([&color, &index](const Stages&... stage) {
+                        ((color = stage.apply(color), index = stage.mapIndex(index, LED_COUNT)), ...);
+                    }, stages);
+
+                    output.encode(index, color);
+                }
+            }
+
+            output.transmit();
+        }
+};
+
+/**
+* Adapter to use a StaticPipeline via the ILedStripWithStorage interface, updateLeds() renders the pipeline.
+* Only the calls on the adapter are virtual, the pipeline itself stays statically resolved.
+*/
+template<typename Pipeline>
+class StaticPipelineLedStrip : public ILedStripWithStorage {
+    private:
+        Pipeline& pipeline;
+
+    public:
+        StaticPipelineLedStrip(Pipeline& pipeline) :
+            pipeline(pipeline) {}
+
+        virtual ledoffset_t getLedCount() const override {
+            return Pipeline::LED_COUNT;
+        }
+
+        virtual void setLed(ledoffset_t index, RGBW color, bool flush = false) override {
+            pipeline.setLed(index, color);
+
+            if (flush) {
+                updateLeds();
+            }
+        }
+
+        virtual void setRange(ledoffset_t index, ledoffset_t count, RGBW color, bool flush = false) override {
+            std::fill_n(pipeline.getPixels() + index, count, color);
+
+            if (flush) {
+                updateLeds();
+            }
+        }
+
+        virtual void setLeds(ledoffset_t index, const RGBW* colors, ledoffset_t count, bool flush = false) override {
+            std::copy_n(colors, count, pipeline.getPixels() + index);
+
+            if (flush) {
+                updateLeds();
+            }
+        }
+
+        virtual RGBW getLed(ledoffset_t index) const override {
+            return pipeline.getLed(index);
+        }
+
+        virtual void getLeds(ledoffset_t index, RGBW* output, ledoffset_t count) const override {
+            std::copy_n(pipeline.getPixels() + index, count, output);
+        }
+
+        virtual RGBW* getPixelBuffer() override {
+            return pipeline.getPixels();
+        }
+
+        virtual const RGBW* getPixels() const override {
+            return pipeline.getPixels();
+        }
+
+        virtual void updateLeds() override {
+            pipeline.render();
+        }
+};
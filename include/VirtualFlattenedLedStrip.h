@@ -0,0 +1,198 @@
+#pragma once
+
+#include "ILedStripWithStorage.h"
+#include "LedIndexRun.h"
+
+#include <vector>
+#include <algorithm>
+
+/**
+* Flattened view of a chain of virtual led strips.
+* Resolves every led of the source strip once via ILedStripWithStorage::resolveLed()
+* and stores the result either as runs (start, count, stride) when the mapping is regular
+* or as a plain lookup table otherwise.
+*
+* Accessing a led is a single lookup plus a direct store into the pixel buffer of the
+* underlying strip (or one virtual call, when the strip has no pixel buffer).
+*
+* Note: The view must be rebuilt via rebuild() when the structure of the source chain changes.
+*/
+class VirtualFlattenedLedStrip : public ILedStripWithStorage {
+    private:
+        struct Leaf {
+            ILedStripWithStorage* strip;
+            RGBW* pixels;
+        };
+
+        struct Run {
+            ledoffset_t offset;     // Offset of the first led in this (virtual) strip
+            ledoffset_t baseIndex;  // Index of the first led in the leaf strip
+            ledoffset_t count;
+            int8_t stride;
+            uint8_t leaf;
+        };
+
+        struct Entry {
+            ledoffset_t baseIndex;
+            uint8_t leaf;
+        };
+
+        ILedStripWithStorage& source;
+        ledoffset_t ledCount;
+
+        std::vector<Leaf> leafs;
+        std::vector<Run> runs;
+        std::vector<Entry> entries;
+
+        uint8_t getLeafIndex(ILedStripWithStorage& strip) {
+            for (size_t i = 0; i < leafs.size(); ++i) {
+                if (leafs[i].strip == &strip) {
+                    return i;
+                }
+            }
+
+            leafs.push_back({&strip, strip.getPixelBuffer()});
+            return leafs.size() - 1;
+        }
+
+        Entry getEntry(ledoffset_t index) const {
+            if (!entries.empty()) {
+                return entries[index];
+            }
+
+            const Run& run = FindLedIndexRun(runs, index);
+            return {ledoffset_t(run.baseIndex + (index - run.offset) * run.stride), run.leaf};
+        }
+
+    public:
+        VirtualFlattenedLedStrip(ILedStripWithStorage& source) :
+            source(source),
+            ledCount(0),
+            leafs(),
+            runs(),
+            entries() {
+
+            rebuild();
+        }
+
+        /**
+         * Resolves all leds of the source strip again.
+         * Call this after the structure of the source chain (or the pixel buffer of a leaf) changed.
+         */
+        void rebuild() {
+            ledCount = source.getLedCount();
+            leafs.clear();
+            runs.clear();
+            entries.clear();
+
+            std::vector<Entry> table(ledCount);
+
+            for (ledoffset_t i = 0; i < ledCount; ++i) {
+                ledoffset_t baseIndex = i;
+                ILedStripWithStorage& leaf = source.resolveLed(baseIndex);
+
+                table[i] = {baseIndex, getLeafIndex(leaf)};
+
+                // Runs never span two leaf strips
+                bool sameLeaf = !runs.empty() && runs.back().leaf == table[i].leaf;
+                AppendLedIndexRun(runs, i, baseIndex, sameLeaf).leaf = table[i].leaf;
+            }
+
+            // Keep the run description only when it is smaller than the lookup table
+            if (runs.size() * sizeof(Run) > table.size() * sizeof(Entry)) {
+                runs.clear();
+                entries = std::move(table);
+            }
+        }
+
+        /// \returns the number of runs the mapping is stored as, 0 when stored as lookup table.
+        size_t getRunCount() const {
+            return runs.size();
+        }
+
+        virtual ledoffset_t getLedCount() const override {
+            return ledCount;
+        }
+
+        virtual void setLed(ledoffset_t index, RGBW color, bool flush = false) override {
+            Entry entry = getEntry(index);
+            const Leaf& leaf = leafs[entry.leaf];
+
+            if (leaf.pixels) {
+                leaf.pixels[entry.baseIndex] = color;
+            } else {
+                leaf.strip->setLed(entry.baseIndex, color, false);
+            }
+
+            if (flush) {
+                updateLeds();
+            }
+        }
+
+        virtual void setRange(ledoffset_t index, ledoffset_t count, RGBW color, bool flush = false) override {
+            if (!entries.empty()) {
+                ILedStripWithStorage::setRange(index, count, color, flush);
+                return;
+            }
+
+            ledoffset_t end = index + count;
+
+            for (const Run& run : runs) {
+                ledoffset_t runEnd = run.offset + run.count;
+
+                if (runEnd <= index || run.offset >= end) {
+                    continue;
+                }
+
+                ledoffset_t first = std::max(index, run.offset) - run.offset;
+                ledoffset_t last = std::min(end, runEnd) - run.offset;
+                const Leaf& leaf = leafs[run.leaf];
+
+                for (ledoffset_t i = first; i < last; ++i) {
+                    ledoffset_t baseIndex = run.baseIndex + i * run.stride;
+
+                    if (leaf.pixels) {
+                        leaf.pixels[baseIndex] = color;
+                    } else {
+                        leaf.strip->setLed(baseIndex, color, false);
+                    }
+                }
+            }
+
+            if (flush) {
+                updateLeds();
+            }
+        }
+
+        virtual RGBW getLed(ledoffset_t index) const override {
+            Entry entry = getEntry(index);
+            const Leaf& leaf = leafs[entry.leaf];
+
+            if (leaf.pixels) {
+                return leaf.pixels[entry.baseIndex];
+            }
+
+            return leaf.strip->getLed(entry.baseIndex);
+        }
+
+        virtual ILedStripWithStorage& resolveLed(ledoffset_t& inout_index) override {
+            Entry entry = getEntry(inout_index);
+
+            inout_index = entry.baseIndex;
+            return *leafs[entry.leaf].strip;
+        }
+
+        /**
+         * Updates all underlying led strips once.
+         */
+        virtual void updateLeds() override {
+            for (const Leaf& leaf : leafs) {
+                // Writes went through the kept pixel buffer, request it again so the strip notices them
+                if (leaf.pixels) {
+                    leaf.strip->getPixelBuffer();
+                }
+
+                leaf.strip->updateLeds();
+            }
+        }
+};
@@ -1,9 +1,11 @@
 #pragma once
 
 #include "ILedStripWithStorage.h"
+#include "LedIndexRun.h"
 
 #include <vector>
 #include <iterator>
+#include <algorithm>
 
 template <typename ... Base>
 class VirtualMultiLedStrip : public virtual ILedStripWithStorage {
@@ -16,6 +18,12 @@ class VirtualMultiLedStrip : public virtual ILedStripWithStorage {
         virtual RGBW getLed(ledoffset_t index) const override {
             return RGBW();
         }
+        virtual ledoffset_t activeCount() const override {
+            return 0;
+        }
+        virtual bool isAnyActive() const override {
+            return false;
+        }
         virtual void updateLeds() override {}
 };
 
@@ -56,6 +64,47 @@ class VirtualMultiLedStrip<Base, Rest ...> : public virtual ILedStripWithStorage
             }
         }
 
+        virtual void setRange(ledoffset_t index, ledoffset_t count, RGBW color, bool flush = false) override {
+            ledoffset_t firstCount = first.getLedCount();
+
+            if (index < firstCount) {
+                ledoffset_t countFirst = std::min<ledoffset_t>(count, firstCount - index);
+
+                first.setRange(index, countFirst, color, false);
+                index = firstCount;
+                count -= countFirst;
+            }
+
+            if (count > 0) {
+                rest.setRange(index - firstCount, count, color, false);
+            }
+
+            if (flush) {
+                updateLeds();
+            }
+        }
+
+        virtual void setLeds(ledoffset_t index, const RGBW* colors, ledoffset_t count, bool flush = false) override {
+            ledoffset_t firstCount = first.getLedCount();
+
+            if (index < firstCount) {
+                ledoffset_t countFirst = std::min<ledoffset_t>(count, firstCount - index);
+
+                first.setLeds(index, colors, countFirst, false);
+                index = firstCount;
+                colors += countFirst;
+                count -= countFirst;
+            }
+
+            if (count > 0) {
+                rest.setLeds(index - firstCount, colors, count, false);
+            }
+
+            if (flush) {
+                updateLeds();
+            }
+        }
+
         virtual RGBW getLed(ledoffset_t index) const override {
             if (index < first.getLedCount()) {
                 return first.getLed(index);
@@ -64,11 +113,45 @@ class VirtualMultiLedStrip<Base, Rest ...> : public virtual ILedStripWithStorage
             }
         }
 
+        virtual void getLeds(ledoffset_t index, RGBW* output, ledoffset_t count) const override {
+            ledoffset_t firstCount = first.getLedCount();
+
+            if (index < firstCount) {
+                ledoffset_t countFirst = std::min<ledoffset_t>(count, firstCount - index);
+
+                first.getLeds(index, output, countFirst);
+                index = firstCount;
+                output += countFirst;
+                count -= countFirst;
+            }
+
+            if (count > 0) {
+                rest.getLeds(index - firstCount, output, count);
+            }
+        }
+
+        virtual ledoffset_t activeCount() const override {
+            return first.activeCount() + rest.activeCount();
+        }
+
+        virtual bool isAnyActive() const override {
+            return first.isAnyActive() || rest.isAnyActive();
+        }
+
         virtual void updateLeds() override {
             first.updateLeds();
             rest.updateLeds();
         }
 
+        virtual ILedStripWithStorage& resolveLed(ledoffset_t& inout_index) override {
+            if (inout_index < first.getLedCount()) {
+                return first.resolveLed(inout_index);
+            } else {
+                inout_index -= first.getLedCount();
+                return rest.resolveLed(inout_index);
+            }
+        }
+
         /**
          * \param inout_offset returns the actual offset in the affected led strip.
          * \returns the underlaying led strip which is affected by the specified offset.
@@ -112,45 +195,224 @@ class VirtualPassthroughLedStrip : public virtual ILedStripWithStorage {
             baseStrip.setLed(index, color, flush);
         }
 
+        virtual void setRange(ledoffset_t index, ledoffset_t count, RGBW color, bool flush = false) override {
+            baseStrip.setRange(index, count, color, flush);
+        }
+
+        virtual void setLeds(ledoffset_t index, const RGBW* colors, ledoffset_t count, bool flush = false) override {
+            baseStrip.setLeds(index, colors, count, flush);
+        }
+
         virtual RGBW getLed(ledoffset_t index) const override {
             return baseStrip.getLed(index);
         }
 
+        virtual void getLeds(ledoffset_t index, RGBW* output, ledoffset_t count) const override {
+            baseStrip.getLeds(index, output, count);
+        }
+
+        virtual ledoffset_t activeCount() const override {
+            return baseStrip.activeCount();
+        }
+
+        virtual bool isAnyActive() const override {
+            return baseStrip.isAnyActive();
+        }
+
         virtual void updateLeds() override {
             baseStrip.updateLeds();
         }
+
+        virtual ILedStripWithStorage& resolveLed(ledoffset_t& inout_index) override {
+            return baseStrip.resolveLed(inout_index);
+        }
 };
 
 /**
 * Maps a subset of leds of the given base strip.
 * Allows to specify the individual indices.
+*
+* Regular mappings (ranges, reversed ranges, every n-th led) are detected and stored
+* as runs of (baseIndex, count, stride), only irregular mappings keep the full index list.
 */
 class VirtualMappedLedStrip : public VirtualPassthroughLedStrip {
     private:
+        struct Run {
+            ledoffset_t offset;     // Offset of the first led in this (virtual) strip
+            ledoffset_t baseIndex;  // Index of the first led in the base strip
+            ledoffset_t count;
+            int8_t stride;
+        };
+
+        ledoffset_t ledCount;
+        std::vector<Run> runs;
         std::vector<ledoffset_t> indices;
 
+        void compress() {
+            for (ledoffset_t i = 0; i < ledCount; ++i) {
+                AppendLedIndexRun(runs, i, indices[i]);
+            }
+
+            if (runs.size() * sizeof(Run) < indices.size() * sizeof(ledoffset_t)) {
+                indices.clear();
+                indices.shrink_to_fit();
+            } else {
+                runs.clear();
+            }
+
+            runs.shrink_to_fit();
+        }
+
+        ledoffset_t mapIndex(ledoffset_t index) const {
+            if (!indices.empty()) {
+                return indices[index];
+            }
+
+            const Run& run = FindLedIndexRun(runs, index);
+            return run.baseIndex + (index - run.offset) * run.stride;
+        }
+
+        /**
+         * Calls func(run, first, count) for each run (part) within the given range.
+         * first is relative to the run.
+         */
+        template<typename Func>
+        void forEachRun(ledoffset_t index, ledoffset_t count, Func func) const {
+            if (count == 0) {
+                return;
+            }
+
+            ledoffset_t end = index + count;
+
+            for (auto iter = &FindLedIndexRun(runs, index); iter != runs.data() + runs.size() && iter->offset < end; ++iter) {
+                ledoffset_t first = std::max(index, iter->offset) - iter->offset;
+                ledoffset_t last = std::min<ledoffset_t>(end, iter->offset + iter->count) - iter->offset;
+
+                func(*iter, first, ledoffset_t(last - first));
+            }
+        }
+
     public:
         typedef std::iterator<std::forward_iterator_tag, ledoffset_t> iterator;
 
         VirtualMappedLedStrip(ILedStripWithStorage& baseStrip, const std::vector<ledoffset_t>& indices) :
             VirtualPassthroughLedStrip(baseStrip),
-            indices(indices) {}
+            ledCount(indices.size()),
+            runs(),
+            indices(indices) {
+
+            compress();
+        }
 
         template<typename Iterator>
         VirtualMappedLedStrip(ILedStripWithStorage& baseStrip, Iterator iteratorBegin, Iterator iteratorEnd) :
             VirtualPassthroughLedStrip(baseStrip),
-            indices(iteratorBegin, iteratorEnd) {}
+            ledCount(0),
+            runs(),
+            indices(iteratorBegin, iteratorEnd) {
+
+            ledCount = indices.size();
+            compress();
+        }
+
+        /// \returns the number of runs the mapping is stored as, 0 when stored as index list.
+        size_t getRunCount() const {
+            return runs.size();
+        }
 
         virtual ledoffset_t getLedCount() const override {
-            return indices.size();
+            return ledCount;
         }
 
         virtual void setLed(ledoffset_t index, RGBW color, bool flush = false) override {
-            baseStrip.setLed(indices[index], color, flush);
+            baseStrip.setLed(mapIndex(index), color, flush);
+        }
+
+        virtual void setRange(ledoffset_t index, ledoffset_t count, RGBW color, bool flush = false) override {
+            if (!indices.empty()) {
+                ILedStripWithStorage::setRange(index, count, color, flush);
+                return;
+            }
+
+            forEachRun(index, count, [&](const Run& run, ledoffset_t first, ledoffset_t runCount) {
+                ledoffset_t start = run.baseIndex + first * run.stride;
+
+                if (run.stride == 1) {
+                    baseStrip.setRange(start, runCount, color, false);
+                } else if (run.stride == -1) {
+                    baseStrip.setRange(start + 1 - runCount, runCount, color, false);
+                } else {
+                    for (ledoffset_t i = 0; i < runCount; ++i) {
+                        baseStrip.setLed(start + i * run.stride, color, false);
+                    }
+                }
+            });
+
+            if (flush) {
+                updateLeds();
+            }
+        }
+
+        virtual void setLeds(ledoffset_t index, const RGBW* colors, ledoffset_t count, bool flush = false) override {
+            if (!indices.empty()) {
+                ILedStripWithStorage::setLeds(index, colors, count, flush);
+                return;
+            }
+
+            forEachRun(index, count, [&](const Run& run, ledoffset_t first, ledoffset_t runCount) {
+                ledoffset_t start = run.baseIndex + first * run.stride;
+                const RGBW* runColors = colors + (run.offset + first - index);
+
+                if (run.stride == 1) {
+                    baseStrip.setLeds(start, runColors, runCount, false);
+                } else {
+                    for (ledoffset_t i = 0; i < runCount; ++i) {
+                        baseStrip.setLed(start + i * run.stride, runColors[i], false);
+                    }
+                }
+            });
+
+            if (flush) {
+                updateLeds();
+            }
         }
 
         virtual RGBW getLed(ledoffset_t index) const override {
-            return baseStrip.getLed(indices[index]);
+            return baseStrip.getLed(mapIndex(index));
+        }
+
+        /// Only a subset of the base strip, so the count of the base strip does not apply.
+        virtual ledoffset_t activeCount() const override {
+            return ILedStripWithStorage::activeCount();
+        }
+
+        virtual bool isAnyActive() const override {
+            return ILedStripWithStorage::isAnyActive();
+        }
+
+        virtual void getLeds(ledoffset_t index, RGBW* output, ledoffset_t count) const override {
+            if (!indices.empty()) {
+                ILedStripWithStorage::getLeds(index, output, count);
+                return;
+            }
+
+            forEachRun(index, count, [&](const Run& run, ledoffset_t first, ledoffset_t runCount) {
+                ledoffset_t start = run.baseIndex + first * run.stride;
+                RGBW* runOutput = output + (run.offset + first - index);
+
+                if (run.stride == 1) {
+                    baseStrip.getLeds(start, runOutput, runCount);
+                } else {
+                    for (ledoffset_t i = 0; i < runCount; ++i) {
+                        runOutput[i] = baseStrip.getLed(start + i * run.stride);
+                    }
+                }
+            });
+        }
+
+        virtual ILedStripWithStorage& resolveLed(ledoffset_t& inout_index) override {
+            inout_index = mapIndex(inout_index);
+            return baseStrip.resolveLed(inout_index);
         }
 };
 
@@ -162,6 +424,8 @@ class VirtualInversedLedStrip : public ILedStripWithStorage {
     private:
         ILedStripWithStorage& leds;
 
+        static constexpr ledoffset_t CHUNK_SIZE = 32;
+
         ledoffset_t calcOffset(ledoffset_t index) const {
             return leds.getLedCount() - 1 - index;
         }
@@ -178,11 +442,53 @@ class VirtualInversedLedStrip : public ILedStripWithStorage {
             leds.setLed(calcOffset(index), color, flush);
         }
 
+        virtual void setRange(ledoffset_t index, ledoffset_t count, RGBW color, bool flush = false) override {
+            if (count > 0) {
+                leds.setRange(calcOffset(index + count - 1), count, color, flush);
+            }
+        }
+
+        virtual void setLeds(ledoffset_t index, const RGBW* colors, ledoffset_t count, bool flush = false) override {
+            RGBW chunk[CHUNK_SIZE];
+
+            // Reverses chunk by chunk, the first chunk ends at the last led of the base range
+            for (ledoffset_t offset = 0; offset < count; offset += std::min<ledoffset_t>(CHUNK_SIZE, count - offset)) {
+                ledoffset_t chunkCount = std::min<ledoffset_t>(CHUNK_SIZE, count - offset);
+
+                std::reverse_copy(colors + offset, colors + offset + chunkCount, chunk);
+                leds.setLeds(calcOffset(index + offset + chunkCount - 1), chunk, chunkCount, false);
+            }
+
+            if (flush) {
+                updateLeds();
+            }
+        }
+
         virtual RGBW getLed(ledoffset_t index) const override {
             return leds.getLed(calcOffset(index));
         }
 
+        virtual void getLeds(ledoffset_t index, RGBW* output, ledoffset_t count) const override {
+            if (count > 0) {
+                leds.getLeds(calcOffset(index + count - 1), output, count);
+                std::reverse(output, output + count);
+            }
+        }
+
+        virtual ledoffset_t activeCount() const override {
+            return leds.activeCount();
+        }
+
+        virtual bool isAnyActive() const override {
+            return leds.isAnyActive();
+        }
+
         virtual void updateLeds() override {
             leds.updateLeds();
         }
+
+        virtual ILedStripWithStorage& resolveLed(ledoffset_t& inout_index) override {
+            inout_index = calcOffset(inout_index);
+            return leds.resolveLed(inout_index);
+        }
 };
@@ -2,6 +2,10 @@
 
 #include <ILedStripWithStorage.h>
 #include <LedBufferStorage.h>
+#include <CompactLedBufferStorage.h>
+#include <Instrumentation.h>
+
+#include <memory>
 
 struct LedPowerConsumptionInfo {
     const float ledBasePowerConsumtion_mA;
@@ -30,14 +34,38 @@ struct LedPowerConsumptionInfo {
     }
 };
 
+/**
+* Computes the brightness scale which keeps a frame within the power limit.
+* \param ledCount number of leds in the frame (for the base consumption)
+* \param sumColor sum of all r, g and b values of the frame
+* \param sumWhite sum of all w values of the frame
+* \returns the scale as 8.8 fixed point value (256 = unchanged), rounded down so the limit is never exceeded.
+*/
+inline uint16_t ComputePowerScale(const LedPowerConsumptionInfo& consumptionInfo, float powerLimit_mA, ledoffset_t ledCount, float sumColor, float sumWhite) {
+    float basePower = ledCount * consumptionInfo.ledBasePowerConsumtion_mA;
+    float channelPower = sumColor * (1.f / 255.f) * consumptionInfo.colorChannelMaxPowerConsumtion_mA
+                         + sumWhite * (1.f / 255.f) * consumptionInfo.whiteChannelMaxPowerConsumtion_mA;
+
+    if (basePower + channelPower <= powerLimit_mA) {
+        return 256;
+    }
+
+    if (basePower >= powerLimit_mA) {
+        return 0;
+    }
+
+    return uint16_t((powerLimit_mA - basePower) / channelPower * 256.f);
+}
+
 /**
 * Led strip pass-through implementation with a power consumption limit.
 * Uses the per-led specified LedPowerConsumptionInfo to compute the actual consumption
 * and reduce the brightness when necessary before updating the underlying led strip.
+* The buffered frame uses the most compact storage for the given channels (see CreateLedBufferStorage()).
 */
 class VirtualLedStripWithPowerLimit : public ILedStripWithStorage {
     private:
-        LedBufferStorage ledBuffer;
+        std::unique_ptr<ILedStripWithStorage> ledBuffer;
         ILedStripWithStorage& baseStrip;
         const LedPowerConsumptionInfo consumptionInfo;
 
@@ -54,8 +82,11 @@ class VirtualLedStripWithPowerLimit : public ILedStripWithStorage {
         }
 
     public:
-        VirtualLedStripWithPowerLimit(ILedStripWithStorage& baseStrip, LedPowerConsumptionInfo consumptionInfo, float powerLimit_mA) :
-            ledBuffer(baseStrip.getLedCount()),
+        /**
+         * \param channels channels of the leds, RGB-only leds buffer the frame with 3 bytes per led
+         */
+        VirtualLedStripWithPowerLimit(ILedStripWithStorage& baseStrip, LedPowerConsumptionInfo consumptionInfo, float powerLimit_mA, ColorChannels channels = ColorChannels(true, true, true, true)) :
+            ledBuffer(CreateLedBufferStorage(baseStrip.getLedCount(), channels)),
             baseStrip(baseStrip),
             consumptionInfo(consumptionInfo),
             powerLimit_mA(powerLimit_mA) {}
@@ -70,7 +101,7 @@ class VirtualLedStripWithPowerLimit : public ILedStripWithStorage {
         }
 
         virtual void setLed(ledoffset_t index, RGBW color, bool flush = false) override {
-            ledBuffer.setLed(index, color, flush);
+            ledBuffer->setLed(index, color, flush);
 
             if (flush) {
                 updateLeds();
@@ -78,46 +109,41 @@ class VirtualLedStripWithPowerLimit : public ILedStripWithStorage {
         }
 
         virtual RGBW getLed(ledoffset_t index) const override {
-            return ledBuffer.getLed(index);
+            return ledBuffer->getLed(index);
         }
 
-        virtual void updateLeds() override {
-            // Step 1: Apply current values (but don't send them yet!)
-            for (ledoffset_t i = 0; i < getLedCount(); ++i) {
-                baseStrip.setLed(i, ledBuffer.getLed(i), false);
-            }
+        virtual RGBW* getPixelBuffer() override {
+            return ledBuffer->getPixelBuffer();
+        }
 
-            //#define DEBUG_REDUCE_STEPS
+        virtual const RGBW* getPixels() const override {
+            return ledBuffer->getPixels();
+        }
 
-#ifdef DEBUG_REDUCE_STEPS
-            float settedConsumption = getCurrentPowerConsumption_mA(baseStrip);
-            uint32_t reduceStep = 0;
-            uint32_t t0 = millis();
-#endif
+        virtual void updateLeds() override {
+            {
+                ScopedStageTimer timer(InstrumentationStage::PowerLimit);
 
-            // Step 2: Reduce color values until power limit is meet
-            // Note: This is not the most efficient way to do this ...
-            // This loop may take several milliseconds to complete
-            while (getCurrentPowerConsumption_mA(baseStrip) > powerLimit_mA) {
+                // Step 1: Apply current values (but don't send them yet!)
                 for (ledoffset_t i = 0; i < getLedCount(); ++i) {
-                    RGBW currentColor = baseStrip.getLed(i);
-                    uint32_t currentBrightness = currentColor.getTotalBrightness();
+                    baseStrip.setLed(i, ledBuffer->getLed(i), false);
+                }
 
-                    if (currentBrightness >= 10) {
-                        baseStrip.setLed(i, currentColor.getWithTotalBrightness(currentBrightness - 10));
+                // Step 2: Reduce color values until power limit is meet
+                // Note: This is not the most efficient way to do this ...
+                // This loop may take several milliseconds to complete
+                while (getCurrentPowerConsumption_mA(baseStrip) > powerLimit_mA) {
+                    for (ledoffset_t i = 0; i < getLedCount(); ++i) {
+                        RGBW currentColor = baseStrip.getLed(i);
+                        uint32_t currentBrightness = currentColor.getTotalBrightness();
+
+                        if (currentBrightness >= 10) {
+                            baseStrip.setLed(i, currentColor.getWithTotalBrightness(currentBrightness - 10));
+                        }
                     }
                 }
-
-#ifdef DEBUG_REDUCE_STEPS
-                reduceStep++;
-#endif
             }
 
-#ifdef DEBUG_REDUCE_STEPS
-            uint32_t t1 = millis();
-            Serial.printf("Reduce steps: %u. Set from %f to %f (took %u ms)\n", reduceStep, settedConsumption, getCurrentPowerConsumption_mA(baseStrip), t1 - t0);
-#endif
-
             // Step 3: Update the actual leds
             baseStrip.updateLeds();
         }
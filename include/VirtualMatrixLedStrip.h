@@ -0,0 +1,274 @@
+#pragma once
+
+#include "ILedStripWithStorage.h"
+
+#include <vector>
+#include <memory>
+#include <limits>
+#include <algorithm>
+
+/**
+* Defines how the leds of a matrix are wired.
+*/
+enum class MatrixLayout : uint8_t {
+    RowMajor,               ///< Each row from left to right
+    ColumnMajor,            ///< Each column from top to bottom
+    RowMajorSerpentine,     ///< Even rows from left to right, odd rows from right to left
+    ColumnMajorSerpentine,  ///< Even columns from top to bottom, odd columns from bottom to top
+};
+
+/**
+* Virtual led strip which maps a 2D led matrix onto the base strip.
+* The led index of this strip is always row-major (index = y * width + x),
+* independent of the actual wiring. Created via Create(), which rejects unsupported sizes.
+*
+* Bulk operations (fillRect, blit, scrollRows) are performed line by line
+* as contiguous ranges of the base strip.
+*/
+class VirtualMatrixLedStrip : public ILedStripWithStorage {
+    private:
+        ILedStripWithStorage& baseStrip;
+        ledoffset_t width;
+        ledoffset_t height;
+        MatrixLayout layout;
+
+        std::vector<RGBW> lineBuffer;
+
+        bool isRowMajor() const {
+            return layout == MatrixLayout::RowMajor || layout == MatrixLayout::RowMajorSerpentine;
+        }
+
+        bool isSerpentine() const {
+            return layout == MatrixLayout::RowMajorSerpentine || layout == MatrixLayout::ColumnMajorSerpentine;
+        }
+
+        /// \returns the number of leds of one contiguous line (row or column) of the base strip.
+        ledoffset_t getLineLength() const {
+            return isRowMajor() ? width : height;
+        }
+
+        bool isLineReversed(ledoffset_t line) const {
+            return isSerpentine() && (line & 1);
+        }
+
+        /// \returns the offset in the base strip of the segment [first, first + count) of the line.
+        ledoffset_t getLineSegmentOffset(ledoffset_t line, ledoffset_t first, ledoffset_t count) const {
+            ledoffset_t lineLength = getLineLength();
+
+            if (isLineReversed(line)) {
+                return line * lineLength + (lineLength - first - count);
+            }
+
+            return line * lineLength + first;
+        }
+
+        /**
+         * Writes count colors to the given line starting at first.
+         * The colors are in matrix order (left to right / top to bottom).
+         */
+        void writeLine(ledoffset_t line, ledoffset_t first, ledoffset_t count, const RGBW* colors) {
+            ledoffset_t offset = getLineSegmentOffset(line, first, count);
+
+            if (isLineReversed(line)) {
+                if (colors == lineBuffer.data()) {
+                    std::reverse(lineBuffer.begin(), lineBuffer.begin() + count);
+                } else {
+                    std::reverse_copy(colors, colors + count, lineBuffer.begin());
+                }
+
+                colors = lineBuffer.data();
+            }
+
+            baseStrip.setLeds(offset, colors, count, false);
+        }
+
+        /**
+         * Reads count colors of the given line starting at first in matrix order.
+         */
+        void readLine(ledoffset_t line, ledoffset_t first, ledoffset_t count, RGBW* output) const {
+            baseStrip.getLeds(getLineSegmentOffset(line, first, count), output, count);
+
+            if (isLineReversed(line)) {
+                std::reverse(output, output + count);
+            }
+        }
+
+        void readRow(ledoffset_t y, RGBW* output) const {
+            if (isRowMajor()) {
+                readLine(y, 0, width, output);
+                return;
+            }
+
+            for (ledoffset_t x = 0; x < width; ++x) {
+                output[x] = baseStrip.getLed(getOffset(x, y));
+            }
+        }
+
+        void writeRow(ledoffset_t y, const RGBW* colors) {
+            if (isRowMajor()) {
+                writeLine(y, 0, width, colors);
+                return;
+            }
+
+            for (ledoffset_t x = 0; x < width; ++x) {
+                baseStrip.setLed(getOffset(x, y), colors[x], false);
+            }
+        }
+
+        VirtualMatrixLedStrip(ILedStripWithStorage& baseStrip, ledoffset_t width, ledoffset_t height, MatrixLayout layout) :
+            baseStrip(baseStrip),
+            width(width),
+            height(height),
+            layout(layout),
+            lineBuffer(std::max(width, height)) {}
+
+    public:
+        /**
+         * \returns true when a matrix of width * height leds fits onto the base strip.
+         * A strip holds at most 255 leds (ledoffset_t), so e.g. 16x16 or 64x64 panels are not supported.
+         */
+        static bool IsSupportedSize(const ILedStripWithStorage& baseStrip, size_t width, size_t height) {
+            const size_t count = width * height;
+
+            return width > 0 && height > 0
+                && width <= std::numeric_limits<ledoffset_t>::max() && height <= std::numeric_limits<ledoffset_t>::max()
+                && count <= std::numeric_limits<ledoffset_t>::max() && count <= baseStrip.getLedCount();
+        }
+
+        /**
+         * Creates a matrix of width * height leds on the base strip.
+         * \returns nullptr when the size is not supported, see IsSupportedSize()
+         */
+        static std::unique_ptr<VirtualMatrixLedStrip> Create(ILedStripWithStorage& baseStrip, size_t width, size_t height, MatrixLayout layout = MatrixLayout::RowMajor) {
+            if (!IsSupportedSize(baseStrip, width, height)) {
+                return nullptr;
+            }
+
+            return std::unique_ptr<VirtualMatrixLedStrip>(new VirtualMatrixLedStrip(baseStrip, ledoffset_t(width), ledoffset_t(height), layout));
+        }
+
+        ledoffset_t getWidth() const {
+            return width;
+        }
+
+        ledoffset_t getHeight() const {
+            return height;
+        }
+
+        /// \returns the offset in the base strip of the led at the given position.
+        ledoffset_t getOffset(ledoffset_t x, ledoffset_t y) const {
+            if (isRowMajor()) {
+                return y * width + (isLineReversed(y) ? width - 1 - x : x);
+            }
+
+            return x * height + (isLineReversed(x) ? height - 1 - y : y);
+        }
+
+        virtual ledoffset_t getLedCount() const override {
+            return width * height;
+        }
+
+        virtual void setLed(ledoffset_t index, RGBW color, bool flush = false) override {
+            baseStrip.setLed(getOffset(index % width, index / width), color, flush);
+        }
+
+        virtual RGBW getLed(ledoffset_t index) const override {
+            return baseStrip.getLed(getOffset(index % width, index / width));
+        }
+
+        virtual ILedStripWithStorage& resolveLed(ledoffset_t& inout_index) override {
+            inout_index = getOffset(inout_index % width, inout_index / width);
+            return baseStrip.resolveLed(inout_index);
+        }
+
+        virtual void updateLeds() override {
+            baseStrip.updateLeds();
+        }
+
+        void setPixel(ledoffset_t x, ledoffset_t y, RGBW color, bool flush = false) {
+            baseStrip.setLed(getOffset(x, y), color, flush);
+        }
+
+        RGBW getPixel(ledoffset_t x, ledoffset_t y) const {
+            return baseStrip.getLed(getOffset(x, y));
+        }
+
+        /**
+         * Fills the given rectangle with the color.
+         * The rectangle must be within the matrix.
+         */
+        void fillRect(ledoffset_t x, ledoffset_t y, ledoffset_t w, ledoffset_t h, RGBW color, bool flush = false) {
+            if (isRowMajor()) {
+                for (ledoffset_t row = y; row < y + h; ++row) {
+                    baseStrip.setRange(getLineSegmentOffset(row, x, w), w, color, false);
+                }
+            } else {
+                for (ledoffset_t column = x; column < x + w; ++column) {
+                    baseStrip.setRange(getLineSegmentOffset(column, y, h), h, color, false);
+                }
+            }
+
+            if (flush) {
+                updateLeds();
+            }
+        }
+
+        /**
+         * Copies a w * h sized block of a row-major frame buffer to the position (x, y).
+         * \param frame pointer to the first pixel of the block
+         * \param frameStride distance between two rows in the frame buffer, in pixels
+         */
+        void blit(const RGBW* frame, size_t frameStride, ledoffset_t x, ledoffset_t y, ledoffset_t w, ledoffset_t h, bool flush = false) {
+            if (isRowMajor()) {
+                for (ledoffset_t row = 0; row < h; ++row) {
+                    writeLine(y + row, x, w, frame + row * frameStride);
+                }
+            } else {
+                for (ledoffset_t column = 0; column < w; ++column) {
+                    for (ledoffset_t row = 0; row < h; ++row) {
+                        lineBuffer[row] = frame[row * frameStride + column];
+                    }
+
+                    writeLine(x + column, y, h, lineBuffer.data());
+                }
+            }
+
+            if (flush) {
+                updateLeds();
+            }
+        }
+
+        /**
+         * Copies the whole matrix from a row-major frame buffer of width * height pixels.
+         */
+        void blit(const RGBW* frame, bool flush = false) {
+            blit(frame, width, 0, 0, width, height, flush);
+        }
+
+        /**
+         * Shifts the content by the given number of rows.
+         * Positive values move the content down, negative values up.
+         * Rows which become free are filled with fillColor.
+         */
+        void scrollRows(int16_t rows, RGBW fillColor = COLOR_OFF, bool flush = false) {
+            RGBW* row = lineBuffer.data();
+
+            for (ledoffset_t i = 0; i < height; ++i) {
+                // Iterate against the scroll direction so no source row is overwritten before it is read
+                ledoffset_t y = rows > 0 ? height - 1 - i : i;
+                int16_t sourceY = int16_t(y) - rows;
+
+                if (sourceY >= 0 && sourceY < height) {
+                    readRow(sourceY, row);
+                } else {
+                    std::fill_n(row, width, fillColor);
+                }
+
+                writeRow(y, row);
+            }
+
+            if (flush) {
+                updateLeds();
+            }
+        }
+};
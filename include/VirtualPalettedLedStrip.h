@@ -0,0 +1,99 @@
+#pragma once
+
+#include "CompactLedBufferStorage.h"
+#include "AnimationManager.h"
+#include "Instrumentation.h"
+
+/**
+* Palette-indexed frame in front of a led strip.
+* Stores a palette index per led and expands the frame to RGBW in one batched pass into the
+* base strip on updateLeds() (directly into its pixel buffer, when available).
+*
+* Animating the palette (see PaletteFadeAnimation) recolors all leds using an entry,
+* so the animation work scales with the palette size instead of the led count.
+*/
+template<uint8_t Bits = 8>
+class VirtualPalettedLedStrip : public PalettedLedBufferStorage<Bits> {
+    private:
+        ILedStripWithStorage& baseStrip;
+
+        static constexpr ledoffset_t CHUNK_SIZE = 32;
+
+    public:
+        VirtualPalettedLedStrip(ILedStripWithStorage& baseStrip, LedPalette& palette) :
+            PalettedLedBufferStorage<Bits>(baseStrip.getLedCount(), palette),
+            baseStrip(baseStrip) {}
+
+        ILedStripWithStorage& getBaseStrip() const {
+            return baseStrip;
+        }
+
+        /**
+         * Expands the palette indices into the base strip and updates it.
+         */
+        virtual void updateLeds() override {
+            {
+                ScopedStageTimer timer(InstrumentationStage::Compositing);
+
+                const LedPalette& palette = this->getPalette();
+                const ledoffset_t count = this->getLedCount();
+
+                // Resolve the palette once per frame
+                RGBW colors[size_t(1) << Bits];
+
+                for (size_t i = 0; i < (size_t(1) << Bits); ++i) {
+                    colors[i] = palette.getColor(i);
+                }
+
+                RGBW* pixels = baseStrip.getPixelBuffer();
+
+                if (pixels) {
+                    for (ledoffset_t i = 0; i < count; ++i) {
+                        pixels[i] = colors[this->getIndex(i)];
+                    }
+                } else {
+                    RGBW chunk[CHUNK_SIZE];
+
+                    for (ledoffset_t offset = 0; offset < count; offset += std::min<ledoffset_t>(CHUNK_SIZE, count - offset)) {
+                        ledoffset_t chunkCount = std::min<ledoffset_t>(CHUNK_SIZE, count - offset);
+
+                        for (ledoffset_t i = 0; i < chunkCount; ++i) {
+                            chunk[i] = colors[this->getIndex(offset + i)];
+                        }
+
+                        baseStrip.setLeds(offset, chunk, chunkCount, false);
+                    }
+                }
+            }
+
+            baseStrip.updateLeds();
+        }
+};
+
+/**
+* Fades one palette entry from the start to the end color.
+* All leds of the led strip using the entry change their color.
+* Note: The entry must already exist in the palette.
+*/
+class PaletteFadeAnimation : public ALedAnimation {
+    private:
+        LedPalette& palette;
+        uint8_t paletteIndex;
+        RGBW startColor;
+        RGBW endColor;
+
+    public:
+        /**
+         * \param ledControl the led strip using the palette (usually a VirtualPalettedLedStrip), updated after each step
+         */
+        PaletteFadeAnimation(uint32_t startTime, uint32_t duration, ILedStripWithStorage& ledControl, LedPalette& palette, uint8_t paletteIndex, RGBW startColor, RGBW endColor) :
+            ALedAnimation(startTime, duration, ledControl),
+            palette(palette),
+            paletteIndex(paletteIndex),
+            startColor(startColor),
+            endColor(endColor) {}
+
+        virtual void update(uint32_t currentTime) override {
+            palette.setColor(paletteIndex, startColor.interpolateTo(endColor, getFactor(currentTime)));
+        }
+};
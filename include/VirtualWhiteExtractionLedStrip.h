@@ -0,0 +1,69 @@
+#pragma once
+
+#include "LedBufferStorage.h"
+#include "ColorKernels.h"
+#include "Instrumentation.h"
+
+/**
+* Led strip stage which drives RGB content on RGBW leds.
+* Stores the frame and on updateLeds() moves the white part of each led into the W channel
+* (see ExtractWhite()) in one batched pass, directly into the pixel buffer of the base strip when available.
+*
+* Place it in front of VirtualLedStripWithPowerLimit, so the limit is computed for the extracted frame:
+* One white channel draws less current than three color channels, which leaves more brightness
+* within the same power budget.
+*/
+class VirtualWhiteExtractionLedStrip : public LedBufferStorage {
+    private:
+        ILedStripWithStorage& baseStrip;
+        WhitePoint whitePoint;
+
+        static constexpr ledoffset_t CHUNK_SIZE = 32;
+
+    public:
+        VirtualWhiteExtractionLedStrip(ILedStripWithStorage& baseStrip, const WhitePoint& whitePoint = WhitePoint()) :
+            LedBufferStorage(baseStrip.getLedCount()),
+            baseStrip(baseStrip),
+            whitePoint(whitePoint) {}
+
+        ILedStripWithStorage& getBaseStrip() const {
+            return baseStrip;
+        }
+
+        void setWhitePoint(const WhitePoint& whitePoint) {
+            this->whitePoint = whitePoint;
+        }
+
+        const WhitePoint& getWhitePoint() const {
+            return whitePoint;
+        }
+
+        virtual void updateLeds() override {
+            refreshActiveCount();
+
+            {
+                ScopedStageTimer timer(InstrumentationStage::Compositing);
+
+                const RGBW* pixels = getPixels();
+                const ledoffset_t count = getLedCount();
+                RGBW* output = baseStrip.getPixelBuffer();
+
+                if (output) {
+                    std::copy_n(pixels, count, output);
+                    ExtractWhite(output, count, whitePoint);
+                } else {
+                    RGBW chunk[CHUNK_SIZE];
+
+                    for (ledoffset_t offset = 0; offset < count; offset += std::min<ledoffset_t>(CHUNK_SIZE, count - offset)) {
+                        ledoffset_t chunkCount = std::min<ledoffset_t>(CHUNK_SIZE, count - offset);
+
+                        std::copy_n(pixels + offset, chunkCount, chunk);
+                        ExtractWhite(chunk, chunkCount, whitePoint);
+                        baseStrip.setLeds(offset, chunk, chunkCount, false);
+                    }
+                }
+            }
+
+            baseStrip.updateLeds();
+        }
+};
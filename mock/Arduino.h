@@ -0,0 +1,29 @@
+#pragma once
+
+/**
+* Minimal stand-in for the Arduino core on native builds (tests and benchmarks).
+* Time is taken from std::chrono::steady_clock, GPIO functions do nothing.
+*/
+
+#include <stdint.h>
+#include <math.h>
+#include <chrono>
+
+#define LOW 0x0
+#define HIGH 0x1
+
+#define INPUT 0x01
+#define OUTPUT 0x03
+
+inline void pinMode(uint16_t, uint8_t) {}
+inline void digitalWrite(uint16_t, uint8_t) {}
+
+inline uint32_t micros() {
+    static const auto start = std::chrono::steady_clock::now();
+    return uint32_t(std::chrono::duration_cast<std::chrono::microseconds>(std::chrono::steady_clock::now() - start).count());
+}
+
+inline uint32_t millis() {
+    static const auto start = std::chrono::steady_clock::now();
+    return uint32_t(std::chrono::duration_cast<std::chrono::milliseconds>(std::chrono::steady_clock::now() - start).count());
+}
@@ -0,0 +1,101 @@
+#include <unity.h>
+#include "AnimationManager.h"
+#include "AnimationClock.h"
+#include "LedBufferStorage.h"
+
+static void test_millis_wrap_around() {
+    LedBufferStorage strip(2);
+    AnimationManager animationManager;
+
+    TEST_ASSERT_TRUE(TimeBefore(UINT32_MAX - 10, 5));
+    TEST_ASSERT_TRUE(TimeReached(5, UINT32_MAX - 10));
+
+    animationManager.addAnimation(new FadeAnimation(UINT32_MAX - 49, 100, strip, 0, COLOR_OFF, COLOR_RED));
+    animationManager.addAnimation(new FadeAnimation(UINT32_MAX - 49, AAnimation::DURATION_INFINITE, strip, 1, COLOR_OFF, COLOR_RED));
+
+    animationManager.update(UINT32_MAX - 100);
+    TEST_ASSERT_TRUE(strip.getLed(0) == COLOR_OFF);
+
+    // Half way, after millis() wrapped
+    animationManager.update(0);
+    TEST_ASSERT_INT_WITHIN(1, 127, strip.getLed(0).r);
+
+    animationManager.update(60);
+    TEST_ASSERT_TRUE(strip.getLed(0) == COLOR_RED);
+    animationManager.update(61);
+    TEST_ASSERT_FALSE(animationManager.empty());
+
+    // The infinite animation stays active, even beyond the range of the wrap-safe comparison
+    animationManager.update(0x90000000);
+    animationManager.update(UINT32_MAX - 60);
+    TEST_ASSERT_FALSE(animationManager.empty());
+}
+
+static void test_manual_clock_frames() {
+    LedBufferStorage strip(1);
+    AnimationManager animationManager;
+    ManualAnimationClock clock;
+
+    animationManager.setClock(&clock);
+    animationManager.addAnimation(new FadeAnimation(0, 10, strip, 0, COLOR_OFF, COLOR_RED));
+
+    // 240 fps, each frame is 4166.67 us long, so the factor changes within a millisecond
+    clock.advanceFrames(1, 240);
+    animationManager.update();
+    TEST_ASSERT_INT_WITHIN(1, 106, strip.getLed(0).r);
+
+    clock.advanceFrames(1, 240);
+    animationManager.update();
+    TEST_ASSERT_EQUAL(8333, clock.nowMicros());
+    TEST_ASSERT_INT_WITHIN(1, 212, strip.getLed(0).r);
+
+    // No drift over many frames
+    clock.advanceFrames(238, 240);
+    TEST_ASSERT_EQUAL(1000000, clock.nowMicros());
+
+    animationManager.update();
+    TEST_ASSERT_TRUE(strip.getLed(0) == COLOR_RED);
+    TEST_ASSERT_TRUE(animationManager.empty());
+}
+
+static void test_arduino_clock_start() {
+    // Without wrap around, micros() is taken as it is
+    TEST_ASSERT_TRUE(ArduinoAnimationClock::ExtendMicros(123456, 123) == 123456);
+    TEST_ASSERT_TRUE(ArduinoAnimationClock::ExtendMicros(123456, 124) == 123456);
+
+    // 5000 seconds after boot micros() wrapped once, millis() was read 1 ms earlier or later
+    const uint64_t time = 5000000000ull;
+    TEST_ASSERT_TRUE(ArduinoAnimationClock::ExtendMicros(uint32_t(time), 5000000) == time);
+    TEST_ASSERT_TRUE(ArduinoAnimationClock::ExtendMicros(uint32_t(time), 4999999) == time);
+    TEST_ASSERT_TRUE(ArduinoAnimationClock::ExtendMicros(uint32_t(time), 5000001) == time);
+
+    // Right after a wrap around of micros(), millis() still before it
+    TEST_ASSERT_TRUE(ArduinoAnimationClock::ExtendMicros(10, 4294967) == (uint64_t(1) << 32) + 10);
+
+    ArduinoAnimationClock clock;
+    uint64_t now = clock.nowMicros();
+    TEST_ASSERT_TRUE(now / 1000 <= millis() + 5);
+}
+
+static void test_blink_phase() {
+    LedBufferStorage strip(1);
+    BlinkAnimation animation(1000, 2, strip, 0, COLOR_BLUE);
+
+    animation.update(1000);
+    TEST_ASSERT_TRUE(strip.getLed(0) == COLOR_BLUE);
+
+    animation.update(1200);
+    TEST_ASSERT_TRUE(strip.getLed(0) == COLOR_OFF);
+
+    animation.update(1400);
+    TEST_ASSERT_TRUE(strip.getLed(0) == COLOR_BLUE);
+}
+
+int main() {
+    UNITY_BEGIN();
+    RUN_TEST(test_millis_wrap_around);
+    RUN_TEST(test_manual_clock_frames);
+    RUN_TEST(test_arduino_clock_start);
+    RUN_TEST(test_blink_phase);
+    return UNITY_END();
+}
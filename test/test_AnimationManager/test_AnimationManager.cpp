@@ -0,0 +1,294 @@
+#include <unity.h>
+#include "AnimationManager.h"
+#include "AnimationWorkerPool.h"
+#include "LedBufferStorage.h"
+#include "VirtualLedStrip.h"
+
+#include <atomic>
+#include <thread>
+#include <vector>
+
+// Affects the whole strip, forces its group into a single partition
+class FillAnimation : public ALedAnimation {
+    private:
+        RGBW color;
+
+    public:
+        FillAnimation(uint32_t startTime, uint32_t duration, ILedStripWithStorage& ledControl, RGBW color) :
+            ALedAnimation(startTime, duration, ledControl),
+            color(color) {}
+
+        virtual void update(uint32_t currentTime) override {
+            (void)currentTime;
+            ledControl.setRange(0, ledControl.getLedCount(), color);
+        }
+};
+
+// Sets a single led, splittable by led ranges
+class SetLedAnimation : public ALedAnimation {
+    private:
+        RGBW color;
+        ledoffset_t ledIndex;
+
+    public:
+        SetLedAnimation(uint32_t startTime, uint32_t duration, ILedStripWithStorage& ledControl, ledoffset_t ledIndex, RGBW color) :
+            ALedAnimation(startTime, duration, ledControl),
+            color(color),
+            ledIndex(ledIndex) {}
+
+        virtual void update(uint32_t currentTime) override {
+            (void)currentTime;
+            ledControl.setLed(ledIndex, color);
+        }
+
+        virtual bool getAffectedLed(ledoffset_t& out_index) const override {
+            out_index = ledIndex;
+            return true;
+        }
+};
+
+// Counts its updates, finishes after the first one
+class CountingAnimation : public ALedAnimation {
+    private:
+        std::vector<int>& counts;
+        size_t id;
+
+    public:
+        CountingAnimation(ILedStripWithStorage& ledControl, std::vector<int>& counts, size_t id) :
+            ALedAnimation(0, 0, ledControl),
+            counts(counts),
+            id(id) {}
+
+        virtual void update(uint32_t currentTime) override {
+            (void)currentTime;
+            counts[id]++;
+        }
+};
+
+// Shares state between its leds, so they must not be written concurrently
+class SharedStateLedStrip : public LedBufferStorage {
+    private:
+        std::atomic<int> countWriters;
+
+    public:
+        std::atomic<bool> overlapped;
+
+        SharedStateLedStrip(ledoffset_t ledCount) :
+            LedBufferStorage(ledCount),
+            countWriters(0),
+            overlapped(false) {}
+
+        virtual void setLed(ledoffset_t index, RGBW color, bool flush = false) override {
+            if (countWriters.fetch_add(1) != 0) {
+                overlapped = true;
+            }
+
+            std::this_thread::yield();
+            LedBufferStorage::setLed(index, color, flush);
+            countWriters--;
+        }
+
+        virtual bool supportsConcurrentWrites() const override {
+            return false;
+        }
+};
+
+/**
+ * Same animations on two identical strip setups, one managed serially, one in parallel.
+ * The mapped strip maps two virtual leds to each physical led.
+ */
+struct Setup {
+    LedBufferStorage base;
+    LedBufferStorage other;
+    VirtualMappedLedStrip mapped;
+    AnimationManager animationManager;
+
+    Setup(const std::vector<ledoffset_t>& indices) :
+        base(64),
+        other(32),
+        mapped(base, indices),
+        animationManager() {}
+
+    void addAnimations() {
+        for (ledoffset_t i = 0; i < mapped.getLedCount(); ++i) {
+            RGBW color(uint8_t(i * 2), uint8_t(255 - i), uint8_t(i * 7), uint8_t(i));
+
+            animationManager.addAnimation(new FadeAnimation(i % 5, 40 + i % 13, mapped, i, COLOR_OFF, color));
+            animationManager.addAnimation(new FadeAnimation(i % 3, 20 + i % 7, other, i % 32, color, COLOR_OFF));
+        }
+    }
+};
+
+static std::vector<ledoffset_t> CreateDuplicateIndices() {
+    std::vector<ledoffset_t> indices;
+
+    for (ledoffset_t i = 0; i < 128; ++i) {
+        indices.push_back(i / 2);
+    }
+
+    return indices;
+}
+
+static void AssertSameLeds(ILedStripWithStorage& expected, ILedStripWithStorage& actual) {
+    for (ledoffset_t i = 0; i < expected.getLedCount(); ++i) {
+        TEST_ASSERT_TRUE(expected.getLed(i) == actual.getLed(i));
+    }
+}
+
+static void test_parallel_matches_serial() {
+    std::vector<ledoffset_t> indices = CreateDuplicateIndices();
+    AnimationWorkerPool pool(3);
+    Setup serial(indices);
+    Setup parallel(indices);
+
+    parallel.animationManager.setWorkerPool(&pool, 1);
+    serial.addAnimations();
+    parallel.addAnimations();
+
+    for (uint32_t time = 0; time <= 80; time += 3) {
+        serial.animationManager.update(time);
+        parallel.animationManager.update(time);
+
+        AssertSameLeds(serial.base, parallel.base);
+        AssertSameLeds(serial.other, parallel.other);
+    }
+
+    TEST_ASSERT_TRUE(serial.animationManager.empty());
+    TEST_ASSERT_TRUE(parallel.animationManager.empty());
+}
+
+static void test_parallel_keeps_queue_order() {
+    AnimationWorkerPool pool(4);
+    LedBufferStorage strip(16);
+    AnimationManager animationManager;
+
+    animationManager.setWorkerPool(&pool, 1);
+
+    // Later animations in the queue win, also across the whole strip animation
+    animationManager.addAnimation(new SetLedAnimation(0, 10, strip, 3, COLOR_RED));
+    animationManager.addAnimation(new FillAnimation(0, 10, strip, COLOR_GREEN));
+    animationManager.addAnimation(new SetLedAnimation(0, 10, strip, 5, COLOR_BLUE));
+    animationManager.addAnimation(new SetLedAnimation(0, 10, strip, 5, COLOR_RED));
+
+    animationManager.update(5);
+
+    TEST_ASSERT_TRUE(strip.getLed(3) == COLOR_GREEN);
+    TEST_ASSERT_TRUE(strip.getLed(4) == COLOR_GREEN);
+    TEST_ASSERT_TRUE(strip.getLed(5) == COLOR_RED);
+
+    // Single led animations only, split across the partitions
+    animationManager.clear();
+
+    for (ledoffset_t i = 0; i < 16; ++i) {
+        animationManager.addAnimation(new SetLedAnimation(0, 10, strip, i, COLOR_BLUE));
+        animationManager.addAnimation(new SetLedAnimation(0, 10, strip, 15 - i, COLOR_NWHITE));
+    }
+
+    animationManager.addAnimation(new SetLedAnimation(0, 10, strip, 7, COLOR_RED));
+    animationManager.update(6);
+
+    for (ledoffset_t i = 0; i < 16; ++i) {
+        TEST_ASSERT_TRUE(strip.getLed(i) == (i == 7 ? COLOR_RED : i < 8 ? COLOR_NWHITE : COLOR_BLUE));
+    }
+}
+
+static void test_parallel_without_concurrent_writes() {
+    AnimationWorkerPool pool(4);
+    SharedStateLedStrip strip(128);
+    LedBufferStorage other(128);
+    AnimationManager animationManager;
+
+    animationManager.setWorkerPool(&pool, 1);
+
+    for (uint32_t time = 0; time < 10; ++time) {
+        for (ledoffset_t i = 0; i < strip.getLedCount(); ++i) {
+            animationManager.addAnimation(new SetLedAnimation(time, 0, strip, i, RGBW(uint8_t(i + time), 0, 0, 0)));
+            animationManager.addAnimation(new SetLedAnimation(time, 0, other, i, COLOR_RED));
+        }
+
+        animationManager.update(time);
+
+        for (ledoffset_t i = 0; i < strip.getLedCount(); ++i) {
+            TEST_ASSERT_EQUAL(uint8_t(i + time), strip.getLed(i).r);
+        }
+    }
+
+    // The strip is kept in a single partition, the other one is split
+    TEST_ASSERT_FALSE(strip.overlapped);
+}
+
+static void test_parallel_active_count() {
+    AnimationWorkerPool pool(4);
+    LedBufferStorage strip(200);
+    AnimationManager animationManager;
+
+    animationManager.setWorkerPool(&pool, 1);
+
+    // Each update switches other leds on and off, from all partitions at the same time
+    for (uint32_t time = 0; time < 20; ++time) {
+        for (ledoffset_t i = 0; i < strip.getLedCount(); ++i) {
+            bool on = (i * 7 + time * 3) % 5 < 2;
+            animationManager.addAnimation(new SetLedAnimation(time, 0, strip, i, on ? COLOR_RED : COLOR_OFF));
+        }
+
+        animationManager.update(time);
+
+        ledoffset_t expected = 0;
+        for (ledoffset_t i = 0; i < strip.getLedCount(); ++i) {
+            expected += strip.getLed(i) != COLOR_OFF;
+        }
+
+        TEST_ASSERT_EQUAL(expected, strip.activeCount());
+    }
+
+    animationManager.update(20);
+    TEST_ASSERT_TRUE(animationManager.empty());
+}
+
+static void test_submit_from_multiple_threads() {
+    const size_t countProducers = 4;
+    const size_t countAnimations = 2000;
+    LedBufferStorage strip(1);
+    AnimationManager animationManager(16);
+    std::vector<int> counts(countProducers * countAnimations, 0);
+    std::vector<std::thread> producers;
+    std::atomic<size_t> countDone(0);
+
+    for (size_t producer = 0; producer < countProducers; ++producer) {
+        producers.emplace_back([&, producer]() {
+            for (size_t i = 0; i < countAnimations; ++i) {
+                CountingAnimation* animation = new CountingAnimation(strip, counts, producer * countAnimations + i);
+
+                // The submit queue is much smaller than the number of animations
+                while (!animationManager.submitAnimation(animation)) {
+                    std::this_thread::yield();
+                }
+            }
+
+            countDone++;
+        });
+    }
+
+    while (countDone < countProducers || !animationManager.empty()) {
+        animationManager.update(1);
+    }
+
+    for (std::thread& thread : producers) {
+        thread.join();
+    }
+
+    // Each submitted animation was added and updated exactly once before it finished
+    for (int count : counts) {
+        TEST_ASSERT_EQUAL(1, count);
+    }
+}
+
+int main() {
+    UNITY_BEGIN();
+    RUN_TEST(test_parallel_matches_serial);
+    RUN_TEST(test_parallel_keeps_queue_order);
+    RUN_TEST(test_parallel_without_concurrent_writes);
+    RUN_TEST(test_parallel_active_count);
+    RUN_TEST(test_submit_from_multiple_threads);
+    return UNITY_END();
+}
@@ -0,0 +1,123 @@
+#include <unity.h>
+#include "AudioAnalyzer.h"
+#include "LedBufferStorage.h"
+
+#include <vector>
+
+static void FillSine(std::vector<int16_t>& samples, float frequency, float amplitude, uint32_t sampleRate) {
+    for (size_t i = 0; i < samples.size(); ++i) {
+        samples[i] = int16_t(amplitude * sinf(2.f * 3.14159265f * frequency * i / sampleRate));
+    }
+}
+
+static void test_sine_band_levels() {
+    AudioAnalyzer analyzer(44100);
+    std::vector<int16_t> samples(4096);
+
+    // Silence
+    analyzer.pushSamples(samples.data(), samples.size());
+    TEST_ASSERT_EQUAL(4096 / AudioAnalyzer::HOP_SIZE, analyzer.getAnalysisCount());
+    TEST_ASSERT_EQUAL(0, analyzer.getVolume());
+
+    FillSine(samples, 1000.f, 8000.f, 44100);
+    analyzer.pushSamples(samples.data(), samples.size());
+
+    uint8_t levels[AudioAnalyzer::BAND_COUNT];
+    analyzer.getLevels(levels);
+
+    uint8_t peakBand = std::max_element(levels, levels + AudioAnalyzer::BAND_COUNT) - levels;
+    float peakFrequency = analyzer.getBandFrequency(peakBand);
+
+    TEST_ASSERT_TRUE(peakFrequency > 700.f && peakFrequency < 1400.f);
+    TEST_ASSERT_GREATER_THAN(150, levels[peakBand]);
+    TEST_ASSERT_EQUAL(0, levels[AudioAnalyzer::BAND_COUNT - 1]);
+    TEST_ASSERT_EQUAL(0, analyzer.getBeatCount());
+
+    // The spectrum effect reads the levels, one led per band
+    LedBufferStorage strip(AudioAnalyzer::BAND_COUNT);
+    AudioSpectrumEffect effect(0, 0, strip, analyzer);
+
+    effect.update(0);
+    TEST_ASSERT_TRUE(strip.getLed(peakBand) != COLOR_OFF);
+    TEST_ASSERT_TRUE(strip.getLed(AudioAnalyzer::BAND_COUNT - 1) == COLOR_OFF);
+}
+
+static void test_beat_detection() {
+    AudioAnalyzer analyzer(44100);
+    std::vector<int16_t> samples(44100 * 4);
+
+    // 60 Hz bursts of 50 ms, twice per second
+    for (size_t i = 0; i < samples.size(); ++i) {
+        if (i % 22050 < 2205) {
+            samples[i] = int16_t(16000.f * sinf(2.f * 3.14159265f * 60.f * i / 44100));
+        }
+    }
+
+    // Pushed in I2S like blocks
+    for (size_t offset = 0; offset < samples.size(); offset += 128) {
+        analyzer.pushSamples(samples.data() + offset, std::min<size_t>(128, samples.size() - offset));
+    }
+
+    // The first beats are used to learn the average
+    TEST_ASSERT_INT_WITHIN(1, 6, analyzer.getBeatCount());
+}
+
+static void test_wav_parsing() {
+    const uint16_t channels = 2;
+    const uint32_t frames = 2048;
+    std::vector<uint8_t> wav;
+
+    auto writeU16 = [&](uint16_t value) {
+        wav.push_back(value & 0xFF);
+        wav.push_back(value >> 8);
+    };
+    auto writeU32 = [&](uint32_t value) {
+        writeU16(value & 0xFFFF);
+        writeU16(value >> 16);
+    };
+    auto writeTag = [&](const char* tag) {
+        wav.insert(wav.end(), tag, tag + 4);
+    };
+
+    writeTag("RIFF");
+    writeU32(36 + frames * channels * 2);
+    writeTag("WAVE");
+    writeTag("fmt ");
+    writeU32(16);
+    writeU16(1);
+    writeU16(channels);
+    writeU32(22050);
+    writeU32(22050 * channels * 2);
+    writeU16(channels * 2);
+    writeU16(16);
+    writeTag("data");
+    writeU32(frames * channels * 2);
+
+    for (uint32_t i = 0; i < frames * channels; ++i) {
+        writeU16(uint16_t(int16_t(i % 200) - 100));
+    }
+
+    WavInfo info;
+    TEST_ASSERT_TRUE(ParseWav(wav.data(), wav.size(), info));
+    TEST_ASSERT_EQUAL(22050, info.sampleRate);
+    TEST_ASSERT_EQUAL(2, info.channels);
+    TEST_ASSERT_EQUAL(frames, info.frameCount);
+
+    AudioAnalyzer analyzer(info.sampleRate);
+    TEST_ASSERT_EQUAL(1000, analyzer.pushWav(info, 0, 1000));
+    TEST_ASSERT_EQUAL(frames - 1000, analyzer.pushWav(info, 1000, frames));
+    TEST_ASSERT_EQUAL(frames / AudioAnalyzer::HOP_SIZE, analyzer.getAnalysisCount());
+
+    // 8 bit samples are not supported
+    wav[34] = 8;
+    TEST_ASSERT_FALSE(ParseWav(wav.data(), wav.size(), info));
+    TEST_ASSERT_FALSE(ParseWav(wav.data(), 20, info));
+}
+
+int main() {
+    UNITY_BEGIN();
+    RUN_TEST(test_sine_band_levels);
+    RUN_TEST(test_beat_detection);
+    RUN_TEST(test_wav_parsing);
+    return UNITY_END();
+}
@@ -0,0 +1,102 @@
+#include <unity.h>
+#include "CompactLedBufferStorage.h"
+#include "VirtualPalettedLedStrip.h"
+#include "VirtualLedStripWithPowerLimit.h"
+
+static void test_rgb_storage() {
+    RGBLedBufferStorage strip(5);
+
+    strip.setLed(0, RGBW(1, 2, 3, 4));
+    strip.setRange(2, 3, COLOR_RED);
+
+    TEST_ASSERT_EQUAL(5, strip.getLedCount());
+    TEST_ASSERT_TRUE(strip.getLed(0) == RGBW(1, 2, 3, 0));
+    TEST_ASSERT_TRUE(strip.getLed(1) == COLOR_OFF);
+    TEST_ASSERT_TRUE(strip.getLed(4) == COLOR_RED);
+    TEST_ASSERT_NULL(strip.getPixelBuffer());
+
+    std::unique_ptr<ILedStripWithStorage> rgb = CreateLedBufferStorage(10, ColorChannels("RGB"));
+    std::unique_ptr<ILedStripWithStorage> rgbw = CreateLedBufferStorage(10, ColorChannels("RGBW"));
+
+    TEST_ASSERT_NOT_NULL(dynamic_cast<RGBLedBufferStorage*>(rgb.get()));
+    TEST_ASSERT_NOT_NULL(dynamic_cast<LedBufferStorage*>(rgbw.get()));
+}
+
+static void test_paletted_storage() {
+    LedPalette palette;
+    PalettedLedBufferStorage<4> strip(7, palette);
+    PalettedLedBufferStorage<8> other(3, palette);
+
+    strip.setLed(0, COLOR_RED);
+    strip.setLed(1, COLOR_BLUE);
+    strip.setRange(2, 5, COLOR_RED);
+    other.setLed(2, COLOR_BLUE);
+
+    TEST_ASSERT_EQUAL(2, palette.size());
+    TEST_ASSERT_TRUE(strip.getLed(0) == COLOR_RED);
+    TEST_ASSERT_TRUE(strip.getLed(1) == COLOR_BLUE);
+    TEST_ASSERT_TRUE(strip.getLed(6) == COLOR_RED);
+    TEST_ASSERT_EQUAL(1, other.getIndex(2));
+
+    // Changing the palette changes all leds using the entry
+    palette.setColor(0, COLOR_GREEN);
+    TEST_ASSERT_TRUE(strip.getLed(6) == COLOR_GREEN);
+    TEST_ASSERT_TRUE(strip.getLed(1) == COLOR_BLUE);
+
+    // 4 bit indices use only 16 entries, then the nearest color is used
+    for (uint8_t i = 0; i < 20; ++i) {
+        strip.setLed(0, RGBW(10 * i, 0, 0, 100));
+    }
+
+    TEST_ASSERT_EQUAL(16, palette.size());
+    TEST_ASSERT_TRUE(strip.getLed(0) == RGBW(130, 0, 0, 100));
+
+    other.setLed(0, RGBW(1, 1, 1, 1));
+    TEST_ASSERT_EQUAL(17, palette.size());
+}
+
+static void test_palette_animation() {
+    LedBufferStorage output(100);
+    LedPalette palette({COLOR_OFF, COLOR_RED});
+    VirtualPalettedLedStrip<4> strip(output, palette);
+    AnimationManager animationManager;
+
+    strip.setRange(10, 50, COLOR_RED);
+
+    animationManager.addAnimation(new PaletteFadeAnimation(0, 100, strip, palette, 1, COLOR_RED, COLOR_BLUE));
+    animationManager.update(100);
+
+    TEST_ASSERT_TRUE(output.getLed(9) == COLOR_OFF);
+    TEST_ASSERT_TRUE(output.getLed(10) == COLOR_BLUE);
+    TEST_ASSERT_TRUE(output.getLed(59) == COLOR_BLUE);
+    TEST_ASSERT_TRUE(output.getLed(60) == COLOR_OFF);
+    TEST_ASSERT_TRUE(strip.getLed(30) == COLOR_BLUE);
+}
+
+static void test_power_limit_rgb_buffer() {
+    const LedPowerConsumptionInfo consumptionInfo(0.f, 20.f, 20.f);
+
+    LedBufferStorage output(4);
+    VirtualLedStripWithPowerLimit limited(output, consumptionInfo, 4 * 30.f, ColorChannels("RGB"));
+
+    // The frame is buffered with 3 bytes per led, the W channel is dropped
+    TEST_ASSERT_TRUE(limited.getPixelBuffer() == nullptr);
+
+    limited.setAll(RGBW(255, 0, 0, 255), true);
+    TEST_ASSERT_TRUE(limited.getLed(0) == COLOR_RED);
+    TEST_ASSERT_TRUE(output.getLed(0).w == 0);
+    TEST_ASSERT_TRUE(limited.getCurrentPowerConsumption_mA() <= 4 * 30.f);
+
+    // Within the limit the colors are passed unchanged
+    limited.setAll(RGBW(100, 50, 0, 0), true);
+    TEST_ASSERT_TRUE(output.getLed(3) == RGBW(100, 50, 0, 0));
+}
+
+int main() {
+    UNITY_BEGIN();
+    RUN_TEST(test_rgb_storage);
+    RUN_TEST(test_paletted_storage);
+    RUN_TEST(test_palette_animation);
+    RUN_TEST(test_power_limit_rgb_buffer);
+    return UNITY_END();
+}
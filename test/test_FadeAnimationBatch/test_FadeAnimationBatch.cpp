@@ -0,0 +1,143 @@
+#include <unity.h>
+#include "FadeAnimationBatch.h"
+#include "AnimationManager.h"
+#include "LedBufferStorage.h"
+
+// The batch uses an 8.8 fixed point factor, FadeAnimation truncates a float interpolation
+static void AssertColorWithin(RGBW expected, RGBW actual) {
+    TEST_ASSERT_INT_WITHIN(2, expected.r, actual.r);
+    TEST_ASSERT_INT_WITHIN(2, expected.g, actual.g);
+    TEST_ASSERT_INT_WITHIN(2, expected.b, actual.b);
+    TEST_ASSERT_INT_WITHIN(2, expected.w, actual.w);
+}
+
+/**
+* Led strip without W component, like LedStrip_LPD8806.
+*/
+class RGBLedStrip : public LedBufferStorage {
+    public:
+        RGBLedStrip(ledoffset_t count) :
+            LedBufferStorage(count) {}
+
+        virtual void setLed(ledoffset_t index, RGBW color, bool flush = false) override {
+            color.w = 0;
+
+            LedBufferStorage::setLed(index, color, flush);
+        }
+
+        virtual RGBW* getPixelBuffer() override {
+            return nullptr;
+        }
+};
+
+static void test_matches_fade_animation() {
+    LedBufferStorage batchStrip(4);
+    LedBufferStorage animationStrip(4);
+    FadeAnimationBatch batch(batchStrip);
+    AnimationManager animationManager;
+
+    const RGBW from[4] = {COLOR_OFF, COLOR_RED, RGBW(10, 20, 30, 40), COLOR_NWHITE};
+    const RGBW to[4] = {COLOR_BLUE, COLOR_OFF, RGBW(250, 200, 150, 100), COLOR_GREEN};
+
+    for (ledoffset_t i = 0; i < 4; ++i) {
+        batch.addFade(i * 10, 100 + i * 50, i, from[i], to[i]);
+        animationManager.addAnimation(new FadeAnimation(i * 10, 100 + i * 50, animationStrip, i, from[i], to[i]));
+    }
+
+    for (uint32_t time = 0; time <= 250; time += 7) {
+        batch.update(time);
+        animationManager.update(time);
+
+        for (ledoffset_t i = 0; i < 4; ++i) {
+            AssertColorWithin(animationStrip.getLed(i), batchStrip.getLed(i));
+        }
+    }
+}
+
+static void test_finished_fades_are_removed() {
+    LedBufferStorage strip(2);
+    FadeAnimationBatch batch(strip);
+
+    batch.addFade(100, 50, 0, COLOR_OFF, COLOR_RED);
+    batch.addFade(0, 10, 1, COLOR_OFF, COLOR_BLUE);
+
+    // Not started yet, the led is not written
+    TEST_ASSERT_TRUE(batch.update(5));
+    TEST_ASSERT_TRUE(strip.getLed(0) == COLOR_OFF);
+    TEST_ASSERT_EQUAL(2, batch.size());
+
+    // The finished fade applies its end color once and is removed
+    TEST_ASSERT_TRUE(batch.update(10));
+    TEST_ASSERT_TRUE(strip.getLed(1) == COLOR_BLUE);
+    TEST_ASSERT_EQUAL(1, batch.size());
+
+    TEST_ASSERT_FALSE(batch.update(20));
+
+    TEST_ASSERT_TRUE(batch.update(175));
+    TEST_ASSERT_TRUE(strip.getLed(0) == COLOR_RED);
+    TEST_ASSERT_TRUE(batch.empty());
+}
+
+static void test_same_led_in_order() {
+    LedBufferStorage strip(1);
+    FadeAnimationBatch batch(strip);
+
+    batch.addFade(0, 100, 0, COLOR_OFF, COLOR_RED);
+    batch.addFade(0, 200, 0, COLOR_OFF, COLOR_BLUE);
+
+    // The fade added last wins
+    batch.update(100);
+    TEST_ASSERT_EQUAL(0, strip.getLed(0).r);
+    TEST_ASSERT_INT_WITHIN(1, 127, strip.getLed(0).b);
+
+    batch.update(300);
+    TEST_ASSERT_TRUE(strip.getLed(0) == COLOR_BLUE);
+}
+
+static void test_keeps_active_count() {
+    LedBufferStorage strip(8);
+    FadeAnimationBatch batch(strip);
+
+    for (ledoffset_t i = 0; i < 8; ++i) {
+        batch.addFade(0, 100, i, COLOR_OFF, i % 2 ? COLOR_RED : COLOR_OFF);
+    }
+
+    // Written via the pixel buffer, counted once when the batch flushes the strip
+    batch.update(50);
+    TEST_ASSERT_TRUE(strip.isActiveCountValid());
+    TEST_ASSERT_EQUAL(4, strip.activeCount());
+
+    batch.update(100);
+    TEST_ASSERT_TRUE(strip.isActiveCountValid());
+    TEST_ASSERT_TRUE(strip.isAnyActive());
+
+    strip.setRange(0, 8, COLOR_OFF);
+    TEST_ASSERT_FALSE(strip.isAnyActive());
+}
+
+static void test_without_pixel_buffer() {
+    RGBLedStrip strip(2);
+    FadeAnimationBatch batch(strip);
+
+    batch.addFade(0, 100, 0, COLOR_OFF, RGBW(100, 100, 100, 100));
+    batch.addFade(0, 100, 1, COLOR_OFF, RGBW(0, 0, 0, 200));
+
+    // The batch goes through setLed(), which drops the W component
+    batch.update(50);
+    TEST_ASSERT_EQUAL(50, strip.getLed(0).r);
+    TEST_ASSERT_EQUAL(0, strip.getLed(0).w);
+
+    batch.update(100);
+    TEST_ASSERT_TRUE(strip.getLed(1) == COLOR_OFF);
+    TEST_ASSERT_TRUE(strip.getLed(0) == RGBW(100, 100, 100, 0));
+}
+
+int main() {
+    UNITY_BEGIN();
+    RUN_TEST(test_matches_fade_animation);
+    RUN_TEST(test_finished_fades_are_removed);
+    RUN_TEST(test_same_led_in_order);
+    RUN_TEST(test_keeps_active_count);
+    RUN_TEST(test_without_pixel_buffer);
+    return UNITY_END();
+}
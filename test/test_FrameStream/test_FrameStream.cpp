@@ -0,0 +1,158 @@
+#include <unity.h>
+#include "LedBufferStorage.h"
+#include "FrameStream.h"
+
+static const ledoffset_t LED_COUNT = 40;
+static const uint32_t FRAME_INTERVAL = 10000;
+
+static RGBW GetTestColor(uint32_t frame, ledoffset_t led) {
+    // Mostly static content with a moving dot
+    if (led == frame % LED_COUNT) {
+        return COLOR_RED;
+    }
+
+    return RGBW(led, 0, frame / 4, 0);
+}
+
+static std::vector<uint8_t> RecordTestStream(uint32_t countFrames) {
+    std::vector<uint8_t> stream;
+    LedBufferStorage strip(LED_COUNT);
+    FrameStreamRecorder recorder(strip, stream, FRAME_INTERVAL, 8);
+
+    for (uint32_t frame = 0; frame < countFrames; ++frame) {
+        for (ledoffset_t i = 0; i < LED_COUNT; ++i) {
+            recorder.setLed(i, GetTestColor(frame, i));
+        }
+
+        recorder.updateLeds();
+    }
+
+    return stream;
+}
+
+static void test_delta_encoding_roundtrip() {
+    uint8_t previous[64] = {};
+    uint8_t current[64] = {};
+
+    current[3] = 7;
+    current[5] = 9;
+    current[40] = 1;
+    current[63] = 255;
+
+    std::vector<uint8_t> payload;
+    FrameStreamFormat::EncodeDelta(previous, current, sizeof(current), payload);
+
+    TEST_ASSERT_TRUE(payload.size() < sizeof(current));
+    TEST_ASSERT_TRUE(FrameStreamFormat::DecodeDelta(payload.data(), payload.size(), previous, sizeof(previous)));
+    TEST_ASSERT_EQUAL_MEMORY(current, previous, sizeof(current));
+}
+
+static void test_record_and_play() {
+    const uint32_t countFrames = 30;
+    std::vector<uint8_t> stream = RecordTestStream(countFrames);
+
+    // Delta frames keep the stream well below the raw size
+    TEST_ASSERT_TRUE(stream.size() < countFrames * LED_COUNT * 4 / 2);
+
+    LedBufferStorage target(LED_COUNT);
+    FrameStreamPlayer player(stream.data(), stream.size(), target);
+
+    TEST_ASSERT_TRUE(player.isValid());
+    TEST_ASSERT_EQUAL(countFrames, player.getHeader().frameCount);
+    TEST_ASSERT_EQUAL(LED_COUNT, player.getHeader().ledCount);
+
+    player.start(1000);
+
+    for (uint32_t frame = 0; frame < countFrames; ++frame) {
+        TEST_ASSERT_TRUE(player.update(1000 + frame * FRAME_INTERVAL));
+        TEST_ASSERT_FALSE(player.update(1000 + frame * FRAME_INTERVAL + 1));
+
+        for (ledoffset_t i = 0; i < LED_COUNT; ++i) {
+            TEST_ASSERT_TRUE(target.getLed(i) == GetTestColor(frame, i));
+        }
+    }
+
+    TEST_ASSERT_TRUE(player.isFinished());
+    TEST_ASSERT_FALSE(player.update(1000 + countFrames * FRAME_INTERVAL));
+}
+
+static void test_play_skips_frames_and_loops() {
+    const uint32_t countFrames = 20;
+    std::vector<uint8_t> stream = RecordTestStream(countFrames);
+
+    LedBufferStorage target(LED_COUNT);
+    FrameStreamPlayer player(stream.data(), stream.size(), target, true);
+
+    player.start(0);
+
+    TEST_ASSERT_TRUE(player.update(13 * FRAME_INTERVAL));
+    TEST_ASSERT_TRUE(target.getLed(13) == GetTestColor(13, 13));
+
+    TEST_ASSERT_TRUE(player.update((countFrames + 2) * FRAME_INTERVAL));
+    TEST_ASSERT_TRUE(target.getLed(2) == GetTestColor(2, 2));
+    TEST_ASSERT_FALSE(player.isFinished());
+}
+
+static void test_record_flushing_setters() {
+    std::vector<uint8_t> stream;
+    LedBufferStorage strip(LED_COUNT);
+    FrameStreamRecorder recorder(strip, stream, FRAME_INTERVAL);
+    RGBW colors[2] = {COLOR_GREEN, COLOR_BLUE};
+
+    recorder.setLed(0, COLOR_RED, true);
+    recorder.setRange(1, 3, COLOR_RED, true);
+    recorder.setLeds(4, colors, 2, true);
+
+    // Non flushing calls are only recorded with the next flush
+    recorder.setLed(6, COLOR_RED);
+    TEST_ASSERT_EQUAL(3, recorder.getFrameCount());
+
+    LedBufferStorage target(LED_COUNT);
+    FrameStreamPlayer player(stream.data(), stream.size(), target);
+
+    player.start(0);
+    TEST_ASSERT_TRUE(player.update(2 * FRAME_INTERVAL));
+    TEST_ASSERT_TRUE(target.getLed(3) == COLOR_RED);
+    TEST_ASSERT_TRUE(target.getLed(5) == COLOR_BLUE);
+    TEST_ASSERT_TRUE(target.getLed(6) == COLOR_OFF);
+}
+
+static void test_play_beyond_32_bit_micros() {
+    const uint32_t countFrames = 10;
+    std::vector<uint8_t> stream = RecordTestStream(countFrames);
+
+    LedBufferStorage target(LED_COUNT);
+    FrameStreamPlayer player(stream.data(), stream.size(), target, true);
+
+    // Starts shortly before micros() would wrap around after ~71.6 minutes
+    const uint64_t startTime = UINT32_MAX - FRAME_INTERVAL;
+    player.start(startTime);
+
+    TEST_ASSERT_FALSE(player.update(startTime - 1));
+    TEST_ASSERT_TRUE(player.update(startTime + 3 * FRAME_INTERVAL));
+    TEST_ASSERT_TRUE(target.getLed(3) == GetTestColor(3, 3));
+
+    // Hours later the loop still plays the frame matching the time
+    TEST_ASSERT_TRUE(player.update(startTime + uint64_t(1000000) * countFrames * FRAME_INTERVAL + 7 * FRAME_INTERVAL));
+    TEST_ASSERT_TRUE(target.getLed(7) == GetTestColor(7, 7));
+}
+
+static void test_invalid_stream() {
+    uint8_t data[20] = {'L', 'C', 'F', 'X'};
+    LedBufferStorage target(LED_COUNT);
+    FrameStreamPlayer player(data, sizeof(data), target);
+
+    TEST_ASSERT_FALSE(player.isValid());
+    TEST_ASSERT_FALSE(player.update(0));
+}
+
+int main() {
+    UNITY_BEGIN();
+    RUN_TEST(test_delta_encoding_roundtrip);
+    RUN_TEST(test_record_and_play);
+    RUN_TEST(test_play_skips_frames_and_loops);
+    RUN_TEST(test_record_flushing_setters);
+    RUN_TEST(test_play_beyond_32_bit_micros);
+    RUN_TEST(test_invalid_stream);
+    return UNITY_END();
+}
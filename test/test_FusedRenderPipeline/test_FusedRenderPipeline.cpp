@@ -0,0 +1,138 @@
+#include <unity.h>
+#include "LedStrip_Simulated.h"
+#include "FusedRenderPipeline.h"
+
+static const ledoffset_t LED_COUNT = 16;
+
+static void test_matches_unfused_encoding() {
+    LedBufferStorage source(LED_COUNT);
+    LedStrip_Simulated fusedOutput(LED_COUNT, LedWireProtocol::WS2812_RGBW);
+    LedStrip_Simulated reference(LED_COUNT, LedWireProtocol::WS2812_RGBW);
+
+    for (ledoffset_t i = 0; i < LED_COUNT; ++i) {
+        source.setLed(i, RGBW(i * 10, 255 - i, i, 3 * i));
+    }
+
+    FusedRenderPipeline pipeline(fusedOutput, source);
+    pipeline.render();
+
+    source.copyTo(reference, true);
+
+    TEST_ASSERT_EQUAL(1, fusedOutput.getFrameCount());
+    TEST_ASSERT_EQUAL_MEMORY(reference.getSendBuffer().data(), fusedOutput.getSendBuffer().data(), reference.getSendBuffer().size());
+}
+
+static void test_cross_fade_and_gamma() {
+    LedBufferStorage source0(LED_COUNT);
+    LedBufferStorage source1(LED_COUNT);
+    LedStrip_Simulated output(LED_COUNT, LedWireProtocol::APA102);
+
+    source0.setAll(RGBW(200, 0, 100, 0));
+    source1.setAll(RGBW(0, 200, 100, 0));
+
+    FusedRenderPipeline pipeline(output, source0);
+    pipeline.setCrossFade(source0, source1, 0.5f);
+    pipeline.render();
+
+    TEST_ASSERT_TRUE(APA102Encoding::DecodeLed(output.getSendBuffer().data(), 3) == RGBW(100, 100, 100));
+
+    std::array<uint8_t, 256> halfGamma;
+    for (size_t i = 0; i < halfGamma.size(); ++i) {
+        halfGamma[i] = i / 2;
+    }
+
+    pipeline.setGammaTable(&halfGamma);
+    pipeline.setCrossFadeFactor(1.f);
+    pipeline.render();
+
+    TEST_ASSERT_TRUE(APA102Encoding::DecodeLed(output.getSendBuffer().data(), 3) == RGBW(0, 100, 50));
+}
+
+static void test_power_limit() {
+    const LedPowerConsumptionInfo consumptionInfo(1.f, 20.f, 20.f);
+    const float powerLimit = LED_COUNT * 21.f;
+
+    LedBufferStorage source(LED_COUNT);
+    LedStrip_Simulated output(LED_COUNT, LedWireProtocol::APA102);
+
+    source.setAll(COLOR_RED);
+
+    FusedRenderPipeline pipeline(output, source);
+    pipeline.setPowerLimit(consumptionInfo, powerLimit);
+
+    // Below the limit
+    pipeline.render();
+    TEST_ASSERT_EQUAL(256, pipeline.getPowerScale());
+
+    // Three channels at full brightness: 61 mA per led
+    source.setAll(RGBW(255, 255, 255, 0));
+    pipeline.render();
+
+    float consumption = 0.f;
+    for (ledoffset_t i = 0; i < LED_COUNT; ++i) {
+        consumption += consumptionInfo.calculatePowerConsumption(APA102Encoding::DecodeLed(output.getSendBuffer().data(), i));
+    }
+
+    TEST_ASSERT_TRUE(pipeline.getPowerScale() < 256);
+    TEST_ASSERT_TRUE(consumption <= powerLimit);
+    TEST_ASSERT_TRUE(consumption > powerLimit * 0.95f);
+}
+
+static void test_power_limit_cross_fade() {
+    const LedPowerConsumptionInfo consumptionInfo(1.f, 20.f, 20.f);
+
+    LedBufferStorage source0(LED_COUNT);
+    LedBufferStorage source1(LED_COUNT);
+    LedStrip_Simulated output(LED_COUNT, LedWireProtocol::APA102);
+
+    source0.setAll(RGBW(255, 255, 255, 0));
+
+    // The linear mix at 1/256 is 254.004 per channel, the limit exactly allows it
+    const float linearChannel = 255.f - 255.f / 256.f;
+    const float powerLimit = LED_COUNT * (1.f + 3.f * 20.f * linearChannel / 255.f) + 0.01f;
+
+    FusedRenderPipeline pipeline(output, source0);
+    pipeline.setCrossFade(source0, source1, 1.f / 256.f);
+    pipeline.setPowerLimit(consumptionInfo, powerLimit);
+    pipeline.render();
+
+    float consumption = 0.f;
+    for (ledoffset_t i = 0; i < LED_COUNT; ++i) {
+        consumption += consumptionInfo.calculatePowerConsumption(APA102Encoding::DecodeLed(output.getSendBuffer().data(), i));
+    }
+
+    TEST_ASSERT_EQUAL(256, pipeline.getPowerScale());
+    TEST_ASSERT_TRUE(APA102Encoding::DecodeLed(output.getSendBuffer().data(), 0) == RGBW(254, 254, 254, 0));
+    TEST_ASSERT_TRUE(consumption <= powerLimit);
+}
+
+static void test_white_extraction() {
+    const LedPowerConsumptionInfo consumptionInfo(0.f, 20.f, 20.f);
+
+    LedBufferStorage source(LED_COUNT);
+    LedStrip_Simulated output(LED_COUNT, LedWireProtocol::WS2812_RGBW);
+
+    source.setAll(COLOR_KWHITE);
+
+    FusedRenderPipeline pipeline(output, source);
+    pipeline.setWhiteExtraction(WhitePoint());
+    pipeline.setPowerLimit(consumptionInfo, LED_COUNT * 20.f);
+    pipeline.render();
+
+    // Only the white channel is used, which fits into the budget
+    TEST_ASSERT_EQUAL(256, pipeline.getPowerScale());
+
+    const uint8_t* frame = output.getSendBuffer().data();
+    TEST_ASSERT_EQUAL(0, frame[0]);
+    TEST_ASSERT_EQUAL(255, frame[3]);
+}
+
+int main() {
+    UNITY_BEGIN();
+    RUN_TEST(test_matches_unfused_encoding);
+    RUN_TEST(test_cross_fade_and_gamma);
+    RUN_TEST(test_power_limit);
+    RUN_TEST(test_power_limit_cross_fade);
+    RUN_TEST(test_white_extraction);
+    return UNITY_END();
+}
@@ -0,0 +1,119 @@
+#define LEDCONTROL_INSTRUMENTATION
+#include <unity.h>
+#include "Instrumentation.h"
+
+#include <chrono>
+#include <thread>
+#include <vector>
+
+static void test_record_histogram() {
+    Instrumentation::Reset();
+
+    Instrumentation::Record(InstrumentationStage::Encoding, 0);
+    Instrumentation::Record(InstrumentationStage::Encoding, 1);
+    Instrumentation::Record(InstrumentationStage::Encoding, 3);
+    Instrumentation::Record(InstrumentationStage::Encoding, 1000);
+    Instrumentation::Record(InstrumentationStage::Encoding, UINT32_MAX);
+
+    StageStatistics statistics = Instrumentation::GetStatistics(InstrumentationStage::Encoding);
+
+    TEST_ASSERT_EQUAL(5, statistics.count);
+    TEST_ASSERT_TRUE(statistics.totalMicros == uint64_t(1004) + UINT32_MAX);
+    TEST_ASSERT_EQUAL(UINT32_MAX, statistics.maxMicros);
+    TEST_ASSERT_EQUAL(2, statistics.histogram[0]);
+    TEST_ASSERT_EQUAL(1, statistics.histogram[1]);
+    TEST_ASSERT_EQUAL(1, statistics.histogram[9]);
+    TEST_ASSERT_EQUAL(1, statistics.histogram[StageStatistics::HISTOGRAM_BUCKETS - 1]);
+
+    // Other stages are not affected
+    TEST_ASSERT_EQUAL(0, Instrumentation::GetStatistics(InstrumentationStage::Transmit).count);
+}
+
+static void test_scoped_stage_timer() {
+    Instrumentation::Reset();
+
+    {
+        ScopedStageTimer timer(InstrumentationStage::Transmit);
+        std::this_thread::sleep_for(std::chrono::milliseconds(2));
+    }
+
+    StageStatistics statistics = Instrumentation::GetStatistics(InstrumentationStage::Transmit);
+
+    TEST_ASSERT_EQUAL(1, statistics.count);
+    TEST_ASSERT_TRUE(statistics.maxMicros >= 2000);
+    TEST_ASSERT_EQUAL(statistics.maxMicros, statistics.getAverageMicros());
+    TEST_ASSERT_EQUAL(1, statistics.histogram[StageStatistics::GetBucket(statistics.maxMicros)]);
+}
+
+static void test_snapshot_and_reset() {
+    StageStatistics snapshot[size_t(InstrumentationStage::Count)];
+
+    Instrumentation::Reset();
+    Instrumentation::Record(InstrumentationStage::PowerLimit, 10);
+    Instrumentation::Record(InstrumentationStage::PowerLimit, 30);
+
+    // The snapshot contains the interval, the statistics start over
+    Instrumentation::TakeSnapshot(snapshot);
+    TEST_ASSERT_EQUAL(2, snapshot[size_t(InstrumentationStage::PowerLimit)].count);
+    TEST_ASSERT_EQUAL(20, snapshot[size_t(InstrumentationStage::PowerLimit)].getAverageMicros());
+    TEST_ASSERT_EQUAL(30, snapshot[size_t(InstrumentationStage::PowerLimit)].maxMicros);
+    TEST_ASSERT_EQUAL(0, snapshot[size_t(InstrumentationStage::Compositing)].count);
+    TEST_ASSERT_EQUAL(0, Instrumentation::GetStatistics(InstrumentationStage::PowerLimit).count);
+
+    Instrumentation::Record(InstrumentationStage::PowerLimit, 5);
+    Instrumentation::TakeSnapshot(snapshot);
+    TEST_ASSERT_EQUAL(1, snapshot[size_t(InstrumentationStage::PowerLimit)].count);
+    TEST_ASSERT_EQUAL(5, snapshot[size_t(InstrumentationStage::PowerLimit)].maxMicros);
+
+    Instrumentation::Record(InstrumentationStage::PowerLimit, 5);
+    Instrumentation::Reset();
+
+    StageStatistics statistics = Instrumentation::GetStatistics(InstrumentationStage::PowerLimit);
+    TEST_ASSERT_EQUAL(0, statistics.count);
+    TEST_ASSERT_TRUE(statistics.totalMicros == 0);
+    TEST_ASSERT_EQUAL(0, statistics.maxMicros);
+    TEST_ASSERT_EQUAL(0, statistics.getAverageMicros());
+}
+
+static void test_record_from_other_threads() {
+    const uint32_t countRecords = 20000;
+    StageStatistics snapshot[size_t(InstrumentationStage::Count)];
+    std::vector<std::thread> threads;
+    uint64_t count = 0;
+    uint64_t total = 0;
+
+    Instrumentation::Reset();
+
+    for (int i = 0; i < 2; ++i) {
+        threads.emplace_back([]() {
+            for (uint32_t j = 0; j < countRecords; ++j) {
+                Instrumentation::Record(InstrumentationStage::Transmit, 3);
+            }
+        });
+    }
+
+    // Snapshots while recording, every record ends up in exactly one snapshot
+    while (count < 2 * countRecords) {
+        Instrumentation::TakeSnapshot(snapshot);
+        count += snapshot[size_t(InstrumentationStage::Transmit)].count;
+        total += snapshot[size_t(InstrumentationStage::Transmit)].totalMicros;
+    }
+
+    for (std::thread& thread : threads) {
+        thread.join();
+    }
+
+    Instrumentation::TakeSnapshot(snapshot);
+    TEST_ASSERT_EQUAL(0, snapshot[size_t(InstrumentationStage::Transmit)].count);
+    TEST_ASSERT_TRUE(count == 2 * countRecords);
+    TEST_ASSERT_TRUE(total == 3 * count);
+}
+
+int main() {
+    UNITY_BEGIN();
+    RUN_TEST(test_record_histogram);
+    RUN_TEST(test_scoped_stage_timer);
+    RUN_TEST(test_snapshot_and_reset);
+    RUN_TEST(test_record_from_other_threads);
+    return UNITY_END();
+}
@@ -0,0 +1,104 @@
+#include <unity.h>
+#include "LedStrip_Simulated.h"
+
+static void test_apa102_encoding() {
+    LedStrip_Simulated strip(2, LedWireProtocol::APA102);
+
+    strip.setLed(0, RGBW(1, 2, 3, 4));
+    strip.updateLeds();
+
+    const uint8_t expected[] = {
+        0, 0, 0, 0,
+        0xFF, 3, 2, 1,
+        0xE0, 0, 0, 0,
+    };
+
+    TEST_ASSERT_EQUAL(sizeof(expected), strip.getSendBuffer().size());
+    TEST_ASSERT_EQUAL_MEMORY(expected, strip.getSendBuffer().data(), sizeof(expected));
+}
+
+static void test_lpd8806_encoding() {
+    LedStrip_Simulated strip(1, LedWireProtocol::LPD8806);
+
+    strip.setLed(0, RGBW(255, 0, 128, 0), true);
+
+    const std::vector<uint8_t>& frame = strip.getSendBuffer();
+
+    TEST_ASSERT_EQUAL(6, frame.size());
+    TEST_ASSERT_EQUAL(0xFF, frame[0]);
+    TEST_ASSERT_EQUAL(0x80, frame[1]);
+    TEST_ASSERT_EQUAL(LPD8806Encoding::GetGammaTable()[128], frame[2]);
+    TEST_ASSERT_EQUAL(0, frame[3]);
+}
+
+static void test_ws2812_encoding_and_recording() {
+    LedStrip_Simulated strip(1, LedWireTiming::GetDefault(LedWireProtocol::WS2812_RGBW), 2);
+
+    for (uint8_t i = 1; i <= 3; ++i) {
+        strip.setLed(0, RGBW(i, 2 * i, 3 * i, 4 * i), true);
+    }
+
+    TEST_ASSERT_EQUAL(3, strip.getFrameCount());
+    TEST_ASSERT_EQUAL(2, strip.getRecordedFrames().size());
+
+    const std::vector<uint8_t>& oldest = strip.getRecordedFrames().front();
+    TEST_ASSERT_EQUAL(4, oldest[0]);    // g
+    TEST_ASSERT_EQUAL(2, oldest[1]);    // r
+    TEST_ASSERT_EQUAL(6, oldest[2]);    // b
+    TEST_ASSERT_EQUAL(8, oldest[3]);    // w
+}
+
+static void test_wire_timing() {
+    // 100 RGB leds at 800 kbit/s: 2400 bits = 3000 us + 300 us reset
+    LedWireTiming ws2812 = LedWireTiming::GetDefault(LedWireProtocol::WS2812);
+    TEST_ASSERT_EQUAL(3300, ws2812.getFrameTime_us(100));
+
+    // Same leds on 4 outputs
+    LedWireTiming ws2812Parallel = LedWireTiming::GetDefault(LedWireProtocol::WS2812, 4);
+    TEST_ASSERT_EQUAL(1050, ws2812Parallel.getFrameTime_us(100));
+
+    // 60 fps: 16666 us - 300 us reset = 13066 bits = 1635 bytes = 545 leds
+    TEST_ASSERT_EQUAL(545, ws2812.getMaxLedsPerOutput(60.f));
+
+    LedStrip_Simulated strip(100, ws2812);
+    strip.updateLeds();
+    strip.updateLeds();
+
+    TEST_ASSERT_EQUAL(6600, strip.getTotalWireTime_us());
+}
+
+static void test_frame_deduplication() {
+    LedStrip_Simulated strip(10, LedWireProtocol::APA102);
+    strip.getFrameDeduplicator().setEnabled(true);
+
+    strip.setCurrentTime(0);
+    strip.setLed(3, COLOR_RED, true);
+    strip.updateLeds();
+    strip.updateLeds();
+
+    TEST_ASSERT_EQUAL(1, strip.getFrameCount());
+    TEST_ASSERT_EQUAL(2, strip.getFrameDeduplicator().getSkippedCount());
+
+    // A single changed byte is transmitted
+    strip.setLed(9, RGBW(0, 0, 1), true);
+    TEST_ASSERT_EQUAL(2, strip.getFrameCount());
+
+    // Keep alive
+    strip.setCurrentTime(FrameDeduplicator::DEFAULT_KEEP_ALIVE_MS - 1);
+    strip.updateLeds();
+    TEST_ASSERT_EQUAL(2, strip.getFrameCount());
+
+    strip.setCurrentTime(FrameDeduplicator::DEFAULT_KEEP_ALIVE_MS);
+    strip.updateLeds();
+    TEST_ASSERT_EQUAL(3, strip.getFrameCount());
+}
+
+int main() {
+    UNITY_BEGIN();
+    RUN_TEST(test_apa102_encoding);
+    RUN_TEST(test_lpd8806_encoding);
+    RUN_TEST(test_ws2812_encoding_and_recording);
+    RUN_TEST(test_wire_timing);
+    RUN_TEST(test_frame_deduplication);
+    return UNITY_END();
+}
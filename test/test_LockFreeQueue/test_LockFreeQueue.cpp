@@ -0,0 +1,109 @@
+#include <unity.h>
+#include "LockFreeQueue.h"
+
+#include <thread>
+#include <vector>
+
+static void test_full_and_empty() {
+    LockFreeQueue<int> queue(3);
+    int value = -1;
+
+    // Rounded up to a power of two
+    TEST_ASSERT_EQUAL(4, queue.capacity());
+    TEST_ASSERT_TRUE(queue.empty());
+    TEST_ASSERT_FALSE(queue.pop(value));
+    TEST_ASSERT_EQUAL(-1, value);
+
+    for (int i = 0; i < 4; ++i) {
+        TEST_ASSERT_TRUE(queue.push(i));
+    }
+
+    TEST_ASSERT_FALSE(queue.empty());
+    TEST_ASSERT_FALSE(queue.push(4));
+
+    // One free cell allows exactly one more push
+    TEST_ASSERT_TRUE(queue.pop(value));
+    TEST_ASSERT_TRUE(queue.push(4));
+    TEST_ASSERT_FALSE(queue.push(5));
+
+    while (queue.pop(value)) {}
+
+    TEST_ASSERT_EQUAL(4, value);
+    TEST_ASSERT_TRUE(queue.empty());
+}
+
+static void test_fifo_order() {
+    LockFreeQueue<int> queue(8);
+    int next = 0;
+    int expected = 0;
+    int value;
+
+    // Several rounds, so the positions wrap around the cells
+    for (int round = 0; round < 10; ++round) {
+        for (int i = 0; i < 5; ++i) {
+            TEST_ASSERT_TRUE(queue.push(next++));
+        }
+
+        for (int i = 0; i < 5; ++i) {
+            TEST_ASSERT_TRUE(queue.pop(value));
+            TEST_ASSERT_EQUAL(expected++, value);
+        }
+    }
+
+    TEST_ASSERT_TRUE(queue.empty());
+}
+
+static void test_multiple_producers() {
+    const int countProducers = 4;
+    const int countValues = 5000;
+    LockFreeQueue<int> queue(16);
+    std::vector<std::thread> producers;
+    std::vector<int> received(countProducers * countValues, 0);
+    std::vector<int> lastValue(countProducers, -1);
+
+    for (int producer = 0; producer < countProducers; ++producer) {
+        producers.emplace_back([&queue, producer]() {
+            for (int i = 0; i < countValues; ++i) {
+                while (!queue.push(producer * countValues + i)) {
+                    std::this_thread::yield();
+                }
+            }
+        });
+    }
+
+    int countReceived = 0;
+    int value;
+
+    while (countReceived < countProducers * countValues) {
+        if (!queue.pop(value)) {
+            std::this_thread::yield();
+            continue;
+        }
+
+        // The values of each producer arrive in the order they were pushed
+        int producer = value / countValues;
+        TEST_ASSERT_TRUE(value % countValues > lastValue[producer]);
+        lastValue[producer] = value % countValues;
+
+        received[value]++;
+        countReceived++;
+    }
+
+    for (std::thread& thread : producers) {
+        thread.join();
+    }
+
+    for (int count : received) {
+        TEST_ASSERT_EQUAL(1, count);
+    }
+
+    TEST_ASSERT_TRUE(queue.empty());
+}
+
+int main() {
+    UNITY_BEGIN();
+    RUN_TEST(test_full_and_empty);
+    RUN_TEST(test_fifo_order);
+    RUN_TEST(test_multiple_producers);
+    return UNITY_END();
+}
@@ -0,0 +1,252 @@
+#include <unity.h>
+#include "LedBufferStorage.h"
+#include "LedStrip_LPD8806.h"
+#include "VirtualLedStrip.h"
+#include "PixelPacketReceiver.h"
+
+#include <vector>
+
+/**
+* Led strip without pixel buffer, counts the updates.
+*/
+class CountingLedStrip : public ILedStripWithStorage {
+    public:
+        std::vector<RGBW> leds;
+        int updateCount = 0;
+
+        CountingLedStrip(ledoffset_t count) :
+            leds(count) {}
+
+        virtual ledoffset_t getLedCount() const override {
+            return leds.size();
+        }
+
+        virtual void setLed(ledoffset_t index, RGBW color, bool flush = false) override {
+            leds[index] = color;
+
+            if (flush) {
+                updateLeds();
+            }
+        }
+
+        virtual RGBW getLed(ledoffset_t index) const override {
+            return leds[index];
+        }
+
+        virtual void updateLeds() override {
+            updateCount++;
+        }
+};
+
+static std::vector<uint8_t> CreateDDPPacket(uint8_t flags, uint8_t type, uint32_t offset, const std::vector<uint8_t>& payload) {
+    std::vector<uint8_t> packet = {
+        uint8_t(DDPReceiver::FLAG_VERSION_1 | flags), 1, type, DDPReceiver::ID_DISPLAY,
+        uint8_t(offset >> 24), uint8_t(offset >> 16), uint8_t(offset >> 8), uint8_t(offset),
+        uint8_t(payload.size() >> 8), uint8_t(payload.size())
+    };
+
+    packet.insert(packet.end(), payload.begin(), payload.end());
+    return packet;
+}
+
+static void WriteU16BE(std::vector<uint8_t>& packet, size_t offset, uint16_t value) {
+    packet[offset] = value >> 8;
+    packet[offset + 1] = value;
+}
+
+static void WriteU32BE(std::vector<uint8_t>& packet, size_t offset, uint32_t value) {
+    WriteU16BE(packet, offset, value >> 16);
+    WriteU16BE(packet, offset + 2, value);
+}
+
+static std::vector<uint8_t> CreateE131Header(size_t size, uint32_t rootVector, uint32_t framingVector) {
+    static const char* Identifier = "ASC-E1.17";
+
+    std::vector<uint8_t> packet(size);
+    WriteU16BE(packet, 0, 0x0010);
+    memcpy(packet.data() + 4, Identifier, 9);
+    WriteU32BE(packet, 18, rootVector);
+    WriteU32BE(packet, 40, framingVector);
+    return packet;
+}
+
+static std::vector<uint8_t> CreateE131DataPacket(uint16_t universe, uint8_t sequence, uint16_t syncAddress, const std::vector<uint8_t>& channels) {
+    std::vector<uint8_t> packet = CreateE131Header(E131Receiver::DATA_OFFSET + channels.size(),
+        E131Receiver::VECTOR_ROOT_E131_DATA, E131Receiver::VECTOR_E131_DATA_PACKET);
+
+    WriteU16BE(packet, 109, syncAddress);
+    packet[111] = sequence;
+    WriteU16BE(packet, 113, universe);
+    packet[117] = E131Receiver::VECTOR_DMP_SET_PROPERTY;
+    packet[118] = 0xA1;
+    WriteU16BE(packet, 121, 1);
+    WriteU16BE(packet, 123, channels.size() + 1);
+    memcpy(packet.data() + E131Receiver::DATA_OFFSET, channels.data(), channels.size());
+    return packet;
+}
+
+static std::vector<uint8_t> CreateE131SyncPacket(uint16_t syncAddress) {
+    std::vector<uint8_t> packet = CreateE131Header(E131Receiver::SYNC_PACKET_SIZE,
+        E131Receiver::VECTOR_ROOT_E131_EXTENDED, E131Receiver::VECTOR_E131_EXTENDED_SYNCHRONIZATION);
+
+    WriteU16BE(packet, 45, syncAddress);
+    return packet;
+}
+
+static void test_target_segments() {
+    LedBufferStorage strip0(4);
+    LedBufferStorage strip1(4);
+    VirtualMultiLedStrip2 multi(strip0, strip1);
+    CountingLedStrip strip2(2);
+
+    PixelPacketTarget target;
+    target.addStrip(multi);
+    target.addStrip(strip2);
+
+    TEST_ASSERT_EQUAL(10, target.getLedCount());
+    TEST_ASSERT_EQUAL(3, target.getSegmentCount());
+
+    // Starts in the middle of led 3 and ends in the middle of led 9
+    std::vector<uint8_t> data;
+    for (uint8_t i = 0; i < 17; ++i) {
+        data.push_back(100 + i);
+    }
+
+    target.write(3 * 3 + 1, data.data(), data.size());
+
+    TEST_ASSERT_TRUE(strip0.getLed(2) == COLOR_OFF);
+    TEST_ASSERT_TRUE(strip0.getLed(3) == RGBW(0, 100, 101));
+    TEST_ASSERT_TRUE(strip1.getLed(0) == RGBW(102, 103, 104));
+    TEST_ASSERT_TRUE(strip1.getLed(3) == RGBW(111, 112, 113));
+    TEST_ASSERT_TRUE(strip2.getLed(0) == RGBW(114, 115, 116));
+    TEST_ASSERT_TRUE(strip2.getLed(1) == COLOR_OFF);
+
+    TEST_ASSERT_TRUE(target.isDirty());
+    target.flush();
+    TEST_ASSERT_FALSE(target.isDirty());
+    TEST_ASSERT_EQUAL(1, strip2.updateCount);
+}
+
+static void test_target_keeps_active_count() {
+    LedBufferStorage strip(4);
+    PixelPacketTarget target;
+
+    target.addStrip(strip);
+    strip.setLed(0, COLOR_RED);
+
+    // Written directly into the pixel buffer of the strip, counted again on flush()
+    const uint8_t data[6] = {0, 0, 255, 0, 0, 0};
+    target.write(2 * 3, data, sizeof(data));
+    target.flush();
+
+    TEST_ASSERT_TRUE(strip.getLed(2) == COLOR_BLUE);
+    TEST_ASSERT_TRUE(strip.isActiveCountValid());
+    TEST_ASSERT_EQUAL(2, strip.activeCount());
+
+    const uint8_t off[12] = {};
+    target.write(0, off, sizeof(off));
+    target.flush();
+    TEST_ASSERT_TRUE(strip.isActiveCountValid());
+    TEST_ASSERT_FALSE(strip.isAnyActive());
+
+    strip.setLed(1, COLOR_OFF);
+    TEST_ASSERT_EQUAL(0, strip.activeCount());
+}
+
+static void test_target_keeps_setled_semantics() {
+    // Has no W component, so it does not hand out its pixel buffer
+    LedStrip_LPD8806 strip(2, 0, 1);
+    PixelPacketTarget target;
+
+    target.addStrip(strip);
+
+    const uint8_t data[8] = {1, 2, 3, 4, 5, 6, 7, 8};
+    target.write(0, data, sizeof(data), 4);
+
+    TEST_ASSERT_TRUE(strip.getLed(0) == RGBW(1, 2, 3, 0));
+    TEST_ASSERT_TRUE(strip.getLed(1) == RGBW(5, 6, 7, 0));
+}
+
+static void test_ddp() {
+    LedBufferStorage strip(4);
+    CountingLedStrip counting(4);
+    VirtualMultiLedStrip2 multi(strip, counting);
+
+    PixelPacketTarget target;
+    target.addStrip(multi);
+    DDPReceiver receiver(target);
+
+    std::vector<uint8_t> packet = CreateDDPPacket(0, DDPReceiver::TYPE_RGB8, 0, {1, 2, 3, 4, 5, 6});
+    TEST_ASSERT_EQUAL(PixelPacketResult::Written, receiver.handlePacket(packet.data(), packet.size()));
+    TEST_ASSERT_TRUE(strip.getLed(1) == RGBW(4, 5, 6));
+    TEST_ASSERT_EQUAL(0, counting.updateCount);
+
+    packet = CreateDDPPacket(DDPReceiver::FLAG_PUSH, DDPReceiver::TYPE_RGB8, 4 * 3, {7, 8, 9});
+    TEST_ASSERT_EQUAL(PixelPacketResult::Displayed, receiver.handlePacket(packet.data(), packet.size()));
+    TEST_ASSERT_TRUE(counting.getLed(0) == RGBW(7, 8, 9));
+    TEST_ASSERT_EQUAL(1, counting.updateCount);
+
+    // RGBW data type
+    packet = CreateDDPPacket(0, DDPReceiver::TYPE_RGBW8, 4, {1, 2, 3, 4});
+    TEST_ASSERT_EQUAL(PixelPacketResult::Written, receiver.handlePacket(packet.data(), packet.size()));
+    TEST_ASSERT_TRUE(strip.getLed(1) == RGBW(1, 2, 3, 4));
+
+    // Truncated payload and queries
+    packet = CreateDDPPacket(0, DDPReceiver::TYPE_RGB8, 0, {1, 2, 3});
+    TEST_ASSERT_EQUAL(PixelPacketResult::Invalid, receiver.handlePacket(packet.data(), packet.size() - 1));
+    packet = CreateDDPPacket(DDPReceiver::FLAG_QUERY, DDPReceiver::TYPE_RGB8, 0, {});
+    TEST_ASSERT_EQUAL(PixelPacketResult::Ignored, receiver.handlePacket(packet.data(), packet.size()));
+}
+
+static void test_e131_universes_and_sync() {
+    LedBufferStorage strip0(200);
+    LedBufferStorage strip1(200);
+
+    PixelPacketTarget target;
+    target.addStrip(strip0);
+    target.addStrip(strip1);
+    E131Receiver receiver(target, 1);
+
+    TEST_ASSERT_EQUAL(3, receiver.getUniverseCount());
+
+    // Second universe starts at led 170
+    std::vector<uint8_t> channels(510, 0);
+    channels[0] = 10;
+    channels[3 * 31 + 2] = 20;
+
+    std::vector<uint8_t> packet = CreateE131DataPacket(2, 1, 7, channels);
+    TEST_ASSERT_EQUAL(PixelPacketResult::Written, receiver.handlePacket(packet.data(), packet.size()));
+    TEST_ASSERT_TRUE(strip0.getLed(170) == RGBW(10, 0, 0));
+    TEST_ASSERT_TRUE(strip1.getLed(1) == RGBW(0, 0, 20));
+
+    // Other sync address and the matching one
+    packet = CreateE131SyncPacket(8);
+    TEST_ASSERT_EQUAL(PixelPacketResult::Ignored, receiver.handlePacket(packet.data(), packet.size()));
+    packet = CreateE131SyncPacket(7);
+    TEST_ASSERT_EQUAL(PixelPacketResult::Displayed, receiver.handlePacket(packet.data(), packet.size()));
+
+    // Without sync address, out of order and unknown universes
+    packet = CreateE131DataPacket(1, 5, 0, {1, 2, 3});
+    TEST_ASSERT_EQUAL(PixelPacketResult::Displayed, receiver.handlePacket(packet.data(), packet.size()));
+    TEST_ASSERT_TRUE(strip0.getLed(0) == RGBW(1, 2, 3));
+
+    packet = CreateE131DataPacket(1, 4, 0, {4, 5, 6});
+    TEST_ASSERT_EQUAL(PixelPacketResult::Ignored, receiver.handlePacket(packet.data(), packet.size()));
+    TEST_ASSERT_TRUE(strip0.getLed(0) == RGBW(1, 2, 3));
+
+    packet = CreateE131DataPacket(4, 1, 0, {4, 5, 6});
+    TEST_ASSERT_EQUAL(PixelPacketResult::Ignored, receiver.handlePacket(packet.data(), packet.size()));
+
+    packet[5] = 'X';
+    TEST_ASSERT_EQUAL(PixelPacketResult::Invalid, receiver.handlePacket(packet.data(), packet.size()));
+}
+
+int main() {
+    UNITY_BEGIN();
+    RUN_TEST(test_target_segments);
+    RUN_TEST(test_target_keeps_active_count);
+    RUN_TEST(test_target_keeps_setled_semantics);
+    RUN_TEST(test_ddp);
+    RUN_TEST(test_e131_universes_and_sync);
+    return UNITY_END();
+}
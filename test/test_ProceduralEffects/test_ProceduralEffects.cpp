@@ -0,0 +1,128 @@
+#include <unity.h>
+#include "LedBufferStorage.h"
+#include "ProceduralEffects.h"
+
+static void test_noise_is_smooth() {
+    TEST_ASSERT_EQUAL(Noise8(1000, 2000), Noise8(1000, 2000));
+
+    // Lattice points are the hash values, neighbours differ only slightly
+    TEST_ASSERT_EQUAL(Hash8(3, 5), Noise8(3 << 8, 5 << 8));
+
+    for (uint32_t x = 0; x < 4096; ++x) {
+        int16_t difference = int16_t(Noise8(x + 1, 300)) - int16_t(Noise8(x, 300));
+        TEST_ASSERT_TRUE(difference >= -4 && difference <= 4);
+    }
+}
+
+static void test_chase_moves_continuously() {
+    LedBufferStorage strip(8);
+    AnimationManager animationManager;
+
+    // 4 leds spacing, 1 led wide, 10 leds per second
+    animationManager.addAnimation(new ChaseEffect(0, 0, strip, COLOR_RED, COLOR_OFF, 4, 1, 10));
+
+    animationManager.update(0);
+    TEST_ASSERT_TRUE(strip.getLed(0) == COLOR_RED);
+    TEST_ASSERT_TRUE(strip.getLed(1) == COLOR_OFF);
+    TEST_ASSERT_TRUE(strip.getLed(4) == COLOR_RED);
+
+    // Half way between led 0 and 1
+    animationManager.update(50);
+    TEST_ASSERT_EQUAL(128, strip.getLed(0).r);
+    TEST_ASSERT_EQUAL(128, strip.getLed(1).r);
+
+    animationManager.update(100);
+    TEST_ASSERT_TRUE(strip.getLed(0) == COLOR_OFF);
+    TEST_ASSERT_TRUE(strip.getLed(1) == COLOR_RED);
+    TEST_ASSERT_FALSE(animationManager.empty());
+}
+
+static void test_comet_and_range() {
+    LedBufferStorage strip(20);
+    CometEffect comet(0, 0, strip, COLOR_BLUE, COLOR_OFF, 4, 1000, 10, 10);
+
+    strip.setAll(COLOR_GREEN);
+
+    // Head at led 5 of the range (led 15 of the strip)
+    comet.update(5);
+    TEST_ASSERT_TRUE(strip.getLed(9) == COLOR_GREEN);
+    TEST_ASSERT_TRUE(strip.getLed(15) == COLOR_BLUE);
+    TEST_ASSERT_TRUE(strip.getLed(14).b > 0 && strip.getLed(14).b < 255);
+    TEST_ASSERT_TRUE(strip.getLed(11) == COLOR_OFF);
+    TEST_ASSERT_TRUE(strip.getLed(16) == COLOR_OFF);
+}
+
+static void test_range_is_clamped() {
+    LedBufferStorage strip(10);
+
+    // Ends at the last led of the strip
+    ChaseEffect chase(0, 0, strip, COLOR_RED, COLOR_GREEN, 4, 1, 10, 8, 5);
+    chase.update(0);
+    TEST_ASSERT_TRUE(strip.getLed(7) == COLOR_OFF);
+    TEST_ASSERT_TRUE(strip.getLed(8) == COLOR_RED);
+    TEST_ASSERT_TRUE(strip.getLed(9) == COLOR_GREEN);
+
+    // Starts behind the strip, renders nothing
+    FireEffect fire(0, 0, strip, 4, 160, 12);
+    fire.update(100);
+    for (ledoffset_t i = 0; i < 8; ++i) {
+        TEST_ASSERT_TRUE(strip.getLed(i) == COLOR_OFF);
+    }
+    TEST_ASSERT_TRUE(strip.getLed(8) == COLOR_RED);
+    TEST_ASSERT_TRUE(strip.getLed(9) == COLOR_GREEN);
+}
+
+static void test_keeps_active_count() {
+    LedBufferStorage strip(16);
+    AnimationManager animationManager;
+
+    // 2 of every 4 leds lit
+    animationManager.addAnimation(new ChaseEffect(0, 0, strip, COLOR_RED, COLOR_OFF, 4, 2, 0));
+
+    // Rendered into the pixel buffer, counted once when the manager flushes the strip
+    animationManager.update(10);
+    TEST_ASSERT_TRUE(strip.isActiveCountValid());
+    TEST_ASSERT_EQUAL(8, strip.activeCount());
+
+    animationManager.clear();
+    strip.setLed(0, COLOR_OFF);
+    TEST_ASSERT_EQUAL(7, strip.activeCount());
+}
+
+static void test_fire_and_twinkle_ranges() {
+    LedBufferStorage strip(60);
+    FireEffect fire(0, 0, strip);
+    TwinkleEffect twinkle(0, 0, strip, COLOR_WWHITE, COLOR_OFF, 128, 500);
+
+    fire.update(1234);
+
+    // Fire colors have no blue without red and green at full brightness
+    for (ledoffset_t i = 0; i < strip.getLedCount(); ++i) {
+        RGBW color = strip.getLed(i);
+        TEST_ASSERT_TRUE(color.b == 0 || (color.r == 255 && color.g == 255));
+        TEST_ASSERT_TRUE(color.g == 0 || color.r == 255);
+    }
+
+    // Fully cooled at the end
+    TEST_ASSERT_TRUE(strip.getLed(59) == COLOR_OFF);
+
+    size_t lit = 0;
+    twinkle.update(777);
+
+    for (ledoffset_t i = 0; i < strip.getLedCount(); ++i) {
+        lit += strip.getLed(i).w > 0;
+    }
+
+    TEST_ASSERT_TRUE(lit > 5 && lit < 55);
+}
+
+int main() {
+    UNITY_BEGIN();
+    RUN_TEST(test_noise_is_smooth);
+    RUN_TEST(test_chase_moves_continuously);
+    RUN_TEST(test_comet_and_range);
+    RUN_TEST(test_range_is_clamped);
+    RUN_TEST(test_keeps_active_count);
+    RUN_TEST(test_fire_and_twinkle_ranges);
+    return UNITY_END();
+}
@@ -1,5 +1,8 @@
 #include <unity.h>
 #include "RGBW.h"
+#include "ColorKernels.h"
+#include "ColorParser.h"
+#include "LedBufferStorage.h"
 
 static void assert_rgbw_equal(const RGBW& a, const RGBW& b) {
     TEST_ASSERT_TRUE(a == b);
@@ -121,6 +124,116 @@ void test_with_total_brightness_small_values() {
     assert_rgbw_equal(RGBW(), b_0);
 }
 
+static void test_hsv_conversion() {
+    assert_rgbw_equal(COLOR_RED, RGBW::FromHSV(HSV(0, 255, 255)));
+    assert_rgbw_equal(RGBW(0, 255, 4), RGBW::FromHSV(HSV(86, 255, 255)));
+    assert_rgbw_equal(RGBW(128, 128, 128), RGBW::FromHSV(HSV(123, 0, 128)));
+    assert_rgbw_equal(RGBW(0, 0, 0, 128), RGBW::FromHSV(HSV(123, 0, 128), true));
+    assert_rgbw_equal(RGBW(127, 0, 0, 128), RGBW(255, 128, 128).getWithWhiteExtracted());
+
+    // Roundtrip of saturated colors
+    for (uint16_t h = 0; h < 256; ++h) {
+        HSV hsv = RGBW::FromHSV(HSV(h, 255, 200)).toHSV();
+
+        TEST_ASSERT_INT_WITHIN(1, h, hsv.h);
+        TEST_ASSERT_INT_WITHIN(1, 255, hsv.s);
+        TEST_ASSERT_INT_WITHIN(1, 200, hsv.v);
+    }
+
+    HSV blue = RGBW(0, 0, 100, 50).toHSV();
+    TEST_ASSERT_INT_WITHIN(1, 170, blue.h);
+    TEST_ASSERT_EQUAL(150, blue.v);
+}
+
+static void test_hsl_conversion() {
+    RGBW red = RGBW::FromHSL(HSL(0, 255, 128));
+    TEST_ASSERT_EQUAL(255, red.r);
+    TEST_ASSERT_INT_WITHIN(1, 0, red.g);
+    TEST_ASSERT_INT_WITHIN(1, 0, red.b);
+    assert_rgbw_equal(COLOR_KWHITE, RGBW::FromHSL(HSL(0, 0, 255)));
+
+    HSL hsl = RGBW(0, 0, 255).toHSL();
+    TEST_ASSERT_INT_WITHIN(1, 170, hsl.h);
+    TEST_ASSERT_EQUAL(255, hsl.s);
+    TEST_ASSERT_EQUAL(128, hsl.l);
+}
+
+static void test_hue_kernels() {
+    LedBufferStorage strip(12);
+
+    FillRainbow(strip, 0);
+    assert_rgbw_equal(COLOR_RED, strip.getLed(0));
+    assert_rgbw_equal(RGBW::FromHSV(HSV((6 * (0x10000 / 12)) >> 8, 255, 255)), strip.getLed(6));
+
+    RotateHue(strip, 85);
+    HSV rotated = strip.getLed(0).toHSV();
+    TEST_ASSERT_INT_WITHIN(1, 85, rotated.h);
+}
+
+static constexpr RGBW ParseNamedColorConstexpr(std::string_view name) {
+    RGBW color(1, 2, 3, 4);
+    FindNamedColor(name, color);
+    return color;
+}
+
+static_assert(ParseNamedColorConstexpr("TURQUOISE") == COLOR_TURQUOISE, "Named colors must be resolvable at compile time");
+
+static void test_color_parser() {
+    RGBW color;
+
+    // Same results as the map based parser for all named colors
+    for (const NamedColor& entry : NamedColorTable) {
+        TEST_ASSERT_TRUE(ParseColor(entry.name, color));
+        assert_rgbw_equal(entry.color, color);
+    }
+
+    TEST_ASSERT_TRUE(ParseColor("mAgEnTa", color));
+    assert_rgbw_equal(COLOR_MAGENTA, color);
+
+    RGBW expected;
+    TEST_ASSERT_TRUE(ParseNamedColor("white*0.25", expected));
+    TEST_ASSERT_TRUE(ParseColor("white*0.25", color));
+    assert_rgbw_equal(expected, color);
+    TEST_ASSERT_TRUE(ParseColor("red*.5", color));
+    TEST_ASSERT_EQUAL(127, color.r);
+    TEST_ASSERT_TRUE(ParseColor("red*2", color));
+    assert_rgbw_equal(COLOR_RED, color);
+
+    TEST_ASSERT_TRUE(ParseColor("#102030", color));
+    assert_rgbw_equal(RGBW(0x10, 0x20, 0x30, 0), color);
+    TEST_ASSERT_TRUE(ParseColor("#a0B0c0FF", color));
+    assert_rgbw_equal(RGBW(0xA0, 0xB0, 0xC0, 0xFF), color);
+
+    TEST_ASSERT_FALSE(ParseColor("", color));
+    TEST_ASSERT_FALSE(ParseColor("redd", color));
+    TEST_ASSERT_FALSE(ParseColor("red*", color));
+    TEST_ASSERT_FALSE(ParseColor("red*0.5x", color));
+    TEST_ASSERT_FALSE(ParseColor("#12345", color));
+    TEST_ASSERT_FALSE(ParseColor("#12345G", color));
+}
+
+static void test_color_ranges() {
+    LedBufferStorage strip(10);
+
+    TEST_ASSERT_TRUE(ApplyColorRanges(strip, "all=blue; 0-2=red, 4=#00FF00 ,8-200=off"));
+    assert_rgbw_equal(COLOR_RED, strip.getLed(2));
+    assert_rgbw_equal(COLOR_BLUE, strip.getLed(3));
+    assert_rgbw_equal(COLOR_GREEN, strip.getLed(4));
+    assert_rgbw_equal(COLOR_BLUE, strip.getLed(7));
+    assert_rgbw_equal(COLOR_OFF, strip.getLed(9));
+
+    // Invalid batches are not applied at all
+    TEST_ASSERT_FALSE(ApplyColorRanges(strip, "0-9=red,5-3=blue"));
+    TEST_ASSERT_FALSE(ApplyColorRanges(strip, "0=red,x=blue"));
+    assert_rgbw_equal(COLOR_BLUE, strip.getLed(5));
+
+    ColorRange range;
+    TEST_ASSERT_TRUE(ParseColorRange("3-5=wwhite*0.5", range));
+    TEST_ASSERT_EQUAL(3, range.first);
+    TEST_ASSERT_EQUAL(3, range.count);
+    TEST_ASSERT_EQUAL(127, range.color.w);
+}
+
 int main() {
     UNITY_BEGIN();
     RUN_TEST(test_default_constructor);
@@ -134,5 +247,10 @@ int main() {
     RUN_TEST(test_total_brightness);
     RUN_TEST(test_with_total_brightness);
     RUN_TEST(test_with_total_brightness_small_values);
+    RUN_TEST(test_hsv_conversion);
+    RUN_TEST(test_hsl_conversion);
+    RUN_TEST(test_hue_kernels);
+    RUN_TEST(test_color_parser);
+    RUN_TEST(test_color_ranges);
     return UNITY_END();
 }
@@ -0,0 +1,124 @@
+#include <unity.h>
+#include "LedBufferStorage.h"
+#include "SceneCompiler.h"
+
+static void test_fade_and_wait() {
+    LedBufferStorage strip(10);
+    SceneCompiler compiler;
+    SceneVM vm(strip);
+    std::vector<uint8_t> code;
+
+    TEST_ASSERT_TRUE(compiler.compile(
+        "# fade the first half, then fill the rest\n"
+        "fill off\n"
+        "fade 0 5 off #FF000000 1s\n"
+        "wait 1000\n"
+        "fill 5 0 blue\n", code));
+    TEST_ASSERT_TRUE(vm.load(code.data(), code.size(), 100));
+    TEST_ASSERT_EQUAL(1000, vm.getDuration());
+
+    vm.render(600);
+    TEST_ASSERT_EQUAL(127, strip.getLed(0).r);
+    TEST_ASSERT_EQUAL(127, strip.getLed(4).r);
+    TEST_ASSERT_TRUE(strip.getLed(5) == COLOR_OFF);
+    TEST_ASSERT_FALSE(vm.isFinished(600));
+
+    vm.render(1100);
+    TEST_ASSERT_TRUE(strip.getLed(0) == COLOR_RED);
+    TEST_ASSERT_TRUE(strip.getLed(5) == COLOR_BLUE);
+    TEST_ASSERT_TRUE(strip.getLed(9) == COLOR_BLUE);
+    TEST_ASSERT_TRUE(vm.isFinished(1100));
+}
+
+static void test_loops() {
+    LedBufferStorage strip(4);
+    SceneCompiler compiler;
+    SceneVM vm(strip);
+    std::vector<uint8_t> code;
+
+    TEST_ASSERT_TRUE(compiler.compile(
+        "loop 3\n"
+        "  fill red\n"
+        "  wait 100\n"
+        "  fade red blue 100 in\n"
+        "  wait 100\n"
+        "end\n"
+        "fill green\n", code));
+    TEST_ASSERT_TRUE(vm.load(code.data(), code.size()));
+    TEST_ASSERT_EQUAL(600, vm.getDuration());
+
+    // Second iteration, half way through the eased fade
+    vm.render(350);
+    TEST_ASSERT_EQUAL(192, strip.getLed(0).r);
+    TEST_ASSERT_EQUAL(63, strip.getLed(0).b);
+
+    vm.render(450);
+    TEST_ASSERT_TRUE(strip.getLed(0) == COLOR_RED);
+
+    vm.render(600);
+    TEST_ASSERT_TRUE(strip.getLed(3) == COLOR_GREEN);
+
+    // Endless loops never finish, the work per frame stays constant
+    TEST_ASSERT_TRUE(compiler.compile("loop\nfill red\nwait 10\nfill blue\nwait 10\nend\nfill green\n", code));
+    TEST_ASSERT_TRUE(vm.load(code.data(), code.size()));
+    TEST_ASSERT_EQUAL(SceneBytecode::DURATION_INFINITE, vm.getDuration());
+
+    vm.render(4000000015u);
+    TEST_ASSERT_TRUE(strip.getLed(0) == COLOR_BLUE);
+    TEST_ASSERT_FALSE(vm.isFinished(4000000015u));
+}
+
+static void test_rainbow_and_dim() {
+    LedBufferStorage strip(12);
+    SceneCompiler compiler;
+    SceneVM vm(strip);
+    std::vector<uint8_t> code;
+
+    TEST_ASSERT_TRUE(compiler.compile("rainbow\ndim 0 6 128\n", code));
+    TEST_ASSERT_TRUE(vm.load(code.data(), code.size()));
+    vm.render(0);
+
+    RGBW expected[12];
+    FillHueGradient(expected, 12, 0, 0x10000 / 12);
+
+    TEST_ASSERT_EQUAL(Scale8(expected[0].r, 128), strip.getLed(0).r);
+    TEST_ASSERT_TRUE(strip.getLed(6) == expected[6]);
+    TEST_ASSERT_TRUE(strip.getLed(11) == expected[11]);
+}
+
+static void test_errors() {
+    SceneCompiler compiler;
+    std::vector<uint8_t> code;
+
+    TEST_ASSERT_FALSE(compiler.compile("fill red\nblink red\n", code));
+    TEST_ASSERT_EQUAL(2, compiler.getErrorLine());
+    TEST_ASSERT_FALSE(compiler.compile("fade red blue\n", code));
+    TEST_ASSERT_FALSE(compiler.compile("fill #12345\n", code));
+    TEST_ASSERT_FALSE(compiler.compile("loop 2\nfill red\n", code));
+    TEST_ASSERT_FALSE(compiler.compile("end\n", code));
+    TEST_ASSERT_FALSE(compiler.compile("wait nan\n", code));
+    TEST_ASSERT_FALSE(compiler.compile("wait infs\n", code));
+    TEST_ASSERT_FALSE(compiler.compile("fade red blue -nan\n", code));
+    TEST_ASSERT_FALSE(compiler.compile("wait 5000000s\n", code));
+
+    // Corrupted bytecode is rejected by the VM
+    LedBufferStorage strip(4);
+    SceneVM vm(strip);
+
+    TEST_ASSERT_TRUE(compiler.compile("loop 2\nfill red\nwait 5\nend\n", code));
+    code[SceneBytecode::HEADER_SIZE + 2] = 0xFF;
+    TEST_ASSERT_FALSE(vm.load(code.data(), code.size()));
+    TEST_ASSERT_FALSE(vm.render(0));
+
+    code.resize(code.size() - 1);
+    TEST_ASSERT_FALSE(vm.load(code.data(), code.size()));
+}
+
+int main() {
+    UNITY_BEGIN();
+    RUN_TEST(test_fade_and_wait);
+    RUN_TEST(test_loops);
+    RUN_TEST(test_rainbow_and_dim);
+    RUN_TEST(test_errors);
+    return UNITY_END();
+}
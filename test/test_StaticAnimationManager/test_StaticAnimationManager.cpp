@@ -0,0 +1,80 @@
+#include <unity.h>
+#include "StaticAnimationManager.h"
+#include "StaticLedBufferStorage.h"
+#include "LedStrip_APA102.h"
+#include "LedStrip_LPD8806.h"
+
+static void test_static_led_buffer_storage() {
+    StaticLedBufferStorage<8> strip;
+
+    TEST_ASSERT_EQUAL(8, strip.getLedCount());
+    TEST_ASSERT_TRUE(strip.getLed(7) == COLOR_OFF);
+
+    strip.setRange(2, 3, COLOR_RED);
+    TEST_ASSERT_TRUE(strip.getPixelBuffer()[4] == COLOR_RED);
+    TEST_ASSERT_TRUE((void*)strip.getPixelBuffer() > (void*)&strip);
+    TEST_ASSERT_TRUE((void*)strip.getPixelBuffer() < (void*)(&strip + 1));
+
+    // Copies use their own buffer
+    StaticLedBufferStorage<8> copy(strip);
+    copy.setLed(2, COLOR_BLUE);
+    TEST_ASSERT_TRUE(copy.getLed(3) == COLOR_RED);
+    TEST_ASSERT_TRUE(strip.getLed(2) == COLOR_RED);
+
+    copy = strip;
+    TEST_ASSERT_TRUE(copy.getLed(2) == COLOR_RED);
+
+    LedBufferStorage dynamicCopy(strip);
+    strip.clear();
+    TEST_ASSERT_TRUE(dynamicCopy.getLed(2) == COLOR_RED);
+}
+
+static void test_static_drivers() {
+    StaticLedStrip_APA102<4> apa102(1, 2);
+
+    TEST_ASSERT_EQUAL(APA102Encoding::GetBufferSize(4), apa102.getWireBufferSize());
+    apa102.setLed(1, RGBW(1, 2, 3, 0));
+    TEST_ASSERT_TRUE(apa102.getLed(1) == RGBW(1, 2, 3, 0));
+
+    StaticLedStrip_LPD8806<4> lpd8806(1, 2);
+
+    lpd8806.setLed(3, RGBW(255, 0, 0, 255), true);
+    TEST_ASSERT_TRUE(lpd8806.getLed(3) == COLOR_RED);
+    TEST_ASSERT_EQUAL(LPD8806Encoding::GetGammaTable()[255], lpd8806.getWireBuffer()[3 * 3]);
+}
+
+static void test_static_animation_manager() {
+    StaticLedBufferStorage<4> strip;
+    StaticAnimationManager<2> animationManager;
+
+    TEST_ASSERT_NOT_NULL(animationManager.emplaceAnimation<FadeAnimation>(0, 100, strip, 0, COLOR_OFF, COLOR_RED));
+    TEST_ASSERT_NOT_NULL(animationManager.emplaceAnimation<FadeAnimation>(50, 100, strip, 1, COLOR_OFF, COLOR_BLUE));
+    TEST_ASSERT_NULL(animationManager.emplaceAnimation<FadeAnimation>(0, 100, strip, 2, COLOR_OFF, COLOR_BLUE));
+    TEST_ASSERT_EQUAL(2, animationManager.size());
+
+    animationManager.update(50);
+    TEST_ASSERT_EQUAL(127, strip.getLed(0).r);
+    TEST_ASSERT_TRUE(strip.getLed(1) == COLOR_OFF);
+
+    // The first animation finished, its slot can be reused
+    animationManager.update(101);
+    TEST_ASSERT_TRUE(strip.getLed(0) == COLOR_RED);
+    TEST_ASSERT_EQUAL(1, animationManager.size());
+    TEST_ASSERT_NOT_NULL(animationManager.emplaceAnimation<BlinkAnimation>(200, 2, strip, 3, COLOR_NWHITE));
+
+    animationManager.update(200);
+    TEST_ASSERT_TRUE(strip.getLed(1) == COLOR_BLUE);
+    TEST_ASSERT_TRUE(strip.getLed(3) == COLOR_NWHITE);
+    TEST_ASSERT_EQUAL(1, animationManager.size());
+
+    animationManager.clear();
+    TEST_ASSERT_TRUE(animationManager.empty());
+}
+
+int main() {
+    UNITY_BEGIN();
+    RUN_TEST(test_static_led_buffer_storage);
+    RUN_TEST(test_static_drivers);
+    RUN_TEST(test_static_animation_manager);
+    return UNITY_END();
+}
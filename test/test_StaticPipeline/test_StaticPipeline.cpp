@@ -0,0 +1,94 @@
+#include <unity.h>
+#include "StaticPipeline.h"
+#include "FusedRenderPipeline.h"
+#include "LedStrip_Simulated.h"
+
+static constexpr LedPowerConsumptionInfo CONSUMPTION(1.f, 20.f, 20.f);
+
+static void test_inverse_and_brightness() {
+    LedStrip_Simulated output(4, LedWireProtocol::APA102);
+    StaticPipeline<WireOutputSink<APA102Encoding, 4>, InverseStage, BrightnessStage> pipeline(output);
+
+    pipeline.getStage<BrightnessStage>().brightness = 127;
+    pipeline.setLed(0, RGBW(255, 0, 0, 0));
+    pipeline.setLed(3, RGBW(0, 0, 254, 0));
+    pipeline.render();
+
+    TEST_ASSERT_TRUE(APA102Encoding::DecodeLed(output.getWireBuffer(), 3) == RGBW(127, 0, 0, 0));
+    TEST_ASSERT_TRUE(APA102Encoding::DecodeLed(output.getWireBuffer(), 0) == RGBW(0, 0, 127, 0));
+    TEST_ASSERT_EQUAL(1, output.getFrameCount());
+}
+
+static void test_wire_buffer_size_mismatch() {
+    LedStrip_Simulated output(8, LedWireProtocol::APA102);
+    StaticPipeline<WireOutputSink<APA102Encoding, 16>, BrightnessStage> pipeline(output);
+
+    // The driver has only 8 leds, the pipeline must not write beyond its wire buffer
+    TEST_ASSERT_FALSE(pipeline.getOutput().isValid());
+
+    pipeline.setAll(COLOR_RED);
+    pipeline.render();
+
+    TEST_ASSERT_EQUAL(0, output.getFrameCount());
+    TEST_ASSERT_TRUE(APA102Encoding::DecodeLed(output.getWireBuffer(), 7) == COLOR_OFF);
+}
+
+static void test_power_limit_matches_fused_pipeline() {
+    LedStrip_Simulated staticOutput(16, LedWireProtocol::APA102);
+    StaticPipeline<WireOutputSink<APA102Encoding, 16>, PowerLimitStage<CONSUMPTION, 300>> pipeline(staticOutput);
+
+    LedStrip_Simulated fusedOutput(16, LedWireProtocol::APA102);
+    LedBufferStorage source(16);
+    FusedRenderPipeline fused(fusedOutput, source);
+    fused.setPowerLimit(CONSUMPTION, 300.f);
+
+    for (ledoffset_t i = 0; i < 16; ++i) {
+        RGBW color(i * 16, 255 - i * 16, 128, i * 8);
+        pipeline.setLed(i, color);
+        source.setLed(i, color);
+    }
+
+    pipeline.render();
+    fused.render();
+
+    PowerLimitStage<CONSUMPTION, 300>& stage = pipeline.getStage<PowerLimitStage<CONSUMPTION, 300>>();
+    TEST_ASSERT_GREATER_THAN(0, stage.getScale());
+    TEST_ASSERT_TRUE(stage.getScale() < 256);
+    TEST_ASSERT_EQUAL(fused.getPowerScale(), stage.getScale());
+    TEST_ASSERT_EQUAL_MEMORY(fusedOutput.getWireBuffer(), staticOutput.getWireBuffer(), fusedOutput.getWireBufferSize());
+
+    // Without limit the colors pass unchanged
+    stage.setPowerLimit(100000.f);
+    pipeline.render();
+    TEST_ASSERT_EQUAL(256, stage.getScale());
+    TEST_ASSERT_TRUE(APA102Encoding::DecodeLed(staticOutput.getWireBuffer(), 5) == RGBW(80, 175, 128, 0));
+}
+
+static void test_led_strip_adapter() {
+    StaticPipeline<StaticWireBuffer<WS2812Encoding<true>, 12>, InverseStage> pipeline;
+    StaticPipelineLedStrip<decltype(pipeline)> strip(pipeline);
+
+    TEST_ASSERT_EQUAL(12, strip.getLedCount());
+    TEST_ASSERT_TRUE(strip.getPixelBuffer() == pipeline.getPixels());
+
+    FillRainbow(strip, 0);
+    strip.setLed(11, RGBW(1, 2, 3, 4), true);
+
+    const uint8_t* wire = pipeline.getOutput().getWireBuffer();
+
+    // GRBW order, led 11 is the first on the wire
+    TEST_ASSERT_EQUAL(2, wire[0]);
+    TEST_ASSERT_EQUAL(1, wire[1]);
+    TEST_ASSERT_EQUAL(3, wire[2]);
+    TEST_ASSERT_EQUAL(4, wire[3]);
+    TEST_ASSERT_EQUAL(255, wire[11 * 4 + 1]);
+}
+
+int main() {
+    UNITY_BEGIN();
+    RUN_TEST(test_inverse_and_brightness);
+    RUN_TEST(test_wire_buffer_size_mismatch);
+    RUN_TEST(test_power_limit_matches_fused_pipeline);
+    RUN_TEST(test_led_strip_adapter);
+    return UNITY_END();
+}
@@ -0,0 +1,354 @@
+#include <unity.h>
+#include "LedBufferStorage.h"
+#include "VirtualLedStrip.h"
+#include "VirtualFlattenedLedStrip.h"
+#include "VirtualMatrixLedStrip.h"
+#include "VirtualWhiteExtractionLedStrip.h"
+#include "VirtualLedStripWithPowerLimit.h"
+
+static void test_inversed_bulk_calls() {
+    LedBufferStorage strip(40);
+    VirtualInversedLedStrip inversed(strip);
+    RGBW colors[36];
+
+    for (ledoffset_t i = 0; i < 36; ++i) {
+        colors[i] = RGBW(i, 0, 0, 0);
+    }
+
+    // More than one chunk
+    inversed.setLeds(2, colors, 36);
+
+    for (ledoffset_t i = 0; i < 36; ++i) {
+        TEST_ASSERT_TRUE(strip.getLed(37 - i) == colors[i]);
+    }
+
+    RGBW output[36];
+    inversed.getLeds(2, output, 36);
+    TEST_ASSERT_EQUAL_MEMORY(colors, output, sizeof(colors));
+}
+
+static void test_resolve_led_through_chain() {
+    LedBufferStorage strip0(4);
+    LedBufferStorage strip1(6);
+    VirtualMultiLedStrip2 multi(strip0, strip1);
+    VirtualInversedLedStrip inversed(multi);
+
+    ledoffset_t index = 0;
+    ILedStripWithStorage& leaf = inversed.resolveLed(index);
+
+    TEST_ASSERT_TRUE(&leaf == &strip1);
+    TEST_ASSERT_EQUAL(5, index);
+
+    index = 9;
+    TEST_ASSERT_TRUE(&inversed.resolveLed(index) == &strip0);
+    TEST_ASSERT_EQUAL(0, index);
+}
+
+static void test_flattened_matches_chain() {
+    LedBufferStorage strip0(4);
+    LedBufferStorage strip1(6);
+    VirtualMultiLedStrip2 multi(strip0, strip1);
+    VirtualMappedLedStrip mapped(multi, {1, 3, 5, 7, 9, 8, 2});
+    VirtualInversedLedStrip inversed(mapped);
+    VirtualPassthroughLedStrip chain(inversed);
+
+    VirtualFlattenedLedStrip flat(chain);
+
+    TEST_ASSERT_EQUAL(chain.getLedCount(), flat.getLedCount());
+
+    for (ledoffset_t i = 0; i < flat.getLedCount(); ++i) {
+        flat.setLed(i, RGBW(i + 1, 0, 0, 0));
+    }
+
+    for (ledoffset_t i = 0; i < chain.getLedCount(); ++i) {
+        TEST_ASSERT_TRUE(chain.getLed(i) == RGBW(i + 1, 0, 0, 0));
+        TEST_ASSERT_TRUE(flat.getLed(i) == chain.getLed(i));
+    }
+}
+
+static void test_flattened_regular_mapping_uses_runs() {
+    LedBufferStorage strip0(8);
+    LedBufferStorage strip1(8);
+    VirtualMultiLedStrip2 multi(strip0, strip1);
+    VirtualInversedLedStrip inversed(multi);
+
+    VirtualFlattenedLedStrip flat(inversed);
+
+    TEST_ASSERT_EQUAL(2, flat.getRunCount());
+
+    flat.setRange(6, 4, COLOR_RED);
+
+    for (ledoffset_t i = 0; i < inversed.getLedCount(); ++i) {
+        bool inRange = i >= 6 && i < 10;
+        TEST_ASSERT_TRUE(inversed.getLed(i) == (inRange ? COLOR_RED : COLOR_OFF));
+    }
+}
+
+static void test_mapped_regular_mapping_uses_runs() {
+    LedBufferStorage strip(32);
+
+    // 0..9, reversed 20..11, every 3rd led from 21
+    std::vector<ledoffset_t> indices;
+    for (ledoffset_t i = 0; i < 10; ++i) indices.push_back(i);
+    for (ledoffset_t i = 20; i > 10; --i) indices.push_back(i);
+    for (ledoffset_t i = 21; i < 32; i += 3) indices.push_back(i);
+
+    VirtualMappedLedStrip mapped(strip, indices);
+
+    TEST_ASSERT_EQUAL(indices.size(), mapped.getLedCount());
+    TEST_ASSERT_EQUAL(3, mapped.getRunCount());
+
+    for (ledoffset_t i = 0; i < mapped.getLedCount(); ++i) {
+        mapped.setLed(i, RGBW(i + 1, 0, 0, 0));
+        TEST_ASSERT_TRUE(strip.getLed(indices[i]) == RGBW(i + 1, 0, 0, 0));
+    }
+
+    RGBW colors[16];
+    for (ledoffset_t i = 0; i < 16; ++i) colors[i] = RGBW(0, i + 1, 0, 0);
+
+    mapped.setLeds(5, colors, 16);
+    mapped.setRange(0, 2, COLOR_BLUE);
+
+    RGBW output[24];
+    mapped.getLeds(0, output, 24);
+
+    for (ledoffset_t i = 0; i < 24; ++i) {
+        RGBW expected = RGBW(i + 1, 0, 0, 0);
+
+        if (i < 2) expected = COLOR_BLUE;
+        else if (i >= 5 && i < 21) expected = colors[i - 5];
+
+        TEST_ASSERT_TRUE(strip.getLed(indices[i]) == expected);
+        TEST_ASSERT_TRUE(output[i] == expected);
+    }
+}
+
+static void test_mapped_irregular_mapping_keeps_indices() {
+    LedBufferStorage strip(8);
+    VirtualMappedLedStrip mapped(strip, {3, 0, 7, 1, 6, 2});
+
+    TEST_ASSERT_EQUAL(0, mapped.getRunCount());
+
+    mapped.setRange(1, 3, COLOR_RED);
+
+    TEST_ASSERT_TRUE(strip.getLed(3) == COLOR_OFF);
+    TEST_ASSERT_TRUE(strip.getLed(0) == COLOR_RED);
+    TEST_ASSERT_TRUE(strip.getLed(7) == COLOR_RED);
+    TEST_ASSERT_TRUE(strip.getLed(1) == COLOR_RED);
+    TEST_ASSERT_TRUE(strip.getLed(6) == COLOR_OFF);
+}
+
+static void test_matrix_serpentine_offsets() {
+    LedBufferStorage strip(12);
+    std::unique_ptr<VirtualMatrixLedStrip> matrix = VirtualMatrixLedStrip::Create(strip, 4, 3, MatrixLayout::RowMajorSerpentine);
+
+    TEST_ASSERT_EQUAL(0, matrix->getOffset(0, 0));
+    TEST_ASSERT_EQUAL(3, matrix->getOffset(3, 0));
+    TEST_ASSERT_EQUAL(7, matrix->getOffset(0, 1));
+    TEST_ASSERT_EQUAL(4, matrix->getOffset(3, 1));
+    TEST_ASSERT_EQUAL(8, matrix->getOffset(0, 2));
+
+    std::unique_ptr<VirtualMatrixLedStrip> columns = VirtualMatrixLedStrip::Create(strip, 4, 3, MatrixLayout::ColumnMajorSerpentine);
+
+    TEST_ASSERT_EQUAL(2, columns->getOffset(0, 2));
+    TEST_ASSERT_EQUAL(5, columns->getOffset(1, 0));
+    TEST_ASSERT_EQUAL(3, columns->getOffset(1, 2));
+}
+
+static void test_matrix_size_is_checked() {
+    LedBufferStorage strip(255);
+
+    // 256 and more leds do not fit into ledoffset_t
+    TEST_ASSERT_NULL(VirtualMatrixLedStrip::Create(strip, 16, 16).get());
+    TEST_ASSERT_NULL(VirtualMatrixLedStrip::Create(strip, 64, 64).get());
+    TEST_ASSERT_NULL(VirtualMatrixLedStrip::Create(strip, 256, 1).get());
+    TEST_ASSERT_NULL(VirtualMatrixLedStrip::Create(strip, 0, 10).get());
+
+    std::unique_ptr<VirtualMatrixLedStrip> matrix = VirtualMatrixLedStrip::Create(strip, 15, 17, MatrixLayout::ColumnMajorSerpentine);
+
+    TEST_ASSERT_NOT_NULL(matrix.get());
+    TEST_ASSERT_EQUAL(15, matrix->getWidth());
+    TEST_ASSERT_EQUAL(17, matrix->getHeight());
+    TEST_ASSERT_EQUAL(255, matrix->getLedCount());
+
+    // Larger than the base strip
+    LedBufferStorage small(11);
+    TEST_ASSERT_NULL(VirtualMatrixLedStrip::Create(small, 4, 3).get());
+}
+
+static void test_matrix_blit_and_scroll() {
+    const MatrixLayout layouts[] = {
+        MatrixLayout::RowMajor,
+        MatrixLayout::ColumnMajor,
+        MatrixLayout::RowMajorSerpentine,
+        MatrixLayout::ColumnMajorSerpentine,
+    };
+
+    for (MatrixLayout layout : layouts) {
+        LedBufferStorage strip(20);
+        std::unique_ptr<VirtualMatrixLedStrip> created = VirtualMatrixLedStrip::Create(strip, 5, 4, layout);
+        VirtualMatrixLedStrip& matrix = *created;
+
+        RGBW frame[20];
+        for (ledoffset_t i = 0; i < 20; ++i) frame[i] = RGBW(i + 1, 0, 0, 0);
+
+        matrix.blit(frame);
+
+        for (ledoffset_t y = 0; y < 4; ++y) {
+            for (ledoffset_t x = 0; x < 5; ++x) {
+                TEST_ASSERT_TRUE(matrix.getPixel(x, y) == frame[y * 5 + x]);
+                TEST_ASSERT_TRUE(strip.getLed(matrix.getOffset(x, y)) == frame[y * 5 + x]);
+            }
+        }
+
+        matrix.fillRect(1, 1, 3, 2, COLOR_GREEN);
+        TEST_ASSERT_TRUE(matrix.getPixel(0, 1) == frame[5]);
+        TEST_ASSERT_TRUE(matrix.getPixel(1, 1) == COLOR_GREEN);
+        TEST_ASSERT_TRUE(matrix.getPixel(3, 2) == COLOR_GREEN);
+        TEST_ASSERT_TRUE(matrix.getPixel(4, 2) == frame[14]);
+
+        matrix.blit(frame);
+        matrix.scrollRows(1, COLOR_BLUE);
+
+        for (ledoffset_t x = 0; x < 5; ++x) {
+            TEST_ASSERT_TRUE(matrix.getPixel(x, 0) == COLOR_BLUE);
+            TEST_ASSERT_TRUE(matrix.getPixel(x, 1) == frame[x]);
+            TEST_ASSERT_TRUE(matrix.getPixel(x, 3) == frame[10 + x]);
+        }
+
+        matrix.scrollRows(-2);
+
+        for (ledoffset_t x = 0; x < 5; ++x) {
+            TEST_ASSERT_TRUE(matrix.getPixel(x, 0) == frame[5 + x]);
+            TEST_ASSERT_TRUE(matrix.getPixel(x, 1) == frame[10 + x]);
+            TEST_ASSERT_TRUE(matrix.getPixel(x, 2) == COLOR_OFF);
+        }
+    }
+}
+
+static void test_white_extraction() {
+    LedBufferStorage output(3);
+    VirtualWhiteExtractionLedStrip neutral(output);
+
+    neutral.setLed(0, RGBW(255, 200, 100));
+    neutral.setLed(1, RGBW(10, 0, 10, 5));
+    neutral.setLed(2, COLOR_KWHITE, true);
+
+    TEST_ASSERT_TRUE(output.getLed(0) == RGBW(155, 100, 0, 100));
+    TEST_ASSERT_TRUE(output.getLed(1) == RGBW(10, 0, 10, 5));
+    TEST_ASSERT_TRUE(output.getLed(2) == COLOR_WWHITE);
+    TEST_ASSERT_TRUE(neutral.getLed(2) == COLOR_KWHITE);
+
+    // Warm white led: only the part matching the white point is replaced
+    VirtualWhiteExtractionLedStrip warm(output, WhitePoint(255, 128, 64));
+    warm.setLed(0, COLOR_KWHITE, true);
+    TEST_ASSERT_TRUE(output.getLed(0) == RGBW(0, 127, 191, 255));
+
+    // Same power budget, more brightness with the white channel
+    const LedPowerConsumptionInfo consumptionInfo(0.f, 20.f, 20.f);
+
+    LedBufferStorage limitedOutput(3);
+    VirtualLedStripWithPowerLimit limited(limitedOutput, consumptionInfo, 3 * 30.f);
+    VirtualWhiteExtractionLedStrip extracted(limited);
+
+    extracted.setAll(COLOR_KWHITE, true);
+    TEST_ASSERT_TRUE(limitedOutput.getLed(0) == COLOR_WWHITE);
+    TEST_ASSERT_TRUE(limited.getCurrentPowerConsumption_mA() <= 3 * 30.f);
+
+    // Without extraction the color channels are dimmed to about half
+    limited.setAll(COLOR_KWHITE, true);
+    TEST_ASSERT_TRUE(limitedOutput.getLed(0).r <= 128);
+}
+
+static void test_active_count() {
+    LedBufferStorage strip0(4);
+    LedBufferStorage strip1(6);
+    VirtualMultiLedStrip2 multi(strip0, strip1);
+
+    TEST_ASSERT_FALSE(multi.isAnyActive());
+
+    strip0.setLed(1, COLOR_RED);
+    strip0.setLed(1, COLOR_BLUE);
+    multi.setRange(2, 4, COLOR_NWHITE);
+    TEST_ASSERT_EQUAL(3, strip0.activeCount());
+    TEST_ASSERT_EQUAL(2, strip1.activeCount());
+    TEST_ASSERT_EQUAL(5, multi.activeCount());
+
+    const RGBW colors[3] = {COLOR_OFF, COLOR_RED, COLOR_OFF};
+    strip1.setLeds(0, colors, 3);
+    TEST_ASSERT_EQUAL(1, strip1.activeCount());
+
+    // Writes via the pixel buffer are counted again on updateLeds(), scans until then
+    strip0.getPixelBuffer()[1] = COLOR_OFF;
+    TEST_ASSERT_FALSE(strip0.isActiveCountValid());
+    TEST_ASSERT_EQUAL(2, strip0.activeCount());
+
+    strip0.updateLeds();
+    TEST_ASSERT_TRUE(strip0.isActiveCountValid());
+    TEST_ASSERT_EQUAL(2, strip0.activeCount());
+
+    strip0.clear();
+    strip1.setLed(1, COLOR_OFF);
+    TEST_ASSERT_FALSE(VirtualInversedLedStrip(multi).isAnyActive());
+
+    // Mapped strips only count their own leds
+    strip1.setLed(5, COLOR_RED);
+    VirtualMappedLedStrip mapped(strip1, {0, 1, 2});
+    TEST_ASSERT_FALSE(mapped.isAnyActive());
+    TEST_ASSERT_EQUAL(1, VirtualPassthroughLedStrip(strip1).activeCount());
+}
+
+static void test_active_count_with_kept_pixel_buffer() {
+    LedBufferStorage strip(8);
+    VirtualInversedLedStrip inversed(strip);
+
+    strip.setLed(7, COLOR_BLUE);
+    TEST_ASSERT_EQUAL(1, strip.activeCount());
+
+    // The flattened strip keeps the pixel buffer and writes through it
+    VirtualFlattenedLedStrip flattened(inversed);
+
+    flattened.setLed(2, COLOR_RED, true);
+    TEST_ASSERT_TRUE(strip.isActiveCountValid());
+    TEST_ASSERT_EQUAL(2, strip.activeCount());
+
+    flattened.setRange(0, 8, COLOR_RED);
+    flattened.updateLeds();
+    TEST_ASSERT_TRUE(strip.isActiveCountValid());
+    TEST_ASSERT_EQUAL(8, strip.activeCount());
+
+    strip.setLed(0, COLOR_OFF);
+    TEST_ASSERT_EQUAL(7, strip.activeCount());
+    TEST_ASSERT_EQUAL(7, flattened.activeCount());
+
+    flattened.setRange(0, 8, COLOR_OFF, true);
+    TEST_ASSERT_TRUE(strip.isActiveCountValid());
+    TEST_ASSERT_FALSE(strip.isAnyActive());
+    TEST_ASSERT_EQUAL(0, strip.activeCount());
+
+    // A copy owns its pixels and counts again
+    strip.setLed(3, COLOR_GREEN);
+    LedBufferStorage copy(strip);
+    TEST_ASSERT_EQUAL(1, copy.activeCount());
+
+    copy.setLed(4, COLOR_GREEN);
+    TEST_ASSERT_EQUAL(2, copy.activeCount());
+    TEST_ASSERT_EQUAL(1, strip.activeCount());
+}
+
+int main() {
+    UNITY_BEGIN();
+    RUN_TEST(test_resolve_led_through_chain);
+    RUN_TEST(test_inversed_bulk_calls);
+    RUN_TEST(test_flattened_matches_chain);
+    RUN_TEST(test_flattened_regular_mapping_uses_runs);
+    RUN_TEST(test_mapped_regular_mapping_uses_runs);
+    RUN_TEST(test_mapped_irregular_mapping_keeps_indices);
+    RUN_TEST(test_matrix_serpentine_offsets);
+    RUN_TEST(test_matrix_blit_and_scroll);
+    RUN_TEST(test_matrix_size_is_checked);
+    RUN_TEST(test_white_extraction);
+    RUN_TEST(test_active_count);
+    RUN_TEST(test_active_count_with_kept_pixel_buffer);
+    return UNITY_END();
+}